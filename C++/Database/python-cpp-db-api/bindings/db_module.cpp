@@ -11,6 +11,7 @@ static PyObject* close_connection_py(PyObject* self, PyObject* args);
 static PyObject* db_put(PyObject* self, PyObject* args);
 static PyObject* db_get(PyObject* self, PyObject* args);
 static PyObject* db_remove(PyObject* self, PyObject* args);
+static PyObject* db_write_batch(PyObject* self, PyObject* args);
 static PyObject* db_range(PyObject* self, PyObject* args);
 static PyObject* db_sync(PyObject* self, PyObject* args);
 static PyObject* db_execute_query(PyObject* self, PyObject* args, PyObject* kwargs);
@@ -29,6 +30,8 @@ static PyMethodDef DBModuleMethods[] = {
      "Get a value by key from the database"},
     {"remove", db_remove, METH_VARARGS, 
      "Remove a key-value pair from the database"},
+    {"write_batch", db_write_batch, METH_VARARGS, 
+     "Apply a list of ('put', key, value), ('delete', key) and ('delete_range', start, end) operations atomically"},
     {"range", db_range, METH_VARARGS, 
      "Get range of key-value pairs from the database"},
     {"sync", db_sync, METH_VARARGS, 
@@ -279,6 +282,85 @@ static PyObject* db_remove(PyObject* self, PyObject* args) {
     }
 }
 
+// Convert one ('put', key, value), ('delete', key) or ('delete_range', start, end) tuple
+static bool py_tuple_to_batch_operation(PyObject* py_op, BatchOperation& op) {
+    if (!PyTuple_Check(py_op) || PyTuple_Size(py_op) < 2 || !PyUnicode_Check(PyTuple_GET_ITEM(py_op, 0))) {
+        PyErr_SetString(PyExc_TypeError, "Each operation must be a tuple starting with its name");
+        return false;
+    }
+    
+    std::string name = PyUnicode_AsUTF8(PyTuple_GET_ITEM(py_op, 0));
+    const char* value = nullptr;
+    bool parsed = false;
+    if (name == "put") {
+        op.type = BatchOperation::Type::Put;
+        parsed = PyArg_ParseTuple(py_op, "sis", &value, &op.key, &value);
+        if (parsed) {
+            op.value = value;
+        }
+    } else if (name == "delete") {
+        op.type = BatchOperation::Type::Delete;
+        parsed = PyArg_ParseTuple(py_op, "si", &value, &op.key);
+    } else if (name == "delete_range") {
+        op.type = BatchOperation::Type::DeleteRange;
+        parsed = PyArg_ParseTuple(py_op, "sii", &value, &op.key, &op.end_key);
+    } else {
+        PyErr_Format(PyExc_ValueError, "Unknown batch operation '%s'", name.c_str());
+    }
+    return parsed;
+}
+
+// Write batch operation
+static PyObject* db_write_batch(PyObject* self, PyObject* args) {
+    PyObject* py_connection;
+    PyObject* py_operations;
+    
+    if (!PyArg_ParseTuple(args, "OO", &py_connection, &py_operations)) {
+        return NULL;
+    }
+    
+    if (!PyCapsule_CheckExact(py_connection)) {
+        PyErr_SetString(PyExc_TypeError, "First argument must be a DatabaseConnection");
+        return NULL;
+    }
+    
+    // Extract C++ object
+    auto conn_ptr = static_cast<std::shared_ptr<DatabaseBridge>*>(
+        PyCapsule_GetPointer(py_connection, "DatabaseConnection")
+    );
+    
+    if (!conn_ptr || !*conn_ptr) {
+        PyErr_SetString(PyExc_ValueError, "Invalid DatabaseConnection");
+        return NULL;
+    }
+    
+    // Convert the operations before touching the database, so a bad entry applies nothing
+    PyObject* py_list = PySequence_Fast(py_operations, "Operations must be a sequence");
+    if (!py_list) {
+        return NULL;
+    }
+    
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(py_list);
+    std::vector<BatchOperation> operations(count);
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        if (!py_tuple_to_batch_operation(PySequence_Fast_GET_ITEM(py_list, i), operations[i])) {
+            Py_DECREF(py_list);
+            return NULL;
+        }
+    }
+    Py_DECREF(py_list);
+    
+    // Execute write batch
+    bool result = (*conn_ptr)->write_batch(operations);
+    
+    if (result) {
+        Py_RETURN_TRUE;
+    } else {
+        PyErr_SetString(PyExc_RuntimeError, (*conn_ptr)->get_last_error().c_str());
+        return NULL;
+    }
+}
+
 // Range operation
 static PyObject* db_range(PyObject* self, PyObject* args) {
     PyObject* py_connection;
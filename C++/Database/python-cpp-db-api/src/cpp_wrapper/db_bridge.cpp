@@ -81,6 +81,39 @@ bool DatabaseBridge::remove(int key) {
     }
 }
 
+bool DatabaseBridge::write_batch(const std::vector<BatchOperation>& operations) {
+    if (!connected_ || !database_) {
+        last_error_ = "Not connected to database";
+        return false;
+    }
+    
+    try {
+        // The whole batch takes one lock acquisition and one log record
+        WriteBatch<int, std::string> batch;
+        for (const auto& op : operations) {
+            switch (op.type) {
+                case BatchOperation::Type::Put:
+                    batch.put(op.key, op.value);
+                    break;
+                case BatchOperation::Type::Delete:
+                    batch.remove(op.key);
+                    break;
+                case BatchOperation::Type::DeleteRange:
+                    batch.deleteRange(op.key, op.end_key);
+                    break;
+            }
+        }
+        if (!database_->write(batch)) {
+            last_error_ = "Write batch was not applied";
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        last_error_ = std::string("Error in write_batch operation: ") + e.what();
+        return false;
+    }
+}
+
 std::vector<std::pair<int, std::string>> DatabaseBridge::range(int start_key, int end_key) const {
     if (!connected_ || !database_) {
         last_error_ = "Not connected to database";
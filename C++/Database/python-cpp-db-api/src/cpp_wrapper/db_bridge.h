@@ -10,6 +10,15 @@
 // Forward declaration of the Database class (in global namespace, not db::)
 class Database;
 
+// One write of a batch: a put of value, a delete of key, or a delete of [key, end_key]
+struct BatchOperation {
+    enum class Type { Put, Delete, DeleteRange };
+    Type type;
+    int key;
+    std::string value;
+    int end_key;
+};
+
 class DatabaseBridge {
 public:
     // Constructor and destructor
@@ -20,6 +29,7 @@ public:
     bool put(int key, const std::string& value);
     std::optional<std::string> get(int key) const;
     bool remove(int key);
+    bool write_batch(const std::vector<BatchOperation>& operations);
     std::vector<std::pair<int, std::string>> range(int start_key, int end_key) const;
     bool sync();
 
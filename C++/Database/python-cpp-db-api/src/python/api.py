@@ -93,6 +93,27 @@ class DatabaseAPI:
             logging.error(f"Error in remove operation: {e}")
             return False
     
+    def write_batch(self, operations: List[Tuple]) -> bool:
+        """
+        Apply several writes atomically, with one lock acquisition and one
+        log record for the whole batch
+        
+        Args:
+            operations: Tuples of ("put", key, value), ("delete", key) or
+                ("delete_range", start_key, end_key), applied in order
+            
+        Returns:
+            bool: True if the batch was applied
+        """
+        if not self.connection or not self.connection.is_connected:
+            raise ConnectionError("Not connected to database")
+            
+        try:
+            return self.connection.connection.write_batch(operations)
+        except Exception as e:
+            logging.error(f"Error in write_batch operation: {e}")
+            return False
+    
     def range_query(self, start_key: int, end_key: int) -> List[Tuple[int, str]]:
         """
         Retrieve all key-value pairs in the given range
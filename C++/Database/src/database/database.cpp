@@ -27,8 +27,12 @@ Database::Database(const std::string& dbName)
 Database::~Database() {
     LOG_INFO("Database destructor called for " + name);
     
-    // Signal the sync thread to stop
-    stopSync.store(true);
+    // Signal the sync thread to stop and wake it
+    {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        stopSync.store(true);
+    }
+    syncCV.notify_all();
     
     // Wait for sync thread to finish
     if (syncThread.joinable()) {
@@ -59,13 +63,46 @@ Database::~Database() {
 
 bool Database::put(int key, const std::string& value) {
     // Write operations only go to LSM Tree for optimal write performance
-    return lsmTree.put(key, value);
+    WriteBatch<int, std::string> batch;
+    batch.put(key, value);
+    return write(batch);
 }
 
 bool Database::remove(int key) {
-    // For removals, we only update the LSM Tree since B+Tree doesn't support removal
-    // This is a design limitation - newer values in LSM will overshadow older B+Tree entries
-    return lsmTree.remove(key);
+    WriteBatch<int, std::string> batch;
+    batch.remove(key);
+    return write(batch);
+}
+
+bool Database::deleteRange(int startKey, int endKey) {
+    if (endKey < startKey) {
+        return false;
+    }
+    
+    WriteBatch<int, std::string> batch;
+    batch.deleteRange(startKey, endKey);
+    return write(batch);
+}
+
+bool Database::write(const WriteBatch<int, std::string>& batch) {
+    // Reads consult the B+Tree first, so the synced copies of every key the
+    // batch writes are dropped before the batch reaches the LSM Tree. Reads
+    // in between fall through to the LSM Tree and find the old values there,
+    // and the LSM Tree shows them all of the batch or none of it
+    std::shared_lock<std::shared_mutex> writeLock(writeSyncMutex);
+    {
+        std::lock_guard<std::mutex> lock(accessMutex);
+        for (const auto& entry : batch.getEntries()) {
+            if (entry.type == RecordType::RangeDeletion) {
+                for (const auto& synced : indexTree.range(entry.key, entry.endKey)) {
+                    indexTree.remove(synced.first);
+                }
+            } else {
+                indexTree.remove(entry.key);
+            }
+        }
+    }
+    return lsmTree.write(batch);
 }
 
 bool Database::get(int key, std::string& value) const {
@@ -129,7 +166,10 @@ std::vector<std::pair<int, std::string>> Database::range(int startKey, int endKe
 }
 
 void Database::sync() {
-    std::lock_guard<std::mutex> lock(accessMutex);
+    // A write drops its B+Tree copies before it reaches the LSM Tree, so a
+    // scan in between would put old values back; writers are held off
+    // while the LSM Tree is scanned, readers only while the copies go in
+    std::unique_lock<std::shared_mutex> writeLock(writeSyncMutex);
     
     // If a sync is already in progress, just return
     if (syncInProgress.load()) {
@@ -144,8 +184,11 @@ void Database::sync() {
     constexpr int MAX_KEY = std::numeric_limits<int>::max();
     
     auto entries = lsmTree.range(MIN_KEY, MAX_KEY);
-    for (const auto& [key, value] : entries) {
-        indexTree.insert(key, value);
+    {
+        std::lock_guard<std::mutex> lock(accessMutex);
+        for (const auto& [key, value] : entries) {
+            indexTree.insert(key, value);
+        }
     }
     
     syncInProgress.store(false);
@@ -155,10 +198,10 @@ void Database::syncDataStructures() {
     using namespace std::chrono_literals;
     
     while (!stopSync.load()) {
-        // Sleep in shorter intervals (100ms) and check stopSync flag frequently
-        // This allows faster shutdown response
-        for (int i = 0; i < 50 && !stopSync.load(); i++) {
-            std::this_thread::sleep_for(100ms);
+        // Sleep between syncs until the interval passes or stop is requested
+        {
+            std::unique_lock<std::mutex> lock(syncMutex);
+            syncCV.wait_for(lock, 5s, [this] { return stopSync.load(); });
         }
         
         // If stop was requested during the sleep, exit immediately
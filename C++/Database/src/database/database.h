@@ -5,6 +5,8 @@
 #include <string>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
 #include <thread>
 #include <atomic>
 #include "../index/bplus_tree.h"
@@ -30,9 +32,16 @@ private:
     mutable std::mutex accessMutex;
     std::atomic<bool> syncInProgress;
     
-    // Background thread for syncing LSM Tree to B+Tree
+    // Held shared by writers from dropping their B+Tree copies until the
+    // LSM Tree has their writes, and exclusively by a sync
+    std::shared_mutex writeSyncMutex;
+    
+    // Background thread for syncing LSM Tree to B+Tree; it sleeps on
+    // syncCV between syncs so the destructor can wake it right away
     std::thread syncThread;
     std::atomic<bool> stopSync;
+    std::mutex syncMutex;
+    std::condition_variable syncCV;
     
     // Sync data from LSM Tree to B+Tree periodically
     void syncDataStructures();
@@ -44,6 +53,11 @@ public:
     // Write operations (LSM Tree only)
     bool put(int key, const std::string& value);
     bool remove(int key);
+    bool deleteRange(int startKey, int endKey);
+    
+    // Apply puts, deletes and range deletes atomically, with one lock
+    // acquisition and one log record for the whole batch
+    bool write(const WriteBatch<int, std::string>& batch);
     
     // Read operations (B+Tree only, with fallback to LSM)
     bool get(int key, std::string& value) const;
@@ -90,6 +90,9 @@ public:
     // Find a value by key
     Value* find(const Key& key);
     
+    // Remove a key; leaves are not merged, so emptied leaves stay linked
+    bool remove(const Key& key);
+    
     // Range query - highly optimized for cache-friendly access
     std::vector<std::pair<Key, Value>> range(const Key& start, const Key& end);
     
@@ -207,6 +207,34 @@ Value* BPlusTree<Key, Value, B>::find(const Key& key) {
     return nullptr; // Not found
 }
 
+template<typename Key, typename Value, size_t B>
+bool BPlusTree<Key, Value, B>::remove(const Key& key) {
+    Node* node = root;
+    
+    // Traverse to leaf
+    while (!node->isLeaf) {
+        InnerNode* inner = static_cast<InnerNode*>(node);
+        size_t pos = inner->findChildPos(key);
+        node = inner->children[pos];
+    }
+    
+    LeafNode* leaf = static_cast<LeafNode*>(node);
+    size_t pos = leaf->findPos(key);
+    if (pos >= leaf->size || !(leaf->keys[pos] == key)) {
+        return false;
+    }
+    
+    // Shift the remaining entries left; separators in the inner nodes stay
+    // valid because every key in the leaf is still within their bounds
+    for (size_t i = pos + 1; i < leaf->size; ++i) {
+        leaf->keys[i - 1] = std::move(leaf->keys[i]);
+        leaf->values[i - 1] = std::move(leaf->values[i]);
+    }
+    --leaf->size;
+    --count;
+    return true;
+}
+
 template<typename Key, typename Value, size_t B>
 std::vector<std::pair<Key, Value>> BPlusTree<Key, Value, B>::range(const Key& start, const Key& end) {
     std::vector<std::pair<Key, Value>> result;
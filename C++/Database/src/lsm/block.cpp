@@ -0,0 +1,195 @@
+#include "block.h"
+#include "coding.h"
+#include <algorithm>
+
+namespace {
+
+// Decode the three varint lengths of an entry header
+inline const char* decodeEntry(const char* ptr, const char* limit,
+                               uint32_t* shared, uint32_t* nonShared, uint32_t* valueLength) {
+    ptr = getVarint32(ptr, limit, shared);
+    if (!ptr) return nullptr;
+    ptr = getVarint32(ptr, limit, nonShared);
+    if (!ptr) return nullptr;
+    ptr = getVarint32(ptr, limit, valueLength);
+    if (!ptr) return nullptr;
+    if (static_cast<size_t>(limit - ptr) < static_cast<size_t>(*nonShared) + *valueLength) {
+        return nullptr;
+    }
+    return ptr;
+}
+
+} // namespace
+
+// BlockBuilder implementation
+
+BlockBuilder::BlockBuilder(int restartInterval)
+    : restartInterval(std::max(restartInterval, 1)), counter(0), entryCount(0), finished(false) {
+    restarts.push_back(0);
+}
+
+void BlockBuilder::reset() {
+    buffer.clear();
+    restarts.clear();
+    restarts.push_back(0);
+    counter = 0;
+    entryCount = 0;
+    finished = false;
+    lastKeyBytes.clear();
+}
+
+size_t BlockBuilder::currentSizeEstimate() const {
+    return buffer.size() + restarts.size() * sizeof(uint32_t) + sizeof(uint32_t);
+}
+
+void BlockBuilder::add(std::string_view key, std::string_view value) {
+    size_t shared = 0;
+    if (counter < restartInterval) {
+        // Share a prefix with the previous key
+        size_t minLength = std::min(lastKeyBytes.size(), key.size());
+        while (shared < minLength && lastKeyBytes[shared] == key[shared]) {
+            ++shared;
+        }
+    } else {
+        // Start a new restart point with the full key
+        restarts.push_back(static_cast<uint32_t>(buffer.size()));
+        counter = 0;
+    }
+
+    size_t nonShared = key.size() - shared;
+    putVarint32(buffer, static_cast<uint32_t>(shared));
+    putVarint32(buffer, static_cast<uint32_t>(nonShared));
+    putVarint32(buffer, static_cast<uint32_t>(value.size()));
+    buffer.append(key.data() + shared, nonShared);
+    buffer.append(value.data(), value.size());
+
+    lastKeyBytes.resize(shared);
+    lastKeyBytes.append(key.data() + shared, nonShared);
+    ++counter;
+    ++entryCount;
+}
+
+std::string_view BlockBuilder::finish() {
+    if (!finished) {
+        for (uint32_t restart : restarts) {
+            putFixed32(buffer, restart);
+        }
+        putFixed32(buffer, static_cast<uint32_t>(restarts.size()));
+        finished = true;
+    }
+    return std::string_view(buffer);
+}
+
+// Block implementation
+
+Block::Block(const char* data, size_t size)
+    : data(data), dataSize(size), restartOffset(0), numRestarts(0), valid(false) {
+    init();
+}
+
+Block::Block(std::string contents)
+    : owned(std::move(contents)), data(owned.data()), dataSize(owned.size()),
+      restartOffset(0), numRestarts(0), valid(false) {
+    init();
+}
+
+void Block::init() {
+    size_t size = dataSize;
+    if (size < sizeof(uint32_t)) {
+        return;
+    }
+    numRestarts = decodeFixed32(data + size - sizeof(uint32_t));
+    size_t maxRestarts = (size - sizeof(uint32_t)) / sizeof(uint32_t);
+    if (numRestarts > maxRestarts) {
+        numRestarts = 0;
+        return;
+    }
+    restartOffset = static_cast<uint32_t>(size - (1 + numRestarts) * sizeof(uint32_t));
+    valid = true;
+}
+
+uint32_t Block::restartPoint(uint32_t index) const {
+    return decodeFixed32(data + restartOffset + index * sizeof(uint32_t));
+}
+
+// Block::Iterator implementation
+
+Block::Iterator::Iterator(const Block* block)
+    : block(block), current(block->restartOffset), nextOffset(block->restartOffset), corrupt(false) {
+    if (!block->valid) {
+        corrupt = true;
+    }
+}
+
+void Block::Iterator::markCorrupt() {
+    corrupt = true;
+    current = block->restartOffset;
+    nextOffset = block->restartOffset;
+    keyBytes.clear();
+    valueBytes = std::string_view();
+}
+
+void Block::Iterator::seekToFirst() {
+    if (block->numRestarts == 0) {
+        current = block->restartOffset;
+        return;
+    }
+    seekToRestart(0);
+}
+
+void Block::Iterator::seekToRestart(uint32_t index) {
+    keyBytes.clear();
+    nextOffset = block->restartPoint(index);
+    if (nextOffset > block->restartOffset) {
+        markCorrupt();
+        return;
+    }
+    parseNextEntry();
+}
+
+void Block::Iterator::next() {
+    if (valid()) {
+        parseNextEntry();
+    }
+}
+
+bool Block::Iterator::parseNextEntry() {
+    current = nextOffset;
+    if (current >= block->restartOffset) {
+        current = block->restartOffset;
+        return false;
+    }
+
+    const char* ptr = block->data + current;
+    const char* limit = block->data + block->restartOffset;
+    uint32_t shared = 0, nonShared = 0, valueLength = 0;
+    ptr = decodeEntry(ptr, limit, &shared, &nonShared, &valueLength);
+    if (!ptr || shared > keyBytes.size()) {
+        markCorrupt();
+        return false;
+    }
+
+    keyBytes.resize(shared);
+    keyBytes.append(ptr, nonShared);
+    valueBytes = std::string_view(ptr + nonShared, valueLength);
+    nextOffset = static_cast<uint32_t>((ptr + nonShared + valueLength) - block->data);
+    return true;
+}
+
+std::string_view Block::Iterator::restartKey(uint32_t index, bool* ok) const {
+    uint32_t offset = block->restartPoint(index);
+    if (offset >= block->restartOffset) {
+        *ok = false;
+        return std::string_view();
+    }
+
+    const char* ptr = block->data + offset;
+    const char* limit = block->data + block->restartOffset;
+    uint32_t shared = 0, nonShared = 0, valueLength = 0;
+    ptr = decodeEntry(ptr, limit, &shared, &nonShared, &valueLength);
+    if (!ptr || shared != 0) {
+        *ok = false;
+        return std::string_view();
+    }
+    return std::string_view(ptr, nonShared);
+}
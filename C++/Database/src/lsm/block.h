@@ -0,0 +1,161 @@
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * BlockBuilder / Block - Prefix-compressed sorted blocks of key-value pairs
+ *
+ * Blocks are the unit of I/O inside an SSTable. Each entry stores only the
+ * part of its key that differs from the previous key:
+ *
+ *   varint shared | varint nonShared | varint valueLen | key delta | value
+ *
+ * Every restartInterval entries the key is stored in full ("restart point").
+ * The block ends with the restart offsets (fixed32 each) followed by the
+ * restart count (fixed32), so a lookup binary searches the restart points
+ * and then scans at most restartInterval entries.
+ *
+ * Blocks work on encoded key bytes; ordering is supplied by the caller.
+ */
+class BlockBuilder {
+public:
+    explicit BlockBuilder(int restartInterval = 16);
+
+    // Append an entry; keys must be added in increasing order
+    void add(std::string_view key, std::string_view value);
+
+    // Append the restart array and return the finished block contents
+    // The view stays valid until the next reset()
+    std::string_view finish();
+
+    // Start a new block
+    void reset();
+
+    // Size of the block if finish() were called now
+    size_t currentSizeEstimate() const;
+
+    bool empty() const { return entryCount == 0; }
+    size_t size() const { return entryCount; }
+    std::string_view lastKey() const { return lastKeyBytes; }
+
+private:
+    int restartInterval;
+    std::string buffer;
+    std::vector<uint32_t> restarts;
+    int counter;
+    size_t entryCount;
+    bool finished;
+    std::string lastKeyBytes;
+};
+
+class Block {
+public:
+    // Wrap block contents; the bytes must outlive the Block
+    Block(const char* data, size_t size);
+    
+    // Take ownership of block contents (e.g. after decompression)
+    explicit Block(std::string contents);
+    
+    // Iterators point into the block, so it stays in place
+    Block(const Block&) = delete;
+    Block& operator=(const Block&) = delete;
+
+    // False if the restart array is malformed
+    bool ok() const { return valid; }
+
+    size_t size() const { return dataSize; }
+
+    /**
+     * Iterator - Walks the entries of a block in key order
+     */
+    class Iterator {
+    public:
+        explicit Iterator(const Block* block);
+
+        bool valid() const { return current < block->restartOffset; }
+
+        // True if a malformed entry stopped the iteration
+        bool corrupted() const { return corrupt; }
+
+        void seekToFirst();
+        void next();
+
+        /**
+         * Position at the first entry whose key is not less than the target
+         * @param lessThanTarget predicate returning true if an encoded key sorts before the target
+         */
+        template <typename LessThanTarget>
+        void seek(LessThanTarget lessThanTarget);
+
+        // Full key of the current entry (owned by the iterator)
+        std::string_view key() const { return keyBytes; }
+
+        // Value of the current entry (points into the block)
+        std::string_view value() const { return valueBytes; }
+
+    private:
+        const Block* block;
+        uint32_t current;
+        uint32_t nextOffset;
+        std::string keyBytes;
+        std::string_view valueBytes;
+        bool corrupt;
+
+        void seekToRestart(uint32_t index);
+        bool parseNextEntry();
+        void markCorrupt();
+        std::string_view restartKey(uint32_t index, bool* ok) const;
+    };
+
+private:
+    std::string owned;
+    const char* data;
+    size_t dataSize;
+    uint32_t restartOffset;
+    uint32_t numRestarts;
+    bool valid;
+
+    // Parse the restart array at the end of the contents
+    void init();
+
+    uint32_t restartPoint(uint32_t index) const;
+};
+
+template <typename LessThanTarget>
+void Block::Iterator::seek(LessThanTarget lessThanTarget) {
+    if (block->numRestarts == 0) {
+        current = block->restartOffset;
+        return;
+    }
+
+    // Binary search for the last restart point whose key is before the target
+    uint32_t left = 0;
+    uint32_t right = block->numRestarts - 1;
+    while (left < right) {
+        uint32_t mid = left + (right - left + 1) / 2;
+        bool ok = true;
+        std::string_view midKey = restartKey(mid, &ok);
+        if (!ok) {
+            markCorrupt();
+            return;
+        }
+        if (lessThanTarget(midKey)) {
+            left = mid;
+        } else {
+            right = mid - 1;
+        }
+    }
+
+    // Linear scan within the restart interval
+    seekToRestart(left);
+    while (valid() && lessThanTarget(std::string_view(keyBytes))) {
+        next();
+    }
+}
+
+#endif // BLOCK_H
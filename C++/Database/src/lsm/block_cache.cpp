@@ -0,0 +1,88 @@
+#include "block_cache.h"
+#include <algorithm>
+
+BlockCache::BlockCache(size_t capacityBytes, int numShardBits)
+    : capacity(capacityBytes), hits(0), misses(0), inserts(0), evictions(0) {
+    size_t numShards = size_t(1) << std::clamp(numShardBits, 0, 10);
+    shards.reserve(numShards);
+    for (size_t i = 0; i < numShards; ++i) {
+        shards.push_back(std::make_unique<Shard>());
+        shards.back()->capacity = (capacityBytes + numShards - 1) / numShards;
+    }
+}
+
+uint64_t BlockCache::newTableId() {
+    static std::atomic<uint64_t> nextId{1};
+    return nextId.fetch_add(1, std::memory_order_relaxed);
+}
+
+BlockCache::Shard& BlockCache::shardFor(const CacheKey& key) {
+    // Use the high bits of the hash so shard choice is independent of bucket choice
+    uint64_t h = CacheKeyHash()(key);
+    return *shards[(h >> 32) & (shards.size() - 1)];
+}
+
+std::shared_ptr<const Block> BlockCache::lookup(uint64_t tableId, uint64_t offset) {
+    CacheKey key{tableId, offset};
+    Shard& shard = shardFor(key);
+    
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.table.find(key);
+    if (it == shard.table.end()) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    
+    // Move to the front of the LRU list
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return it->second->block;
+}
+
+void BlockCache::insert(uint64_t tableId, uint64_t offset,
+                        std::shared_ptr<const Block> block, size_t charge) {
+    CacheKey key{tableId, offset};
+    Shard& shard = shardFor(key);
+    
+    // Blocks larger than a whole shard are not worth caching
+    if (charge > shard.capacity) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    
+    auto existing = shard.table.find(key);
+    if (existing != shard.table.end()) {
+        // Another reader inserted the same block first
+        shard.lru.splice(shard.lru.begin(), shard.lru, existing->second);
+        return;
+    }
+    
+    // Evict from the cold end until the new block fits
+    while (shard.usage + charge > shard.capacity && !shard.lru.empty()) {
+        Entry& victim = shard.lru.back();
+        shard.usage -= victim.charge;
+        shard.table.erase(victim.key);
+        shard.lru.pop_back();
+        evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    shard.lru.push_front(Entry{key, std::move(block), charge});
+    shard.table[key] = shard.lru.begin();
+    shard.usage += charge;
+    inserts.fetch_add(1, std::memory_order_relaxed);
+}
+
+BlockCache::Stats BlockCache::getStats() const {
+    Stats stats{};
+    stats.hits = hits.load(std::memory_order_relaxed);
+    stats.misses = misses.load(std::memory_order_relaxed);
+    stats.inserts = inserts.load(std::memory_order_relaxed);
+    stats.evictions = evictions.load(std::memory_order_relaxed);
+    stats.capacity = capacity;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        stats.usage += shard->usage;
+    }
+    return stats;
+}
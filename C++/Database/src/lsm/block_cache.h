@@ -0,0 +1,95 @@
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+#include "block.h"
+
+/**
+ * BlockCache - Capacity-bounded cache of decoded SSTable data blocks
+ *
+ * Blocks are keyed by (table id, block offset) and charged by their decoded
+ * size. The cache is split into shards, each with its own lock and LRU list,
+ * so concurrent readers rarely contend. One cache is shared by every SSTable
+ * of an LSMTree, and can be shared across trees by passing the same instance
+ * in LSMOptions.
+ */
+class BlockCache {
+public:
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t inserts;
+        uint64_t evictions;
+        size_t usage;
+        size_t capacity;
+    };
+
+    // numShardBits = 4 gives 16 shards
+    explicit BlockCache(size_t capacityBytes, int numShardBits = 4);
+
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    // Returns the cached block or nullptr on a miss
+    std::shared_ptr<const Block> lookup(uint64_t tableId, uint64_t offset);
+
+    // Insert a block, evicting least recently used blocks from its shard if needed
+    void insert(uint64_t tableId, uint64_t offset, std::shared_ptr<const Block> block, size_t charge);
+
+    // Allocate a process-wide unique id for a newly opened table
+    static uint64_t newTableId();
+
+    Stats getStats() const;
+    size_t getCapacity() const { return capacity; }
+
+private:
+    struct CacheKey {
+        uint64_t tableId;
+        uint64_t offset;
+
+        bool operator==(const CacheKey& other) const {
+            return tableId == other.tableId && offset == other.offset;
+        }
+    };
+
+    struct CacheKeyHash {
+        size_t operator()(const CacheKey& key) const {
+            uint64_t h = key.tableId * 0x9e3779b97f4a7c15ULL ^ (key.offset + 0x632be59bd9b4e019ULL);
+            h ^= h >> 31;
+            return static_cast<size_t>(h * 0xbf58476d1ce4e5b9ULL);
+        }
+    };
+
+    struct Entry {
+        CacheKey key;
+        std::shared_ptr<const Block> block;
+        size_t charge;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru;  // Front is most recently used
+        std::unordered_map<CacheKey, std::list<Entry>::iterator, CacheKeyHash> table;
+        size_t usage = 0;
+        size_t capacity = 0;
+    };
+
+    size_t capacity;
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> inserts;
+    std::atomic<uint64_t> evictions;
+
+    Shard& shardFor(const CacheKey& key);
+};
+
+#endif // BLOCK_CACHE_H
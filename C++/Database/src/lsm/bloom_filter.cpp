@@ -0,0 +1,116 @@
+#include "bloom_filter.h"
+#include "coding.h"
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Map a 32-bit hash onto [0, n) without a division
+inline uint32_t fastRange(uint32_t hash, uint32_t n) {
+    return static_cast<uint32_t>((static_cast<uint64_t>(hash) * n) >> 32);
+}
+
+} // namespace
+
+uint64_t BloomFilter::hash(const char* data, size_t size) {
+    // MurmurHash64A
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+    uint64_t h = 0x8445d61a4e774912ULL ^ (size * m);
+
+    const char* end = data + (size / 8) * 8;
+    for (const char* p = data; p != end; p += 8) {
+        uint64_t k = decodeFixed64(p);
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+
+    const unsigned char* tail = reinterpret_cast<const unsigned char*>(end);
+    switch (size & 7) {
+        case 7: h ^= static_cast<uint64_t>(tail[6]) << 48; [[fallthrough]];
+        case 6: h ^= static_cast<uint64_t>(tail[5]) << 40; [[fallthrough]];
+        case 5: h ^= static_cast<uint64_t>(tail[4]) << 32; [[fallthrough]];
+        case 4: h ^= static_cast<uint64_t>(tail[3]) << 24; [[fallthrough]];
+        case 3: h ^= static_cast<uint64_t>(tail[2]) << 16; [[fallthrough]];
+        case 2: h ^= static_cast<uint64_t>(tail[1]) << 8; [[fallthrough]];
+        case 1: h ^= static_cast<uint64_t>(tail[0]);
+                h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+std::string BloomFilter::build(const std::vector<uint64_t>& keyHashes, size_t bitsPerKey) {
+    if (bitsPerKey == 0 || keyHashes.empty()) {
+        return std::string();
+    }
+
+    // Optimal probe count is bitsPerKey * ln(2); blocking costs a little accuracy,
+    // so stay on the low side of that
+    uint32_t probes = static_cast<uint32_t>(std::lround(static_cast<double>(bitsPerKey) * 0.69));
+    probes = std::clamp<uint32_t>(probes, 1, 30);
+
+    size_t totalBits = keyHashes.size() * bitsPerKey;
+    uint32_t blocks = static_cast<uint32_t>((totalBits + BLOCK_BITS - 1) / BLOCK_BITS);
+    blocks = std::max<uint32_t>(blocks, 1);
+
+    std::string result(static_cast<size_t>(blocks) * BLOCK_BYTES, '\0');
+    auto* data = reinterpret_cast<unsigned char*>(&result[0]);
+
+    for (uint64_t h : keyHashes) {
+        unsigned char* block = data + static_cast<size_t>(fastRange(static_cast<uint32_t>(h >> 32), blocks)) * BLOCK_BYTES;
+        uint32_t h2 = static_cast<uint32_t>(h);
+        const uint32_t delta = (h2 >> 17) | (h2 << 15);
+        for (uint32_t i = 0; i < probes; ++i) {
+            uint32_t bit = h2 & (BLOCK_BITS - 1);
+            block[bit >> 3] |= static_cast<unsigned char>(1u << (bit & 7));
+            h2 += delta;
+        }
+    }
+
+    putFixed32(result, blocks);
+    result.push_back(static_cast<char>(probes));
+    return result;
+}
+
+BloomFilter::BloomFilter(const char* data, size_t size) {
+    if (size < 5) {
+        return;
+    }
+
+    uint32_t blocks = decodeFixed32(data + size - 5);
+    uint32_t probes = static_cast<unsigned char>(data[size - 1]);
+    if (static_cast<size_t>(blocks) * BLOCK_BYTES != size - 5 || probes == 0 || probes > 30) {
+        // Unknown or corrupted layout: treat as no filter rather than risk false negatives
+        return;
+    }
+
+    bits = reinterpret_cast<const unsigned char*>(data);
+    numBlocks = blocks;
+    numProbes = probes;
+}
+
+bool BloomFilter::mayContain(uint64_t keyHash) const {
+    if (numBlocks == 0) {
+        return true;
+    }
+
+    const unsigned char* block = bits + static_cast<size_t>(fastRange(static_cast<uint32_t>(keyHash >> 32), numBlocks)) * BLOCK_BYTES;
+    uint32_t h2 = static_cast<uint32_t>(keyHash);
+    const uint32_t delta = (h2 >> 17) | (h2 << 15);
+    for (uint32_t i = 0; i < numProbes; ++i) {
+        uint32_t bit = h2 & (BLOCK_BITS - 1);
+        if ((block[bit >> 3] & (1u << (bit & 7))) == 0) {
+            return false;
+        }
+        h2 += delta;
+    }
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * BloomFilter - Cache-line-blocked Bloom filter for SSTable point lookups
+ *
+ * Every key hashes to a single 512-bit block and all of its probe bits land
+ * inside that block, so a lookup touches exactly one cache line. The filter
+ * is built once at SSTable write time and read in place from the mapping.
+ *
+ * Serialized form: [numBlocks * 64 bytes of bits][fixed32 numBlocks][u8 numProbes]
+ */
+class BloomFilter {
+public:
+    static constexpr size_t BLOCK_BYTES = 64;
+    static constexpr size_t BLOCK_BITS = BLOCK_BYTES * 8;
+
+    // Hash the serialized key bytes (the same hash must be used for build and probe)
+    static uint64_t hash(const char* data, size_t size);
+
+    // Build a serialized filter for the given key hashes
+    // Returns an empty string when bitsPerKey is 0 (filter disabled)
+    static std::string build(const std::vector<uint64_t>& keyHashes, size_t bitsPerKey);
+
+    BloomFilter() = default;
+
+    // Wrap a serialized filter; the bytes must outlive this object
+    BloomFilter(const char* data, size_t size);
+
+    // False means the key is definitely absent; true means it may be present
+    bool mayContain(uint64_t keyHash) const;
+
+    // True if there is no filter data (every probe passes)
+    bool empty() const { return numBlocks == 0; }
+
+private:
+    const unsigned char* bits = nullptr;
+    uint32_t numBlocks = 0;
+    uint32_t numProbes = 0;
+};
+
+#endif // BLOOM_FILTER_H
@@ -0,0 +1,127 @@
+#ifndef CODING_H
+#define CODING_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/**
+ * Coding helpers - Portable binary encoding primitives for on-disk formats
+ *
+ * Fixed-width integers are stored little-endian regardless of the host byte
+ * order. Varints use the usual 7-bits-per-byte encoding, so small lengths
+ * take a single byte.
+ */
+
+constexpr size_t MAX_VARINT32_LENGTH = 5;
+constexpr size_t MAX_VARINT64_LENGTH = 10;
+
+inline void putFixed32(std::string& dst, uint32_t value) {
+    char buf[4];
+    for (int i = 0; i < 4; ++i) {
+        buf[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+    dst.append(buf, sizeof(buf));
+}
+
+inline void putFixed64(std::string& dst, uint64_t value) {
+    char buf[8];
+    for (int i = 0; i < 8; ++i) {
+        buf[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+    dst.append(buf, sizeof(buf));
+}
+
+inline uint32_t decodeFixed32(const char* ptr) {
+    const auto* p = reinterpret_cast<const unsigned char*>(ptr);
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(p[i]) << (8 * i);
+    }
+    return value;
+}
+
+inline uint64_t decodeFixed64(const char* ptr) {
+    const auto* p = reinterpret_cast<const unsigned char*>(ptr);
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    return value;
+}
+
+inline void putVarint64(std::string& dst, uint64_t value) {
+    char buf[MAX_VARINT64_LENGTH];
+    size_t len = 0;
+    while (value >= 0x80) {
+        buf[len++] = static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    buf[len++] = static_cast<char>(value);
+    dst.append(buf, len);
+}
+
+inline void putVarint32(std::string& dst, uint32_t value) {
+    putVarint64(dst, value);
+}
+
+/**
+ * Decode a varint starting at ptr without reading past limit
+ * @return pointer just past the varint, or nullptr if it is truncated or too long
+ */
+inline const char* getVarint64(const char* ptr, const char* limit, uint64_t* value) {
+    uint64_t result = 0;
+    for (uint32_t shift = 0; shift <= 63 && ptr < limit; shift += 7) {
+        uint64_t byte = static_cast<unsigned char>(*ptr++);
+        result |= (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return ptr;
+        }
+    }
+    return nullptr;
+}
+
+inline const char* getVarint32(const char* ptr, const char* limit, uint32_t* value) {
+    uint64_t result = 0;
+    const char* next = getVarint64(ptr, limit, &result);
+    if (next == nullptr || result > UINT32_MAX) {
+        return nullptr;
+    }
+    *value = static_cast<uint32_t>(result);
+    return next;
+}
+
+inline size_t varintLength(uint64_t value) {
+    size_t len = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++len;
+    }
+    return len;
+}
+
+// CRC-32 (IEEE polynomial) of a byte range, used to detect torn or corrupted log records
+inline uint32_t crc32(const char* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> entries{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+        return entries;
+    }();
+    
+    uint32_t crc = 0xffffffffu;
+    const auto* p = reinterpret_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffffu;
+}
+
+#endif // CODING_H
@@ -9,7 +9,14 @@
 #include <atomic>
 #include <queue>
 #include <functional>
+#include <future>
+#include <optional>
 #include "sstable.h"
+#include "lsm_options.h"
+#include "compaction_strategy.h"
+#include "manifest.h"
+#include "version.h"
+#include "../utils/thread_pool.h"
 
 /**
  * CompactionManager - Handles the process of merging SSTables in the LSM-Tree
@@ -17,11 +24,21 @@
  * This class manages the background compaction process that merges multiple
  * SSTables at each level into fewer, larger SSTables in the next level.
  * This is crucial for maintaining read performance over time.
+ *
+ * The set of live tables is recorded in a Manifest: a new table, a
+ * compaction result or a dropped table takes effect only once its edit is
+ * durable, and at startup the tables are rebuilt from the manifest (and
+ * opened lazily) instead of by scanning the directory.
+ *
+ * After every change to the levels the manager publishes an immutable
+ * Version of them. Readers search a Version without the manager's mutex,
+ * and tables are shared, so a compaction that replaces a table never closes
+ * it under a reader.
  */
 template <typename Key, typename Value>
 class CompactionManager {
 public:
-    using SSTablePtr = std::unique_ptr<SSTable<Key, Value>>;
+    using SSTablePtr = std::shared_ptr<SSTable<Key, Value>>;
     using SSTableList = std::vector<SSTablePtr>;
 
 private:
@@ -31,14 +48,25 @@ private:
     // Data directory for SSTables
     std::string dataDirectory;
     
-    // Maximum number of SSTables per level before triggering compaction
-    std::vector<size_t> maxTablesPerLevel;
+    // Options for the SSTables written by compaction
+    LSMOptions options;
     
-    // The actual SSTables organized by level
+    // Decides when and what to compact (leveled or universal)
+    std::unique_ptr<CompactionStrategy<Key, Value>> strategy;
+    
+    // The actual SSTables organized by level; level 0 is ordered oldest first
+    // (by epoch), deeper levels hold non-overlapping tables sorted by key
+    // (leveled style)
     std::vector<SSTableList> levels;
     
+    // Durable record of the tables in levels
+    std::unique_ptr<Manifest> manifest;
+    
+    // Snapshot of levels as of the last change; swapped atomically
+    std::shared_ptr<const Version<Key, Value>> current;
+    
     // Mutex for protecting levels
-    std::mutex mutex;
+    mutable std::mutex mutex;
     
     // Background compaction thread
     std::thread compactionThread;
@@ -46,47 +74,136 @@ private:
     // For signaling the compaction thread
     std::condition_variable compactionCV;
     
+    // A queued compaction job; done is fulfilled once the job has run
+    struct CompactionRequest {
+        int level;
+        bool majorCompaction;
+        std::promise<void> done;
+    };
+    
     // Queue of compaction jobs
-    std::queue<std::pair<int, bool>> compactionQueue; // level, major compaction flag
+    std::queue<CompactionRequest> compactionQueue;
+    
+    // Number of jobs taken off the queue that are still running
+    size_t activeCompactions;
     
     // Flag for stopping the background thread
     std::atomic<bool> stopRequested;
     
+    // Called by the compaction thread, without the mutex held, after each
+    // job with the Version current after it
+    using VersionCallback = std::function<void(std::shared_ptr<const Version<Key, Value>>)>;
+    VersionCallback onCompactionDone;
+    
     // Run the background compaction thread
     void compactionThreadFunc();
     
     // Check if compaction is needed for a level
     bool isCompactionNeeded(int level) const;
     
+    // Keep level 0 in age order and deeper levels sorted by key; the caller
+    // holds the mutex
+    void sortLevel(int level);
+    
+    // Publish the levels as the current Version; the caller holds the mutex
+    void installVersion();
+    
+    // Load the tables recorded in the manifest
+    void recoverTables();
+    
+    // Record the tables of a directory written before the manifest existed
+    // (named sstable_L{level}_...) in a first manifest
+    void importLegacyTables();
+    
+    // Tell the rate limiter how far level 0 is behind; the caller holds the mutex
+    void reportCompactionDebt();
+
+    // True if no table outside the job holds data older than its inputs in
+    // their key range, i.e. the output is the bottom of the tree there;
+    // the caller holds the mutex
+    bool isBottommost(const CompactionJob<Key, Value>& job) const;
+    
+    // Delete tables whose whole key range is covered by a newer range
+    // tombstone, without reading or rewriting them; the caller holds the mutex
+    size_t dropCoveredTables();
+    
     // Perform compaction for a level
     void compactLevel(int level, bool majorCompaction);
     
-    // Merge multiple SSTables into one
-    SSTablePtr mergeTables(const std::vector<SSTablePtr*>& tables);
+    // Workers for subcompactions (null when they are disabled)
+    std::unique_ptr<ThreadPool> subcompactionPool;
+    
+    // Merge the job's inputs into its output level, split into concurrent
+    // subcompactions when allowed and large enough
+    SSTableList runCompaction(const CompactionJob<Key, Value>& job);
+    
+    // Split points for a compaction: keys chosen from the inputs' block index so
+    // each range covers about the same number of blocks
+    std::vector<Key> subcompactionBoundaries(const CompactionJob<Key, Value>& job) const;
+    
+    // Merge the keys in (lower, upper] of the inputs into non-overlapping tables
+    // of about job.targetFileSize; an absent bound is unbounded
+    SSTableList mergeTables(const CompactionJob<Key, Value>& job,
+                            const std::optional<Key>& lower = std::nullopt,
+                            const std::optional<Key>& upper = std::nullopt);
+    
+    // Queue a compaction job; the caller holds the mutex
+    std::future<void> scheduleCompactionLocked(int level, bool majorCompaction);
+    
+    // Fulfill the queued jobs without running them, so no one waits on a
+    // stopped manager; the caller holds the mutex
+    void dropQueuedCompactions();
 
 public:
-    CompactionManager(MMapManager* mmapManager, const std::string& dataDirectory);
+    CompactionManager(MMapManager* mmapManager, const std::string& dataDirectory,
+                      const LSMOptions& options = LSMOptions(),
+                      VersionCallback onCompactionDone = nullptr);
     
     ~CompactionManager();
     
-    // Add a new SSTable to level 0
-    void addTable(SSTablePtr table);
+    // Add a new SSTable to level 0; a table without a file number gets one.
+    // A nonzero logNumber records in the same manifest edit that the
+    // write-ahead log segments below it are no longer needed
+    void addTable(SSTablePtr table, uint64_t logNumber = 0);
+    
+    // Allocate the file number of a new table
+    uint64_t newFileNumber();
     
-    // Schedule compaction for a level
-    void scheduleCompaction(int level, bool majorCompaction = false);
+    // Path of the table file with the given number
+    std::string tableFilePath(uint64_t number) const;
     
-    // Get all SSTables that might contain a key
+    // Manifest of the tables; also tracks the write-ahead log segments
+    Manifest* getManifest() const { return manifest.get(); }
+    
+    // Schedule compaction for a level; the future is ready once the job has
+    // run and its result is installed, or at once after shutdown
+    std::future<void> scheduleCompaction(int level, bool majorCompaction = false);
+    
+    // Current tables of every level; holding the Version keeps them open
+    std::shared_ptr<const Version<Key, Value>> getCurrentVersion() const;
+    
+    // Get all SSTables that might contain a key, newest first; the tables
+    // may be closed by a later compaction unless a Version holding them is kept
     std::vector<SSTable<Key, Value>*> getTablesForKey(const Key& key);
     
-    // Get all SSTables for a range query
+    // Get all SSTables for a range query, newest first (same lifetime as above)
     std::vector<SSTable<Key, Value>*> getTablesForRange(const Key& startKey, const Key& endKey);
     
     // Get number of levels
     size_t getLevelCount() const;
     
+    // Name of the active compaction strategy
+    const char* getStrategyName() const;
+    
     // Get number of tables at a level
     size_t getTableCount(int level) const;
     
+    // Get total file size of the tables at a level
+    uint64_t getLevelSize(int level) const;
+    
+    // Estimate of the bytes compaction still has to rewrite
+    uint64_t getPendingCompactionBytes() const;
+    
     // Wait for all compactions to complete
     void waitForCompactions();
     
@@ -2,66 +2,114 @@
 #define COMPACTION_TPP
 
 #include "compaction.h"
-#include "memtable.h"
+#include "merging_iterator.h"
 #include <algorithm>
+#include <exception>
 #include <filesystem>
 #include <iostream>
-#include <set>
 
 template <typename Key, typename Value>
 CompactionManager<Key, Value>::CompactionManager(
-    MMapManager* mmapManager, const std::string& dataDirectory)
-    : mmapManager(mmapManager), dataDirectory(dataDirectory), stopRequested(false) {
+    MMapManager* mmapManager, const std::string& dataDirectory, const LSMOptions& options,
+    VersionCallback onCompactionDone)
+    : mmapManager(mmapManager), dataDirectory(dataDirectory), options(options), activeCompactions(0),
+      stopRequested(false), onCompactionDone(std::move(onCompactionDone)) {
     
-    // Initialize level configuration
-    // Level 0: 4 tables
-    // Level 1: 10 tables
-    // Level 2: 100 tables
-    // ... each level is 10x the size of the previous
-    maxTablesPerLevel = {4, 10, 100, 1000};
+    // The strategy decides when levels are compacted and into what
+    strategy = createCompactionStrategy<Key, Value>(options);
     
     // Initialize levels
-    levels.resize(maxTablesPerLevel.size());
-    
-    // Scan existing SSTables in the data directory and load them
-    if (std::filesystem::exists(dataDirectory)) {
-        for (const auto& entry : std::filesystem::directory_iterator(dataDirectory)) {
-            if (entry.is_regular_file() && entry.path().extension() == ".db") {
-                std::string filename = entry.path().filename().string();
-                
-                // Parse the level from filename (format: sstable_L{level}_{timestamp}.db)
-                if (filename.find("sstable_L") == 0) {
-                    size_t levelPos = filename.find('_', 9) + 1;
-                    int level = std::stoi(filename.substr(9, levelPos - 10));
-                    
-                    if (level < static_cast<int>(levels.size())) {
-                        try {
-                            auto table = std::make_unique<SSTable<Key, Value>>(
-                                mmapManager, entry.path().string());
-                            levels[level].push_back(std::move(table));
-                        } catch (const std::exception& ex) {
-                            std::cerr << "Failed to load SSTable: " << entry.path().string()
-                                      << " Error: " << ex.what() << std::endl;
-                        }
-                    }
-                }
-            }
-        }
+    int numLevels = std::max(options.numLevels, 2);
+    levels.resize(numLevels);
+    
+    std::filesystem::create_directories(dataDirectory);
+    
+    // Rebuild the levels from the manifest, or adopt the tables of an older
+    // directory; then delete whatever no live table refers to
+    manifest = std::make_unique<Manifest>(dataDirectory, options.maxManifestEdits);
+    if (manifest->recover()) {
+        recoverTables();
     } else {
-        // Create directory if it doesn't exist
-        std::filesystem::create_directories(dataDirectory);
+        importLegacyTables();
+    }
+    for (int level = 0; level < numLevels; ++level) {
+        sortLevel(level);
+    }
+    installVersion();
+    manifest->removeObsoleteFiles();
+    
+    if (options.maxSubcompactions > 1) {
+        subcompactionPool = std::make_unique<ThreadPool>(options.maxSubcompactions);
     }
     
     // Start compaction thread
     compactionThread = std::thread(&CompactionManager::compactionThreadFunc, this);
 }
 
+template <typename Key, typename Value>
+void CompactionManager<Key, Value>::recoverTables() {
+    for (const auto& [number, fileMeta] : manifest->getLiveFiles()) {
+        std::string filePath = dataDirectory + "/" + fileMeta.fileName;
+        if (fileMeta.level < 0 || fileMeta.level >= static_cast<int>(levels.size())) {
+            std::cerr << "Skipping SSTable beyond the last level: " << filePath << std::endl;
+            continue;
+        }
+        
+        // Only check that the file is there; it is opened on first use
+        std::error_code ec;
+        if (std::filesystem::file_size(filePath, ec) != fileMeta.fileSize || ec) {
+            std::cerr << "Missing or truncated SSTable: " << filePath << std::endl;
+            continue;
+        }
+        levels[fileMeta.level].push_back(std::make_unique<SSTable<Key, Value>>(
+            mmapManager, filePath, fileMeta, options.blockCache.get(), options.tableCache.get()));
+    }
+}
+
+template <typename Key, typename Value>
+void CompactionManager<Key, Value>::importLegacyTables() {
+    // Parse the level from the filename (format: sstable_L{level}_{timestamp}_{seq}.db);
+    // the names sort in creation order
+    std::vector<std::pair<std::string, int>> files;
+    for (const auto& entry : std::filesystem::directory_iterator(dataDirectory)) {
+        std::string filename = entry.path().filename().string();
+        if (entry.is_regular_file() && entry.path().extension() == ".db" &&
+            filename.find("sstable_L") == 0) {
+            size_t levelPos = filename.find('_', 9) + 1;
+            int level = std::stoi(filename.substr(9, levelPos - 10));
+            if (level < static_cast<int>(levels.size())) {
+                files.emplace_back(entry.path().string(), level);
+            }
+        }
+    }
+    std::sort(files.begin(), files.end());
+    
+    VersionEdit edit;
+    for (const auto& [filePath, level] : files) {
+        try {
+            auto table = std::make_unique<SSTable<Key, Value>>(
+                mmapManager, filePath, options.blockCache.get(), options.tableCache.get());
+            uint64_t number = manifest->newFileNumber();
+            table->setFileNumber(number, number);
+            edit.addFile(table->getFileMetaData());
+            levels[level].push_back(std::move(table));
+        } catch (const std::exception& ex) {
+            std::cerr << "Failed to load SSTable: " << filePath
+                      << " Error: " << ex.what() << std::endl;
+        }
+    }
+    
+    // Written even for an empty directory so the manifest exists from now on
+    manifest->logAndApply(edit);
+}
+
 template <typename Key, typename Value>
 CompactionManager<Key, Value>::~CompactionManager() {
     // Stop compaction thread
     {
         std::unique_lock<std::mutex> lock(mutex);
         stopRequested = true;
+        dropQueuedCompactions();
         compactionCV.notify_all();
     }
     
@@ -73,8 +121,7 @@ CompactionManager<Key, Value>::~CompactionManager() {
 template <typename Key, typename Value>
 void CompactionManager<Key, Value>::compactionThreadFunc() {
     while (!stopRequested) {
-        int levelToCompact = -1;
-        bool majorCompaction = false;
+        CompactionRequest request{-1, false, std::promise<void>()};
         
         {
             std::unique_lock<std::mutex> lock(mutex);
@@ -88,246 +135,556 @@ void CompactionManager<Key, Value>::compactionThreadFunc() {
                 break;
             }
             
-            auto job = compactionQueue.front();
+            request = std::move(compactionQueue.front());
             compactionQueue.pop();
-            levelToCompact = job.first;
-            majorCompaction = job.second;
+            ++activeCompactions;
+        }
+        
+        if (request.level >= 0) {
+            try {
+                compactLevel(request.level, request.majorCompaction);
+            } catch (const std::exception& ex) {
+                std::cerr << "Compaction of level " << request.level
+                          << " failed: " << ex.what() << std::endl;
+            }
+        }
+        
+        // Publish the result before anyone waiting for the job resumes, so
+        // they see its tables; a failed job completes its future as well
+        if (onCompactionDone) {
+            try {
+                onCompactionDone(getCurrentVersion());
+            } catch (const std::exception& ex) {
+                std::cerr << "Publishing compaction of level " << request.level
+                          << " failed: " << ex.what() << std::endl;
+            }
         }
         
-        if (levelToCompact >= 0) {
-            compactLevel(levelToCompact, majorCompaction);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            --activeCompactions;
         }
+        compactionCV.notify_all();
+        request.done.set_value();
     }
 }
 
 template <typename Key, typename Value>
 bool CompactionManager<Key, Value>::isCompactionNeeded(int level) const {
-    return level < static_cast<int>(levels.size()) && 
-           levels[level].size() > maxTablesPerLevel[level];
+    return strategy->needsCompaction(levels, level);
+}
+
+template <typename Key, typename Value>
+void CompactionManager<Key, Value>::reportCompactionDebt() {
+    if (options.rateLimiter) {
+        double trigger = static_cast<double>(std::max<size_t>(options.level0CompactionTrigger, 1));
+        options.rateLimiter->updateCompactionDebt(static_cast<double>(levels[0].size()) / trigger);
+    }
+}
+
+template <typename Key, typename Value>
+bool CompactionManager<Key, Value>::isBottommost(const CompactionJob<Key, Value>& job) const {
+    auto isInput = [&job](const SSTablePtr& table) {
+        return std::find(job.inputs.begin(), job.inputs.end(), table.get()) != job.inputs.end();
+    };
+    
+    // Key range covered by the inputs
+    std::optional<Key> minKey, maxKey;
+    for (const auto* table : job.inputs) {
+        const auto& meta = table->getMetadata();
+        if (table->empty()) {
+            continue;
+        }
+        if (!minKey || meta.minKey < *minKey) minKey = meta.minKey;
+        if (!maxKey || *maxKey < meta.maxKey) maxKey = meta.maxKey;
+    }
+    if (!minKey) {
+        return true;
+    }
+    auto overlaps = [&](const SSTablePtr& table) {
+        const auto& meta = table->getMetadata();
+        return !table->empty() && !(meta.maxKey < *minKey) && !(*maxKey < meta.minKey);
+    };
+    
+    // Level 0 tables older than the newest input may hold older versions;
+    // when the job starts below level 0 every level 0 table is newer
+    if (job.level == 0) {
+        size_t newestInput = 0;
+        for (size_t i = 0; i < levels[0].size(); ++i) {
+            if (isInput(levels[0][i])) {
+                newestInput = i;
+            }
+        }
+        for (size_t i = 0; i < newestInput; ++i) {
+            if (!isInput(levels[0][i]) && overlaps(levels[0][i])) {
+                return false;
+            }
+        }
+    }
+    
+    // Levels above the job's level only hold newer data
+    for (size_t l = std::max(job.level, 1); l < levels.size(); ++l) {
+        for (const auto& table : levels[l]) {
+            if (!isInput(table) && overlaps(table)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <typename Key, typename Value>
+size_t CompactionManager<Key, Value>::dropCoveredTables() {
+    // Visit tables newest first, collecting the ranges deleted by newer tables
+    RangeTombstoneList<Key> deleted;
+    std::vector<SSTablePtr*> covered;
+    VersionEdit edit;
+    auto visit = [&](SSTablePtr& table) {
+        const auto& meta = table->getMetadata();
+        if (!table->empty() && !deleted.empty() && deleted.covers(meta.minKey, meta.maxKey)) {
+            covered.push_back(&table);
+            edit.deleteFile(static_cast<int>(meta.level), meta.fileNumber);
+        } else {
+            deleted.addAll(table->getRangeTombstones());
+        }
+    };
+    
+    for (auto it = levels[0].rbegin(); it != levels[0].rend(); ++it) {
+        visit(*it);
+    }
+    for (size_t level = 1; level < levels.size(); ++level) {
+        for (auto& table : levels[level]) {
+            visit(table);
+        }
+    }
+    if (covered.empty()) {
+        return 0;
+    }
+    
+    // Forget the tables durably before their files go away
+    manifest->logAndApply(edit);
+    for (auto* table : covered) {
+        (*table)->markObsolete();
+        table->reset();
+    }
+    for (auto& tables : levels) {
+        tables.erase(std::remove(tables.begin(), tables.end(), nullptr), tables.end());
+    }
+    installVersion();
+    reportCompactionDebt();
+    return covered.size();
+}
+
+template <typename Key, typename Value>
+void CompactionManager<Key, Value>::sortLevel(int level) {
+    if (level == 0) {
+        // Tables of one compaction share an epoch; their numbers follow key order
+        std::sort(levels[0].begin(), levels[0].end(),
+                  [](const SSTablePtr& a, const SSTablePtr& b) {
+                      const auto& ma = a->getMetadata();
+                      const auto& mb = b->getMetadata();
+                      return std::make_pair(ma.epoch, ma.fileNumber) < std::make_pair(mb.epoch, mb.fileNumber);
+                  });
+        return;
+    }
+    std::sort(levels[level].begin(), levels[level].end(),
+              [](const SSTablePtr& a, const SSTablePtr& b) {
+                  return a->getMetadata().minKey < b->getMetadata().minKey;
+              });
+}
+
+template <typename Key, typename Value>
+void CompactionManager<Key, Value>::installVersion() {
+    std::atomic_store(&current, std::shared_ptr<const Version<Key, Value>>(
+        std::make_shared<Version<Key, Value>>(levels)));
+}
+
+template <typename Key, typename Value>
+uint64_t CompactionManager<Key, Value>::newFileNumber() {
+    return manifest->newFileNumber();
+}
+
+template <typename Key, typename Value>
+std::string CompactionManager<Key, Value>::tableFilePath(uint64_t number) const {
+    return dataDirectory + "/" + Manifest::tableFileName(number);
 }
 
 template <typename Key, typename Value>
 void CompactionManager<Key, Value>::compactLevel(int level, bool majorCompaction) {
-    if (level >= static_cast<int>(levels.size()) - 1) {
-        // Last level, nothing to compact into
+    if (level < 0 || level >= static_cast<int>(levels.size())) {
         return;
     }
     
-    std::vector<SSTablePtr> tablesToCompact;
-    std::vector<SSTablePtr*> tablePointers;
+    // Inputs stay in their levels (and visible to readers) until the merged
+    // tables replace them
+    CompactionJob<Key, Value> job;
     
     {
         std::unique_lock<std::mutex> lock(mutex);
         
-        if (levels[level].empty()) {
+        dropCoveredTables();
+        
+        if (levels[level].empty() || (!majorCompaction && !isCompactionNeeded(level))) {
             return;
         }
         
-        // For major compaction, take all tables from the level
-        // For minor compaction, take some tables based on size, overlap, etc.
-        if (majorCompaction || isCompactionNeeded(level)) {
-            tablesToCompact.reserve(levels[level].size());
-            
-            // Move all tables from this level for compaction
-            for (auto& table : levels[level]) {
-                tablesToCompact.push_back(std::move(table));
-            }
-            
-            // Clear the level
-            levels[level].clear();
-        } else {
-            // For minor compaction, just take the oldest few tables
-            size_t tablesToTake = std::min(levels[level].size(), size_t(2));
-            tablesToCompact.reserve(tablesToTake);
-            
-            for (size_t i = 0; i < tablesToTake; ++i) {
-                tablesToCompact.push_back(std::move(levels[level][i]));
-            }
-            
-            // Remove the taken tables
-            levels[level].erase(levels[level].begin(), levels[level].begin() + tablesToTake);
+        job = strategy->pickCompaction(levels, level, majorCompaction);
+        if (job.empty()) {
+            return;
         }
-        
-        // If we're compacting level > 0, also include overlapping tables from the next level
-        if (level > 0 && !levels[level + 1].empty()) {
-            // Find key range of tables we're compacting
-            Key minKey = tablesToCompact[0]->getMetadata().minKey;
-            Key maxKey = tablesToCompact[0]->getMetadata().maxKey;
-            
-            for (size_t i = 1; i < tablesToCompact.size(); ++i) {
-                minKey = std::min(minKey, tablesToCompact[i]->getMetadata().minKey);
-                maxKey = std::max(maxKey, tablesToCompact[i]->getMetadata().maxKey);
-            }
-            
-            // Find overlapping tables from the next level
-            std::vector<size_t> overlappingIndexes;
-            for (size_t i = 0; i < levels[level + 1].size(); ++i) {
-                const auto& table = levels[level + 1][i];
-                if (!(table->getMetadata().maxKey < minKey || 
-                      table->getMetadata().minKey > maxKey)) {
-                    overlappingIndexes.push_back(i);
+        job.dropDeletions = isBottommost(job);
+    }
+    
+    // Merge without holding the lock; flushes and reads continue meanwhile
+    SSTableList outputs = runCompaction(job);
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    
+    // Install the result durably first; if that fails the inputs stay live
+    VersionEdit edit;
+    for (const auto* table : job.inputs) {
+        edit.deleteFile(static_cast<int>(table->getMetadata().level), table->getMetadata().fileNumber);
+    }
+    for (const auto& table : outputs) {
+        edit.addFile(table->getFileMetaData());
+    }
+    try {
+        manifest->logAndApply(edit);
+    } catch (...) {
+        for (auto& table : outputs) {
+            table->markObsolete();
+        }
+        throw;
+    }
+    
+    auto isInput = [&job](const SSTablePtr& table) {
+        return std::find(job.inputs.begin(), job.inputs.end(), table.get()) != job.inputs.end();
+    };
+    
+    // Swap the inputs for the merged tables in one step so readers see either
+    // the old or the new version of the level; the inputs' files go away once
+    // no reader holds a Version with them
+    for (int l : {job.level, job.outputLevel}) {
+        auto& tables = levels[l];
+        tables.erase(std::remove_if(tables.begin(), tables.end(),
+            [&isInput](SSTablePtr& table) {
+                if (!isInput(table)) {
+                    return false;
                 }
+                table->markObsolete();
+                return true;
+            }), tables.end());
+    }
+    // Level 0 output carries the newest epoch of its inputs, which puts it
+    // where they were in the age order
+    for (auto& table : outputs) {
+        levels[job.outputLevel].push_back(std::move(table));
+    }
+    sortLevel(job.outputLevel);
+    installVersion();
+    
+    reportCompactionDebt();
+    
+    // The level may still need work, and the output level may now
+    if (isCompactionNeeded(job.level)) {
+        scheduleCompactionLocked(job.level, false);
+    }
+    if (job.outputLevel != job.level && isCompactionNeeded(job.outputLevel)) {
+        scheduleCompactionLocked(job.outputLevel, false);
+    }
+}
+
+template <typename Key, typename Value>
+typename CompactionManager<Key, Value>::SSTableList 
+CompactionManager<Key, Value>::runCompaction(const CompactionJob<Key, Value>& job) {
+    std::vector<Key> boundaries = subcompactionBoundaries(job);
+    if (boundaries.empty()) {
+        return mergeTables(job);
+    }
+    
+    // Subcompaction i covers (boundaries[i-1], boundaries[i]]; the first and
+    // last ranges are open-ended
+    std::vector<std::future<SSTableList>> jobs;
+    for (size_t i = 0; i <= boundaries.size(); ++i) {
+        std::optional<Key> lower = i > 0 ? std::optional<Key>(boundaries[i - 1]) : std::nullopt;
+        std::optional<Key> upper = i < boundaries.size() ? std::optional<Key>(boundaries[i]) : std::nullopt;
+        jobs.push_back(subcompactionPool->submit([this, &job, lower, upper]() {
+            return mergeTables(job, lower, upper);
+        }));
+    }
+    
+    // Wait for every job before reporting a failure; they all read the inputs
+    SSTableList outputs;
+    std::exception_ptr failure;
+    for (auto& job : jobs) {
+        try {
+            for (auto& table : job.get()) {
+                outputs.push_back(std::move(table));
             }
-            
-            // Add overlapping tables to compact list
-            for (auto it = overlappingIndexes.rbegin(); it != overlappingIndexes.rend(); ++it) {
-                tablesToCompact.push_back(std::move(levels[level + 1][*it]));
-            }
-            
-            // Remove overlapping tables from next level
-            for (auto it = overlappingIndexes.rbegin(); it != overlappingIndexes.rend(); ++it) {
-                levels[level + 1].erase(levels[level + 1].begin() + *it);
-            }
+        } catch (...) {
+            failure = std::current_exception();
         }
     }
     
-    // No tables to compact
-    if (tablesToCompact.empty()) {
-        return;
+    if (failure) {
+        for (auto& table : outputs) {
+            table->markObsolete();
+        }
+        std::rethrow_exception(failure);
     }
+    return outputs;
+}
+
+template <typename Key, typename Value>
+std::vector<Key> CompactionManager<Key, Value>::subcompactionBoundaries(
+    const CompactionJob<Key, Value>& job) const {
     
-    // Prepare pointers for merge
-    for (auto& table : tablesToCompact) {
-        tablePointers.push_back(&table);
+    std::vector<Key> boundaries;
+    if (!subcompactionPool || !job.allowSubcompactions) {
+        return boundaries;
     }
     
-    // Merge tables
-    SSTablePtr mergedTable = mergeTables(tablePointers);
+    // Small jobs are not worth splitting
+    uint64_t inputBytes = 0;
+    for (const auto* table : job.inputs) {
+        inputBytes += table->getMetadata().fileSize;
+    }
+    uint64_t targetFileSize = std::max<uint64_t>(job.targetFileSize, 1);
+    size_t ranges = static_cast<size_t>(std::min<uint64_t>(options.maxSubcompactions, inputBytes / targetFileSize));
+    if (ranges < 2) {
+        return boundaries;
+    }
     
-    if (mergedTable) {
-        // Add merged table to the next level
-        std::unique_lock<std::mutex> lock(mutex);
-        levels[level + 1].push_back(std::move(mergedTable));
-        
-        // Check if next level needs compaction
-        if (isCompactionNeeded(level + 1)) {
-            scheduleCompaction(level + 1);
+    // Block boundaries of all inputs approximate the distribution of data
+    std::vector<Key> blockKeys;
+    for (const auto* table : job.inputs) {
+        for (auto& key : table->getBlockLastKeys()) {
+            blockKeys.push_back(std::move(key));
         }
     }
+    std::sort(blockKeys.begin(), blockKeys.end());
+    
+    // A range tombstone must end up in a single subcompaction
+    RangeTombstoneList<Key> deletes;
+    for (const auto* table : job.inputs) {
+        deletes.addAll(table->getRangeTombstones());
+    }
+    
+    for (size_t i = 1; i < ranges; ++i) {
+        const Key& candidate = blockKeys[i * blockKeys.size() / ranges];
+        if ((boundaries.empty() || boundaries.back() < candidate) && !deletes.spans(candidate)) {
+            boundaries.push_back(candidate);
+        }
+    }
+    return boundaries;
 }
 
 template <typename Key, typename Value>
-typename CompactionManager<Key, Value>::SSTablePtr 
-CompactionManager<Key, Value>::mergeTables(const std::vector<SSTablePtr*>& tables) {
-    if (tables.empty()) {
-        return nullptr;
-    }
-    
-    // Create a temporary in-memory store for merging
-    // In a real implementation, we'd use a direct streaming approach
-    // to avoid loading everything into memory
-    MemTable<Key, Value> tempMemTable(1024 * 1024 * 1024); // 1GB limit
-    
-    // Use a custom comparator to merge entries from multiple tables
-    struct KeyValuePair {
-        Key key;
-        Value value;
-        size_t tableIndex;
-        
-        bool operator<(const KeyValuePair& other) const {
-            return key < other.key;
-        }
-    };
+typename CompactionManager<Key, Value>::SSTableList 
+CompactionManager<Key, Value>::mergeTables(const CompactionJob<Key, Value>& job,
+                                           const std::optional<Key>& lower,
+                                           const std::optional<Key>& upper) {
+    SSTableList outputs;
+    if (job.inputs.empty()) {
+        return outputs;
+    }
+    uint32_t targetLevel = static_cast<uint32_t>(job.outputLevel);
     
-    // Collect all entries from all tables
-    // In a real implementation, we'd use a merge iterator instead
-    std::set<KeyValuePair> allEntries;
+    // The output holds data up to the newest flush among the inputs
+    uint64_t epoch = 0;
+    for (const auto* table : job.inputs) {
+        epoch = std::max(epoch, table->getMetadata().epoch);
+    }
     
-    for (size_t i = 0; i < tables.size(); ++i) {
-        const auto& table = *tables[i];
-        
-        table->forEach([&](const Key& key, const Value& value) {
-            allEntries.insert({key, value, i});
-        });
+    // Stream a k-way merge of the inputs straight into the output blocks;
+    // only one block per input and the block being built are held in memory
+    std::vector<typename SSTable<Key, Value>::Iterator> sources;
+    sources.reserve(job.inputs.size());
+    for (const auto* table : job.inputs) {
+        sources.push_back(table->newIterator());
+    }
+    MergingIterator<Key, Value> merged(std::move(sources));
+    
+    // newerDeletes[i] holds the ranges deleted by inputs newer than input i;
+    // an entry coming from input i in those ranges is dead
+    std::vector<RangeTombstoneList<Key>> newerDeletes(job.inputs.size());
+    for (size_t i = 1; i < job.inputs.size(); ++i) {
+        newerDeletes[i] = newerDeletes[i - 1];
+        newerDeletes[i].addAll(job.inputs[i - 1]->getRangeTombstones());
     }
     
-    // Insert all entries into the memtable
-    // If there are duplicate keys, later tables (higher levels) take precedence
-    for (const auto& entry : allEntries) {
-        tempMemTable.put(entry.key, entry.value);
+    // Range tombstones carried into the output: those starting in (lower, upper],
+    // since boundaries never split a range (see subcompactionBoundaries)
+    RangeTombstoneList<Key> outputDeletes;
+    if (!job.dropDeletions) {
+        for (const auto* table : job.inputs) {
+            for (const auto& [start, end] : table->getRangeTombstones()) {
+                if ((!lower || *lower < start) && (!upper || !(*upper < start))) {
+                    outputDeletes.add(start, end);
+                }
+            }
+        }
     }
+    auto nextDelete = outputDeletes.begin();
+    
+    std::unique_ptr<SSTableBuilder<Key, Value>> builder;
+    uint64_t fileNumber = 0;
+    auto openOutput = [&]() {
+        if (!builder) {
+            fileNumber = manifest->newFileNumber();
+            builder = std::make_unique<SSTableBuilder<Key, Value>>(
+                tableFilePath(fileNumber), targetLevel, options, RateLimiter::Priority::Low);
+        }
+    };
+    auto finishOutput = [&]() {
+        builder->finish();
+        outputs.push_back(std::make_unique<SSTable<Key, Value>>(
+            mmapManager, builder->getFilePath(), options.blockCache.get(), options.tableCache.get()));
+        outputs.back()->setFileNumber(fileNumber, epoch);
+        builder.reset();
+    };
     
-    // Calculate target level (one level down)
-    uint32_t targetLevel = (*tables[0])->getMetadata().level + 1;
+    try {
+        if (lower) {
+            merged.seek(*lower);
+            while (merged.valid() && !(*lower < merged.keyView())) {
+                merged.next();
+            }
+        } else {
+            merged.seekToFirst();
+        }
+        
+        for (; merged.valid(); merged.next()) {
+            if (upper && *upper < merged.keyView()) {
+                break;
+            }
+            // The newest version of the key is a tombstone with nothing
+            // older beneath it, so both disappear
+            if (job.dropDeletions && merged.type() == RecordType::Deletion) {
+                continue;
+            }
+            const auto& deletedAbove = newerDeletes[merged.sourceIndex()];
+            if (!deletedAbove.empty() && deletedAbove.covers(merged.key())) {
+                continue;
+            }
+            openOutput();
+            builder->addEncoded(merged.rawKey(), merged.rawValue(), merged.type());
+            
+            // Keys are unique after the merge, so any entry can end a table
+            // unless a range tombstone continues past it
+            if (job.targetFileSize > 0 && builder->fileSize() >= job.targetFileSize) {
+                bool cut = true;
+                if (!outputDeletes.empty()) {
+                    Key key = merged.key();
+                    cut = !outputDeletes.spans(key);
+                    for (; cut && nextDelete != outputDeletes.end() && !(key < nextDelete->first); ++nextDelete) {
+                        builder->addRangeTombstone(nextDelete->first, nextDelete->second);
+                    }
+                }
+                if (cut) {
+                    finishOutput();
+                }
+            }
+        }
+        
+        // Range tombstones after the last entry go into the last table
+        if (nextDelete != outputDeletes.end()) {
+            openOutput();
+            for (; nextDelete != outputDeletes.end(); ++nextDelete) {
+                builder->addRangeTombstone(nextDelete->first, nextDelete->second);
+            }
+        }
+        if (builder) {
+            finishOutput();
+        }
+    } catch (...) {
+        // The inputs stay in place; drop the partial output
+        for (auto& table : outputs) {
+            table->markObsolete();
+        }
+        throw;
+    }
     
-    // Create a new SSTable from the merged data
-    return SSTable<Key, Value>::createFromMemTable(
-        tempMemTable, mmapManager, dataDirectory, targetLevel);
+    return outputs;
 }
 
 template <typename Key, typename Value>
-void CompactionManager<Key, Value>::addTable(SSTablePtr table) {
+void CompactionManager<Key, Value>::addTable(SSTablePtr table, uint64_t logNumber) {
+    // A flush is newer than everything before it, so its number is its epoch
+    if (table->getMetadata().fileNumber == 0) {
+        uint64_t number = manifest->newFileNumber();
+        table->setFileNumber(number, number);
+    }
+    
     std::unique_lock<std::mutex> lock(mutex);
     
+    VersionEdit edit;
+    edit.addFile(table->getFileMetaData());
+    edit.logNumber = logNumber;
+    try {
+        manifest->logAndApply(edit);
+    } catch (...) {
+        table->markObsolete();
+        throw;
+    }
+    
     // Add table to level 0
     levels[0].push_back(std::move(table));
+    sortLevel(0);
+    installVersion();
+    reportCompactionDebt();
     
     // Schedule compaction if needed
     if (isCompactionNeeded(0)) {
-        scheduleCompaction(0);
+        scheduleCompactionLocked(0, false);
     }
 }
 
 template <typename Key, typename Value>
-void CompactionManager<Key, Value>::scheduleCompaction(int level, bool majorCompaction) {
+std::future<void> CompactionManager<Key, Value>::scheduleCompaction(int level, bool majorCompaction) {
     std::unique_lock<std::mutex> lock(mutex);
+    return scheduleCompactionLocked(level, majorCompaction);
+}
+
+template <typename Key, typename Value>
+std::future<void> CompactionManager<Key, Value>::scheduleCompactionLocked(int level, bool majorCompaction) {
+    // No thread is left to run a job once stopped, so it completes right away
+    if (stopRequested) {
+        std::promise<void> done;
+        done.set_value();
+        return done.get_future();
+    }
     
     // Add compaction job to the queue
-    compactionQueue.push({level, majorCompaction});
-    compactionCV.notify_one();
+    compactionQueue.push({level, majorCompaction, std::promise<void>()});
+    auto done = compactionQueue.back().done.get_future();
+    compactionCV.notify_all();
+    return done;
+}
+
+template <typename Key, typename Value>
+void CompactionManager<Key, Value>::dropQueuedCompactions() {
+    while (!compactionQueue.empty()) {
+        compactionQueue.front().done.set_value();
+        compactionQueue.pop();
+    }
+}
+
+template <typename Key, typename Value>
+std::shared_ptr<const Version<Key, Value>> CompactionManager<Key, Value>::getCurrentVersion() const {
+    return std::atomic_load(&current);
 }
 
 template <typename Key, typename Value>
 std::vector<SSTable<Key, Value>*> 
 CompactionManager<Key, Value>::getTablesForKey(const Key& key) {
-    std::vector<SSTable<Key, Value>*> result;
-    std::unique_lock<std::mutex> lock(mutex);
-    
-    // For level 0, check all tables since they might overlap
-    for (const auto& table : levels[0]) {
-        if (table->mayContain(key)) {
-            result.push_back(table.get());
-        }
-    }
-    
-    // For other levels, tables are non-overlapping, so at most one table per level
-    for (size_t level = 1; level < levels.size(); ++level) {
-        for (const auto& table : levels[level]) {
-            if (table->mayContain(key)) {
-                result.push_back(table.get());
-                break;  // Found the table for this level, no need to check more
-            }
-        }
-    }
-    
-    return result;
+    return getCurrentVersion()->getTablesForKey(key);
 }
 
 template <typename Key, typename Value>
 std::vector<SSTable<Key, Value>*> 
 CompactionManager<Key, Value>::getTablesForRange(const Key& startKey, const Key& endKey) {
-    std::vector<SSTable<Key, Value>*> result;
-    std::unique_lock<std::mutex> lock(mutex);
-    
-    // For level 0, check all tables since they might overlap
-    for (const auto& table : levels[0]) {
-        if (!(table->getMetadata().maxKey < startKey || 
-              table->getMetadata().minKey > endKey)) {
-            result.push_back(table.get());
-        }
-    }
-    
-    // For other levels, find all tables that overlap with the range
-    for (size_t level = 1; level < levels.size(); ++level) {
-        for (const auto& table : levels[level]) {
-            if (!(table->getMetadata().maxKey < startKey || 
-                  table->getMetadata().minKey > endKey)) {
-                result.push_back(table.get());
-            }
-        }
-    }
-    
-    return result;
+    return getCurrentVersion()->getTablesForRange(startKey, endKey);
 }
 
 template <typename Key, typename Value>
@@ -335,6 +692,11 @@ size_t CompactionManager<Key, Value>::getLevelCount() const {
     return levels.size();
 }
 
+template <typename Key, typename Value>
+const char* CompactionManager<Key, Value>::getStrategyName() const {
+    return strategy->name();
+}
+
 template <typename Key, typename Value>
 size_t CompactionManager<Key, Value>::getTableCount(int level) const {
     std::unique_lock<std::mutex> lock(mutex);
@@ -346,13 +708,30 @@ size_t CompactionManager<Key, Value>::getTableCount(int level) const {
     return levels[level].size();
 }
 
+template <typename Key, typename Value>
+uint64_t CompactionManager<Key, Value>::getLevelSize(int level) const {
+    std::unique_lock<std::mutex> lock(mutex);
+    
+    if (level < 0 || level >= static_cast<int>(levels.size())) {
+        return 0;
+    }
+    
+    return CompactionStrategy<Key, Value>::totalBytes(levels[level]);
+}
+
+template <typename Key, typename Value>
+uint64_t CompactionManager<Key, Value>::getPendingCompactionBytes() const {
+    std::unique_lock<std::mutex> lock(mutex);
+    return strategy->pendingCompactionBytes(levels);
+}
+
 template <typename Key, typename Value>
 void CompactionManager<Key, Value>::waitForCompactions() {
     std::unique_lock<std::mutex> lock(mutex);
     
-    // Wait until the compaction queue is empty
+    // Wait until the queue is drained and the last job has finished
     compactionCV.wait(lock, [this] {
-        return compactionQueue.empty();
+        return stopRequested || (compactionQueue.empty() && activeCompactions == 0);
     });
 }
 
@@ -364,7 +743,7 @@ void CompactionManager<Key, Value>::shutdown() {
     {
         std::unique_lock<std::mutex> lock(mutex);
         stopRequested = true;
-        compactionQueue = {}; // Clear the queue
+        dropQueuedCompactions();
         compactionCV.notify_all();
     }
     
@@ -385,6 +764,7 @@ void CompactionManager<Key, Value>::shutdown() {
             std::cout << "  Level " << level << ": releasing " << tableCount << " tables..." << std::endl;
             levels[level].clear();
         }
+        installVersion();
     }
     
     std::cout << "CompactionManager shutdown complete." << std::endl;
@@ -0,0 +1,137 @@
+#ifndef COMPACTION_STRATEGY_H
+#define COMPACTION_STRATEGY_H
+
+#include <vector>
+#include <memory>
+#include <optional>
+#include "sstable.h"
+#include "lsm_options.h"
+
+/**
+ * CompactionJob - Inputs and placement chosen by a CompactionStrategy
+ */
+template <typename Key, typename Value>
+struct CompactionJob {
+    // Level the job was picked for and level that receives the output
+    int level = -1;
+    int outputLevel = -1;
+
+    // Input tables, newest first
+    std::vector<SSTable<Key, Value>*> inputs;
+
+    // Cut output tables at this size (0 keeps each key range in one table)
+    uint64_t targetFileSize = 0;
+
+    // Whether the merge may be split into parallel key ranges
+    bool allowSubcompactions = false;
+
+    // Set by the manager when no older data overlaps the inputs, so
+    // tombstones have nothing left to hide and are not written out
+    bool dropDeletions = false;
+
+    bool empty() const { return inputs.empty(); }
+};
+
+/**
+ * CompactionStrategy - Decides when and what CompactionManager compacts
+ *
+ * Strategies see the tables of every level (level 0 oldest first, deeper
+ * levels sorted by key) and are called with the manager's mutex held, so
+ * they may keep private state without further locking.
+ */
+template <typename Key, typename Value>
+class CompactionStrategy {
+public:
+    using SSTableList = std::vector<std::shared_ptr<SSTable<Key, Value>>>;
+
+    virtual ~CompactionStrategy() = default;
+
+    virtual const char* name() const = 0;
+
+    // Whether the level should be compacted now
+    virtual bool needsCompaction(const std::vector<SSTableList>& levels, int level) const = 0;
+
+    // Choose the inputs for a compaction of the level; an empty job means nothing to do.
+    // A major compaction pushes the whole level down (or merges all runs).
+    virtual CompactionJob<Key, Value> pickCompaction(const std::vector<SSTableList>& levels,
+                                                     int level, bool majorCompaction) = 0;
+
+    // Estimate of the bytes compaction has to rewrite before no level needs it
+    virtual uint64_t pendingCompactionBytes(const std::vector<SSTableList>& levels) const = 0;
+
+    // Total file size of a list of tables
+    static uint64_t totalBytes(const SSTableList& tables);
+};
+
+/**
+ * LeveledCompactionStrategy - Each level below 0 is one sorted run
+ *
+ * Level 0 compacts once it holds level0CompactionTrigger tables; deeper
+ * levels compact when they exceed a byte budget that starts at
+ * maxBytesForLevelBase and grows by levelSizeMultiplier per level. Inputs
+ * are picked per table and merged with the overlapping tables of the next
+ * level. Lowest read and space amplification, highest write amplification.
+ */
+template <typename Key, typename Value>
+class LeveledCompactionStrategy : public CompactionStrategy<Key, Value> {
+public:
+    using typename CompactionStrategy<Key, Value>::SSTableList;
+
+    explicit LeveledCompactionStrategy(const LSMOptions& options);
+
+    const char* name() const override { return "leveled"; }
+    bool needsCompaction(const std::vector<SSTableList>& levels, int level) const override;
+    CompactionJob<Key, Value> pickCompaction(const std::vector<SSTableList>& levels,
+                                             int level, bool majorCompaction) override;
+    uint64_t pendingCompactionBytes(const std::vector<SSTableList>& levels) const override;
+
+private:
+    LSMOptions options;
+
+    // Byte budget per level (level 0 counts tables instead)
+    std::vector<uint64_t> maxBytesPerLevel;
+
+    // Per level, the largest key of the last table picked for a minor compaction,
+    // so successive compactions rotate through the key space
+    std::vector<std::optional<Key>> compactPointer;
+};
+
+/**
+ * UniversalCompactionStrategy - Size-tiered merging of sorted runs
+ *
+ * Every level 0 table is a sorted run, and merged runs stay in level 0 in
+ * their place in the age order. Starting from the newest run, older runs
+ * are added while each is no larger than the accumulated size plus
+ * universalSizeRatio percent; at least universalMinMergeWidth runs are
+ * merged. If no such group exists but there are more than universalMaxRuns
+ * runs, the newest runs are merged to get back under the limit. Data is
+ * rewritten far less often than with leveled compaction, at the cost of more
+ * runs to consult on reads.
+ */
+template <typename Key, typename Value>
+class UniversalCompactionStrategy : public CompactionStrategy<Key, Value> {
+public:
+    using typename CompactionStrategy<Key, Value>::SSTableList;
+
+    explicit UniversalCompactionStrategy(const LSMOptions& options);
+
+    const char* name() const override { return "universal"; }
+    bool needsCompaction(const std::vector<SSTableList>& levels, int level) const override;
+    CompactionJob<Key, Value> pickCompaction(const std::vector<SSTableList>& levels,
+                                             int level, bool majorCompaction) override;
+    uint64_t pendingCompactionBytes(const std::vector<SSTableList>& levels) const override;
+
+private:
+    LSMOptions options;
+
+    // Number of newest runs to merge (0 if none qualify)
+    size_t runsToMerge(const SSTableList& runs) const;
+};
+
+// Create the strategy selected by options.compactionStyle
+template <typename Key, typename Value>
+std::unique_ptr<CompactionStrategy<Key, Value>> createCompactionStrategy(const LSMOptions& options);
+
+#include "compaction_strategy.tpp"
+
+#endif // COMPACTION_STRATEGY_H
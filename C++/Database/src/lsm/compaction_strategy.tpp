@@ -0,0 +1,223 @@
+#ifndef COMPACTION_STRATEGY_TPP
+#define COMPACTION_STRATEGY_TPP
+
+#include "compaction_strategy.h"
+#include <algorithm>
+
+template <typename Key, typename Value>
+uint64_t CompactionStrategy<Key, Value>::totalBytes(const SSTableList& tables) {
+    uint64_t total = 0;
+    for (const auto& table : tables) {
+        total += table->getMetadata().fileSize;
+    }
+    return total;
+}
+
+// LeveledCompactionStrategy implementation
+
+template <typename Key, typename Value>
+LeveledCompactionStrategy<Key, Value>::LeveledCompactionStrategy(const LSMOptions& options)
+    : options(options) {
+    
+    // Level 1 holds maxBytesForLevelBase, each deeper level levelSizeMultiplier times more
+    int numLevels = std::max(options.numLevels, 2);
+    maxBytesPerLevel.assign(numLevels, 0);
+    double budget = static_cast<double>(options.maxBytesForLevelBase);
+    for (int level = 1; level < numLevels; ++level) {
+        maxBytesPerLevel[level] = static_cast<uint64_t>(budget);
+        budget *= options.levelSizeMultiplier;
+    }
+    compactPointer.resize(numLevels);
+}
+
+template <typename Key, typename Value>
+bool LeveledCompactionStrategy<Key, Value>::needsCompaction(
+    const std::vector<SSTableList>& levels, int level) const {
+    
+    if (level < 0 || level >= static_cast<int>(levels.size()) - 1) {
+        // The last level has nowhere to compact into
+        return false;
+    }
+    if (level == 0) {
+        return levels[0].size() >= options.level0CompactionTrigger;
+    }
+    return this->totalBytes(levels[level]) > maxBytesPerLevel[level];
+}
+
+template <typename Key, typename Value>
+CompactionJob<Key, Value> LeveledCompactionStrategy<Key, Value>::pickCompaction(
+    const std::vector<SSTableList>& levels, int level, bool majorCompaction) {
+    
+    CompactionJob<Key, Value> job;
+    if (level < 0 || level >= static_cast<int>(levels.size()) - 1 || levels[level].empty()) {
+        return job;
+    }
+    job.level = level;
+    job.outputLevel = level + 1;
+    job.targetFileSize = options.targetFileSize;
+    job.allowSubcompactions = true;
+    
+    if (level == 0 || majorCompaction) {
+        // Level 0 tables overlap, so they all move down together; tables are
+        // appended oldest first, so walk backwards for recency.
+        // A major compaction pushes the whole level down.
+        for (size_t i = levels[level].size(); i-- > 0;) {
+            job.inputs.push_back(levels[level][i].get());
+        }
+    } else {
+        // Pick the next table after the previous compaction's key range,
+        // wrapping around, so the whole level is rewritten gradually
+        const auto& tables = levels[level];
+        size_t pick = 0;
+        if (compactPointer[level]) {
+            const Key& pointer = *compactPointer[level];
+            while (pick < tables.size() && !(pointer < tables[pick]->getMetadata().minKey)) {
+                ++pick;
+            }
+            if (pick == tables.size()) {
+                pick = 0;
+            }
+        }
+        job.inputs.push_back(tables[pick].get());
+        compactPointer[level] = tables[pick]->getMetadata().maxKey;
+    }
+    
+    // Find key range of tables we're compacting
+    Key minKey = job.inputs[0]->getMetadata().minKey;
+    Key maxKey = job.inputs[0]->getMetadata().maxKey;
+    for (size_t i = 1; i < job.inputs.size(); ++i) {
+        minKey = std::min(minKey, job.inputs[i]->getMetadata().minKey);
+        maxKey = std::max(maxKey, job.inputs[i]->getMetadata().maxKey);
+    }
+    
+    // Pull in only the tables of the next level that overlap that range
+    // (all older than the inputs above) so the next level stays non-overlapping
+    for (const auto& table : levels[level + 1]) {
+        if (!(table->getMetadata().maxKey < minKey || 
+              table->getMetadata().minKey > maxKey)) {
+            job.inputs.push_back(table.get());
+        }
+    }
+    
+    return job;
+}
+
+template <typename Key, typename Value>
+uint64_t LeveledCompactionStrategy<Key, Value>::pendingCompactionBytes(
+    const std::vector<SSTableList>& levels) const {
+    
+    uint64_t pending = 0;
+    
+    // Level 0 is merged with the whole of level 1
+    uint64_t incoming = 0;
+    if (levels[0].size() >= options.level0CompactionTrigger) {
+        incoming = this->totalBytes(levels[0]);
+        pending += incoming + (levels.size() > 1 ? this->totalBytes(levels[1]) : 0);
+    }
+    
+    // Bytes over a level's budget move down and are merged with about
+    // levelSizeMultiplier times as many bytes of the next level; what moves
+    // down counts against the next level's budget too
+    for (size_t level = 1; level + 1 < levels.size(); ++level) {
+        uint64_t size = this->totalBytes(levels[level]) + incoming;
+        incoming = 0;
+        if (size > maxBytesPerLevel[level]) {
+            incoming = size - maxBytesPerLevel[level];
+            pending += static_cast<uint64_t>(static_cast<double>(incoming) * (1.0 + options.levelSizeMultiplier));
+        }
+    }
+    return pending;
+}
+
+// UniversalCompactionStrategy implementation
+
+template <typename Key, typename Value>
+UniversalCompactionStrategy<Key, Value>::UniversalCompactionStrategy(const LSMOptions& options)
+    : options(options) {
+}
+
+template <typename Key, typename Value>
+size_t UniversalCompactionStrategy<Key, Value>::runsToMerge(const SSTableList& runs) const {
+    size_t minWidth = std::max<size_t>(options.universalMinMergeWidth, 2);
+    if (runs.size() < std::max(options.level0CompactionTrigger, minWidth)) {
+        return 0;
+    }
+    
+    // Size ratio: grow a group of similarly sized runs from the newest one
+    size_t count = 1;
+    uint64_t accumulated = runs.back()->getMetadata().fileSize;
+    while (count < runs.size()) {
+        uint64_t next = runs[runs.size() - 1 - count]->getMetadata().fileSize;
+        if (static_cast<double>(next) >
+            static_cast<double>(accumulated) * (100.0 + options.universalSizeRatio) / 100.0) {
+            break;
+        }
+        accumulated += next;
+        ++count;
+    }
+    if (count >= minWidth) {
+        return count;
+    }
+    
+    // Max runs: merge just enough of the newest runs to get back under the limit
+    size_t maxRuns = std::max<size_t>(options.universalMaxRuns, 1);
+    if (runs.size() > maxRuns) {
+        return std::max<size_t>(runs.size() - maxRuns + 1, 2);
+    }
+    return 0;
+}
+
+template <typename Key, typename Value>
+bool UniversalCompactionStrategy<Key, Value>::needsCompaction(
+    const std::vector<SSTableList>& levels, int level) const {
+    return level == 0 && runsToMerge(levels[0]) > 0;
+}
+
+template <typename Key, typename Value>
+CompactionJob<Key, Value> UniversalCompactionStrategy<Key, Value>::pickCompaction(
+    const std::vector<SSTableList>& levels, int level, bool majorCompaction) {
+    
+    CompactionJob<Key, Value> job;
+    if (level != 0) {
+        return job;
+    }
+    
+    const auto& runs = levels[0];
+    size_t count = majorCompaction ? runs.size() : runsToMerge(runs);
+    if (count < 2) {
+        return job;
+    }
+    
+    // Runs are appended oldest first; merge the newest ones and keep the
+    // result in level 0 so it stays ordered between older and newer runs
+    job.level = 0;
+    job.outputLevel = 0;
+    for (size_t i = 0; i < count; ++i) {
+        job.inputs.push_back(runs[runs.size() - 1 - i].get());
+    }
+    return job;
+}
+
+template <typename Key, typename Value>
+uint64_t UniversalCompactionStrategy<Key, Value>::pendingCompactionBytes(
+    const std::vector<SSTableList>& levels) const {
+    
+    // The newest runs the next merge would take
+    const auto& runs = levels[0];
+    size_t count = runsToMerge(runs);
+    uint64_t pending = 0;
+    for (size_t i = 0; i < count; ++i) {
+        pending += runs[runs.size() - 1 - i]->getMetadata().fileSize;
+    }
+    return pending;
+}
+
+template <typename Key, typename Value>
+std::unique_ptr<CompactionStrategy<Key, Value>> createCompactionStrategy(const LSMOptions& options) {
+    if (options.compactionStyle == CompactionStyle::Universal) {
+        return std::make_unique<UniversalCompactionStrategy<Key, Value>>(options);
+    }
+    return std::make_unique<LeveledCompactionStrategy<Key, Value>>(options);
+}
+
+#endif // COMPACTION_STRATEGY_TPP
@@ -0,0 +1,235 @@
+#include "compression.h"
+#include "coding.h"
+#include <cstring>
+#include <vector>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+/**
+ * LZ codec - byte-oriented LZ77 in the style of LZ4
+ *
+ * Output: varint uncompressed length, then a series of sequences:
+ *   token (literal length << 4 | (match length - 4)), extra literal length
+ *   bytes, literals, fixed16 match offset, extra match length bytes
+ * A nibble of 15 means more length follows in 255-saturated bytes. The final
+ * sequence carries only literals.
+ */
+class LZCodec : public CompressionCodec {
+public:
+    static constexpr size_t MIN_MATCH = 4;
+    static constexpr size_t MAX_OFFSET = 65535;
+    static constexpr int HASH_BITS = 12;
+    // The last bytes are always emitted as literals so matches never read past the end
+    static constexpr size_t END_LITERALS = 5;
+
+    CompressionType type() const override { return CompressionType::LZ; }
+    const char* name() const override { return "lz"; }
+
+    bool compress(std::string_view input, std::string& output) const override {
+        output.clear();
+        output.reserve(input.size() + input.size() / 255 + 16);
+        putVarint64(output, input.size());
+
+        const auto* base = reinterpret_cast<const unsigned char*>(input.data());
+        const size_t size = input.size();
+        size_t anchor = 0;
+
+        if (size > MIN_MATCH + END_LITERALS) {
+            std::vector<uint32_t> table(1u << HASH_BITS, 0);
+            const size_t matchLimit = size - END_LITERALS;
+            size_t pos = 1;
+            table[hash(base)] = 0;
+
+            while (pos + MIN_MATCH <= matchLimit) {
+                uint32_t h = hash(base + pos);
+                size_t candidate = table[h];
+                table[h] = static_cast<uint32_t>(pos);
+
+                if (candidate >= pos || pos - candidate > MAX_OFFSET ||
+                    std::memcmp(base + candidate, base + pos, MIN_MATCH) != 0) {
+                    ++pos;
+                    continue;
+                }
+
+                // Extend the match forward
+                size_t matchLength = MIN_MATCH;
+                while (pos + matchLength < matchLimit &&
+                       base[candidate + matchLength] == base[pos + matchLength]) {
+                    ++matchLength;
+                }
+
+                emitSequence(output, base + anchor, pos - anchor,
+                             static_cast<uint16_t>(pos - candidate), matchLength);
+
+                pos += matchLength;
+                anchor = pos;
+                if (pos >= 2 && pos + MIN_MATCH <= matchLimit) {
+                    table[hash(base + pos - 2)] = static_cast<uint32_t>(pos - 2);
+                }
+            }
+        }
+
+        // Trailing literals
+        size_t literals = size - anchor;
+        output.push_back(static_cast<char>((literals >= 15 ? 15 : literals) << 4));
+        if (literals >= 15) {
+            putLength(output, literals - 15);
+        }
+        output.append(reinterpret_cast<const char*>(base + anchor), literals);
+        return true;
+    }
+
+    bool decompress(std::string_view input, std::string& output) const override {
+        const char* ptr = input.data();
+        const char* limit = ptr + input.size();
+        uint64_t expected = 0;
+        ptr = getVarint64(ptr, limit, &expected);
+        if (!ptr) {
+            return false;
+        }
+
+        output.clear();
+        output.reserve(expected);
+
+        while (ptr < limit) {
+            unsigned char token = static_cast<unsigned char>(*ptr++);
+
+            size_t literals = token >> 4;
+            if (literals == 15 && !readLength(ptr, limit, literals)) {
+                return false;
+            }
+            if (static_cast<size_t>(limit - ptr) < literals || output.size() + literals > expected) {
+                return false;
+            }
+            output.append(ptr, literals);
+            ptr += literals;
+
+            if (ptr == limit) {
+                break;  // Last sequence has no match
+            }
+
+            if (limit - ptr < 2) {
+                return false;
+            }
+            size_t offset = static_cast<unsigned char>(ptr[0]) |
+                            (static_cast<size_t>(static_cast<unsigned char>(ptr[1])) << 8);
+            ptr += 2;
+
+            size_t matchLength = token & 0x0f;
+            if (matchLength == 15 && !readLength(ptr, limit, matchLength)) {
+                return false;
+            }
+            matchLength += MIN_MATCH;
+
+            if (offset == 0 || offset > output.size() || output.size() + matchLength > expected) {
+                return false;
+            }
+
+            // Byte-by-byte copy handles overlapping matches (run-length patterns)
+            size_t from = output.size() - offset;
+            for (size_t i = 0; i < matchLength; ++i) {
+                output.push_back(output[from + i]);
+            }
+        }
+
+        return output.size() == expected;
+    }
+
+private:
+    static uint32_t hash(const unsigned char* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return (v * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    static void putLength(std::string& output, size_t length) {
+        while (length >= 255) {
+            output.push_back(static_cast<char>(255));
+            length -= 255;
+        }
+        output.push_back(static_cast<char>(length));
+    }
+
+    static bool readLength(const char*& ptr, const char* limit, size_t& length) {
+        unsigned char byte;
+        do {
+            if (ptr >= limit) {
+                return false;
+            }
+            byte = static_cast<unsigned char>(*ptr++);
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    static void emitSequence(std::string& output, const unsigned char* literals, size_t literalLength,
+                             uint16_t offset, size_t matchLength) {
+        size_t matchCode = matchLength - MIN_MATCH;
+        unsigned char token = static_cast<unsigned char>(
+            ((literalLength >= 15 ? 15 : literalLength) << 4) | (matchCode >= 15 ? 15 : matchCode));
+        output.push_back(static_cast<char>(token));
+        if (literalLength >= 15) {
+            putLength(output, literalLength - 15);
+        }
+        output.append(reinterpret_cast<const char*>(literals), literalLength);
+        output.push_back(static_cast<char>(offset & 0xff));
+        output.push_back(static_cast<char>(offset >> 8));
+        if (matchCode >= 15) {
+            putLength(output, matchCode - 15);
+        }
+    }
+};
+
+#ifdef HAVE_ZSTD
+class ZstdCodec : public CompressionCodec {
+public:
+    static constexpr int LEVEL = 3;
+
+    CompressionType type() const override { return CompressionType::Zstd; }
+    const char* name() const override { return "zstd"; }
+
+    bool compress(std::string_view input, std::string& output) const override {
+        output.resize(ZSTD_compressBound(input.size()));
+        size_t written = ZSTD_compress(&output[0], output.size(), input.data(), input.size(), LEVEL);
+        if (ZSTD_isError(written)) {
+            return false;
+        }
+        output.resize(written);
+        return true;
+    }
+
+    bool decompress(std::string_view input, std::string& output) const override {
+        unsigned long long expected = ZSTD_getFrameContentSize(input.data(), input.size());
+        if (expected == ZSTD_CONTENTSIZE_ERROR || expected == ZSTD_CONTENTSIZE_UNKNOWN) {
+            return false;
+        }
+        output.resize(static_cast<size_t>(expected));
+        size_t read = ZSTD_decompress(&output[0], output.size(), input.data(), input.size());
+        return !ZSTD_isError(read) && read == output.size();
+    }
+};
+#endif
+
+} // namespace
+
+const CompressionCodec* getCompressionCodec(CompressionType type) {
+    static const LZCodec lzCodec;
+#ifdef HAVE_ZSTD
+    static const ZstdCodec zstdCodec;
+#endif
+
+    switch (type) {
+        case CompressionType::LZ:
+            return &lzCodec;
+#ifdef HAVE_ZSTD
+        case CompressionType::Zstd:
+            return &zstdCodec;
+#endif
+        default:
+            return nullptr;
+    }
+}
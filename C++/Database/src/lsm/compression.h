@@ -0,0 +1,43 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Block compression codecs for SSTable data blocks
+ *
+ * The codec id is stored in each block's trailer, so tables written with
+ * different codecs (or none) can be read side by side.
+ */
+enum class CompressionType : uint8_t {
+    None = 0,
+    LZ = 1,    // Built-in LZ77-style codec, no external dependency
+    Zstd = 2   // Available when zstd was found at configure time (HAVE_ZSTD)
+};
+
+class CompressionCodec {
+public:
+    virtual ~CompressionCodec() = default;
+    
+    virtual CompressionType type() const = 0;
+    virtual const char* name() const = 0;
+    
+    /**
+     * Compress input into output (output is overwritten)
+     * @return false if the codec could not produce output
+     */
+    virtual bool compress(std::string_view input, std::string& output) const = 0;
+    
+    /**
+     * Decompress input into output (output is overwritten)
+     * @return false if the input is malformed
+     */
+    virtual bool decompress(std::string_view input, std::string& output) const = 0;
+};
+
+// Codec for a type, or nullptr if it is unknown or not built in
+const CompressionCodec* getCompressionCodec(CompressionType type);
+
+#endif // COMPRESSION_H
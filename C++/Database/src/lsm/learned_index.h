@@ -0,0 +1,118 @@
+#ifndef LEARNED_INDEX_H
+#define LEARNED_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "serializer.h"
+
+/**
+ * LearnedIndexTraits - Key types a learned index can model
+ *
+ * A learned index needs keys that map monotonically onto numbers; arithmetic
+ * types do, other key types use the regular index block only.
+ */
+template <typename Key, typename Enable = void>
+struct LearnedIndexTraits {
+    static constexpr bool supported = false;
+};
+
+template <typename Key>
+struct LearnedIndexTraits<Key, std::enable_if_t<std::is_arithmetic_v<Key>>> {
+    static constexpr bool supported = true;
+
+    static double position(const Key& key) { return static_cast<double>(key); }
+};
+
+/**
+ * LearnedIndex - Piecewise-linear model from a key to its data block
+ *
+ * The model is fitted at SSTable write time over the last key of every data
+ * block. Each segment predicts a block position as a linear function of the
+ * key, and every block's last key is predicted within epsilon positions of
+ * where it is. A lookup finds the segment, predicts a position and searches
+ * only a window of about 2 * epsilon entries around it; if floating point
+ * rounding ever moves the answer outside the window, it falls back to a
+ * binary search within the segment.
+ *
+ * Serialized form (keys in Serializer<Key> form, fixed width):
+ *   [entries]   per block:   key | fixed64 offset | fixed64 size
+ *   [segments]  per segment: first key | fixed32 first block | fixed64 slope | fixed64 intercept
+ *   [trailer]   fixed32 numBlocks | fixed32 numSegments | fixed32 epsilon
+ * Slopes and intercepts are IEEE doubles stored by bit pattern.
+ *
+ * Only instantiated for keys with LearnedIndexTraits<Key>::supported.
+ */
+template <typename Key>
+class LearnedIndex {
+public:
+    static constexpr size_t KEY_SIZE = sizeof(Key);
+    static constexpr size_t ENTRY_SIZE = KEY_SIZE + 16;
+    static constexpr size_t SEGMENT_SIZE = KEY_SIZE + 20;
+    static constexpr size_t TRAILER_SIZE = 12;
+
+    /**
+     * Builder - Collects block entries in key order and fits the model
+     */
+    class Builder {
+    public:
+        explicit Builder(uint32_t epsilon);
+
+        // Record a data block by its encoded last key; keys must increase
+        void add(std::string_view lastKeyBytes, uint64_t offset, uint64_t size);
+
+        bool empty() const { return keys.empty(); }
+
+        // Fit the segments and return the serialized index
+        std::string finish() const;
+
+    private:
+        uint32_t epsilon;
+        std::vector<Key> keys;
+        std::string entries;
+    };
+
+    LearnedIndex() = default;
+
+    // Wrap a serialized index; the bytes must outlive this object
+    LearnedIndex(const char* data, size_t size);
+
+    // False if the serialized form is malformed
+    bool ok() const { return valid; }
+
+    bool empty() const { return numBlocks == 0; }
+
+    size_t blockCount() const { return numBlocks; }
+    size_t segmentCount() const { return numSegments; }
+
+    /**
+     * Locate the first block whose last key is >= key
+     * @return false if every block ends before key
+     */
+    bool find(const Key& key, uint64_t* offset, uint64_t* size) const;
+
+private:
+    const char* entries = nullptr;
+    const char* segments = nullptr;
+    uint32_t numBlocks = 0;
+    uint32_t numSegments = 0;
+    uint32_t epsilon = 0;
+    bool valid = false;
+
+    static uint64_t doubleBits(double value);
+    static double bitsToDouble(uint64_t bits);
+
+    Key entryKey(size_t index) const;
+    Key segmentKey(size_t index) const;
+    uint32_t segmentFirstBlock(size_t index) const;
+
+    // Position of the first entry in [lo, hi) whose key is >= key (hi if none)
+    size_t lowerBound(const Key& key, size_t lo, size_t hi) const;
+};
+
+#include "learned_index.tpp"
+
+#endif // LEARNED_INDEX_H
@@ -0,0 +1,194 @@
+#ifndef LEARNED_INDEX_TPP
+#define LEARNED_INDEX_TPP
+
+#include "learned_index.h"
+#include "coding.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+template <typename Key>
+uint64_t LearnedIndex<Key>::doubleBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+template <typename Key>
+double LearnedIndex<Key>::bitsToDouble(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+template <typename Key>
+LearnedIndex<Key>::Builder::Builder(uint32_t epsilon) : epsilon(epsilon) {
+}
+
+template <typename Key>
+void LearnedIndex<Key>::Builder::add(std::string_view lastKeyBytes, uint64_t offset, uint64_t size) {
+    keys.push_back(Serializer<Key>::decode(lastKeyBytes.data(), lastKeyBytes.size()));
+    entries.append(lastKeyBytes.data(), lastKeyBytes.size());
+    putFixed64(entries, offset);
+    putFixed64(entries, size);
+}
+
+template <typename Key>
+std::string LearnedIndex<Key>::Builder::finish() const {
+    using Traits = LearnedIndexTraits<Key>;
+    std::string out = entries;
+    
+    // Greedy shrinking cone: extend the segment while some slope keeps every
+    // point within epsilon of its position, otherwise start a new one
+    const double eps = static_cast<double>(epsilon);
+    uint32_t segmentCount = 0;
+    size_t start = 0;
+    while (start < keys.size()) {
+        double x0 = Traits::position(keys[start]);
+        double y0 = static_cast<double>(start);
+        double lo = 0.0;
+        double hi = std::numeric_limits<double>::infinity();
+        size_t end = start + 1;
+        for (; end < keys.size(); ++end) {
+            double dx = Traits::position(keys[end]) - x0;
+            double dy = static_cast<double>(end) - y0;
+            if (dx <= 0.0) {
+                // Keys too close to tell apart as doubles
+                if (dy > eps) break;
+                continue;
+            }
+            double newLo = std::max(lo, (dy - eps) / dx);
+            double newHi = std::min(hi, (dy + eps) / dx);
+            if (newLo > newHi) {
+                break;
+            }
+            lo = newLo;
+            hi = newHi;
+        }
+        double slope = std::isinf(hi) ? lo : (lo + hi) / 2;
+        
+        Serializer<Key>::encode(keys[start], out);
+        putFixed32(out, static_cast<uint32_t>(start));
+        putFixed64(out, doubleBits(slope));
+        putFixed64(out, doubleBits(y0));
+        ++segmentCount;
+        start = end;
+    }
+    
+    putFixed32(out, static_cast<uint32_t>(keys.size()));
+    putFixed32(out, segmentCount);
+    putFixed32(out, epsilon);
+    return out;
+}
+
+template <typename Key>
+LearnedIndex<Key>::LearnedIndex(const char* data, size_t size) {
+    if (size < TRAILER_SIZE) {
+        return;
+    }
+    const char* trailer = data + size - TRAILER_SIZE;
+    uint32_t blocks = decodeFixed32(trailer);
+    uint32_t segs = decodeFixed32(trailer + 4);
+    if (static_cast<uint64_t>(blocks) * ENTRY_SIZE + static_cast<uint64_t>(segs) * SEGMENT_SIZE + TRAILER_SIZE != size ||
+        (blocks > 0 && segs == 0)) {
+        return;
+    }
+    entries = data;
+    segments = data + blocks * ENTRY_SIZE;
+    numBlocks = blocks;
+    numSegments = segs;
+    epsilon = decodeFixed32(trailer + 8);
+    valid = true;
+}
+
+template <typename Key>
+Key LearnedIndex<Key>::entryKey(size_t index) const {
+    return Serializer<Key>::decode(entries + index * ENTRY_SIZE, KEY_SIZE);
+}
+
+template <typename Key>
+Key LearnedIndex<Key>::segmentKey(size_t index) const {
+    return Serializer<Key>::decode(segments + index * SEGMENT_SIZE, KEY_SIZE);
+}
+
+template <typename Key>
+uint32_t LearnedIndex<Key>::segmentFirstBlock(size_t index) const {
+    return decodeFixed32(segments + index * SEGMENT_SIZE + KEY_SIZE);
+}
+
+template <typename Key>
+size_t LearnedIndex<Key>::lowerBound(const Key& key, size_t lo, size_t hi) const {
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (entryKey(mid) < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+template <typename Key>
+bool LearnedIndex<Key>::find(const Key& key, uint64_t* offset, uint64_t* size) const {
+    if (numBlocks == 0) {
+        return false;
+    }
+    
+    // The last segment starting at or before the key
+    size_t lo = 0, hi = numSegments;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (key < segmentKey(mid)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    
+    size_t position;
+    if (lo == 0) {
+        // Before the first block's last key
+        position = 0;
+    } else {
+        size_t segment = lo - 1;
+        size_t first = segmentFirstBlock(segment);
+        size_t last = segment + 1 < numSegments ? segmentFirstBlock(segment + 1) : numBlocks;
+        
+        // The answer lies in [first, last]: the next segment starts above the key
+        const char* seg = segments + segment * SEGMENT_SIZE + KEY_SIZE + 4;
+        double slope = bitsToDouble(decodeFixed64(seg));
+        double intercept = bitsToDouble(decodeFixed64(seg + 8));
+        double dx = LearnedIndexTraits<Key>::position(key) - LearnedIndexTraits<Key>::position(segmentKey(segment));
+        double predicted = intercept + slope * dx;
+        if (!std::isfinite(predicted)) {
+            predicted = static_cast<double>(first);
+        }
+        
+        // Any key between two block keys is predicted between their positions,
+        // so the answer is within epsilon + 1 of the prediction
+        double window = static_cast<double>(epsilon) + 1.0;
+        double from = std::clamp(std::floor(predicted - window), static_cast<double>(first), static_cast<double>(last));
+        double to = std::clamp(std::ceil(predicted + window) + 1.0, static_cast<double>(first), static_cast<double>(last));
+        size_t windowLo = static_cast<size_t>(from);
+        size_t windowHi = static_cast<size_t>(to);
+        
+        position = lowerBound(key, windowLo, windowHi);
+        bool bracketed = (windowLo == first || entryKey(windowLo - 1) < key) &&
+                         (position < windowHi || windowHi == last || !(entryKey(windowHi) < key));
+        if (!bracketed) {
+            position = lowerBound(key, first, last);
+        }
+    }
+    
+    if (position >= numBlocks) {
+        return false;
+    }
+    const char* entry = entries + position * ENTRY_SIZE + KEY_SIZE;
+    *offset = decodeFixed64(entry);
+    *size = decodeFixed64(entry + 8);
+    return true;
+}
+
+#endif // LEARNED_INDEX_TPP
@@ -0,0 +1,158 @@
+#ifndef LSM_OPTIONS_H
+#define LSM_OPTIONS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "compression.h"
+#include "block_cache.h"
+#include "table_cache.h"
+#include "rate_limiter.h"
+
+// How CompactionManager shapes the tree (see compaction_strategy.h)
+enum class CompactionStyle {
+    Leveled,    // One sorted run per level, bounded read amplification
+    Universal   // Size-tiered runs in level 0, bounded write amplification
+};
+
+// Structure that holds the entries of a memtable (see memtable_rep.h)
+enum class MemTableType {
+    Map,        // std::map behind a mutex
+    SkipList    // Lock-free skiplist in an arena; concurrent writers do not block
+};
+
+// When appends to the write-ahead log reach stable storage (see wal.h)
+enum class WALSyncMode {
+    None,       // Handed to the OS only; survives a process crash, not a power loss
+    PerBatch,   // One fdatasync per group commit
+    Interval    // fdatasync at most once per walSyncIntervalMs; a write reaches
+                // stable storage within about walSyncIntervalMs, even if no
+                // other write follows it
+};
+
+/**
+ * LSMOptions - Tunables shared by the LSM-Tree, its SSTables and compaction
+ */
+struct LSMOptions {
+    // Representation of new memtables
+    MemTableType memTableType = MemTableType::SkipList;
+    
+    // Log every write to the write-ahead log segment of its memtable, so
+    // writes that were not flushed yet are replayed after a crash
+    bool enableWAL = true;
+    
+    // Sync policy of the write-ahead log; concurrent writers share a sync
+    WALSyncMode walSyncMode = WALSyncMode::PerBatch;
+    uint64_t walSyncIntervalMs = 100;
+    
+    // With a skiplist memtable, writers whose single writes were logged
+    // together apply them to the memtable concurrently instead of leaving it
+    // all to the leader of the group
+    bool concurrentMemTableWrites = true;
+    
+    // Write stalls: when flushes or compactions fall behind by one of these
+    // measures, write groups are first delayed and then held until the
+    // backlog shrinks below the stop threshold (0 disables a threshold).
+    // Immutable memtables waiting to be flushed
+    size_t memTableSlowdownWritesTrigger = 4;
+    size_t memTableStopWritesTrigger = 8;
+    
+    // Level 0 tables (universal: sorted runs)
+    size_t level0SlowdownWritesTrigger = 20;
+    size_t level0StopWritesTrigger = 36;
+    
+    // Bytes compaction would have to rewrite to bring every level within its budget
+    uint64_t softPendingCompactionBytesLimit = 64ULL * 1024 * 1024 * 1024;
+    uint64_t hardPendingCompactionBytesLimit = 256ULL * 1024 * 1024 * 1024;
+    
+    // Rate delayed writes are held to at a slowdown threshold; it falls
+    // towards a sixteenth as the backlog approaches the stop threshold
+    // (0 lets delayed writes through unthrottled)
+    int64_t delayedWriteRate = 16 * 1024 * 1024;
+    
+    // Threads that write immutable memtables to SSTables in parallel; the
+    // tables are still installed in level 0 oldest memtable first
+    size_t maxBackgroundFlushes = 2;
+    
+    // Threads that read and check log segments in parallel on open, one
+    // segment ahead each; the records are still applied in segment order
+    size_t walRecoveryThreads = 4;
+    
+    // Bloom filter bits per key for new SSTables (0 disables the filter)
+    // 10 bits gives roughly a 1% false positive rate
+    size_t bloomBitsPerKey = 10;
+    
+    // Target size of an SSTable data block before it is cut (4-16 KB works well)
+    size_t blockSize = 4 * 1024;
+    
+    // Number of keys between restart points in a data block
+    int blockRestartInterval = 16;
+    
+    // Maximum position error of the learned index fitted over the data blocks
+    // of tables with arithmetic keys (0 disables it; lookups then binary search
+    // the index block)
+    uint32_t learnedIndexEpsilon = 4;
+    
+    // Codec for new data blocks; blocks that do not shrink are stored raw
+    CompressionType compression = CompressionType::LZ;
+    
+    // Compaction policy for the tree
+    CompactionStyle compactionStyle = CompactionStyle::Leveled;
+    
+    // Compaction output is cut into tables of about this size
+    uint64_t targetFileSize = 8 * 1024 * 1024;
+    
+    // Number of level 0 tables (universal: sorted runs) that triggers a compaction
+    size_t level0CompactionTrigger = 4;
+    
+    // Byte budget of level 1; each deeper level gets levelSizeMultiplier times more
+    uint64_t maxBytesForLevelBase = 64 * 1024 * 1024;
+    double levelSizeMultiplier = 10.0;
+    
+    // Number of levels, including level 0
+    int numLevels = 7;
+    
+    // Universal: a run joins a merge group if it is at most this many percent
+    // larger than the group so far
+    int universalSizeRatio = 1;
+    
+    // Universal: fewest runs merged by a size-ratio compaction
+    size_t universalMinMergeWidth = 2;
+    
+    // Universal: merge the newest runs whenever there are more runs than this
+    size_t universalMaxRuns = 8;
+    
+    // A compaction of at least two target files is split into up to this many
+    // key ranges that are merged concurrently (1 disables subcompactions)
+    int maxSubcompactions = 4;
+    
+    // Capacity of the block cache an LSMTree creates when none is supplied (0 disables it)
+    size_t blockCacheCapacity = 32 * 1024 * 1024;
+    
+    // Cache of decoded blocks; pass the same instance to several trees to share one budget
+    std::shared_ptr<BlockCache> blockCache;
+    
+    // Limits of the table cache an LSMTree creates when none is supplied: the
+    // least recently used tables are closed beyond this many open tables or
+    // mapped bytes (0 means no limit; both 0 keeps every table open)
+    size_t maxOpenTables = 1000;
+    uint64_t maxMappedBytes = 0;
+    
+    // Open tables; pass the same instance to several trees to share the limits
+    std::shared_ptr<TableCache> tableCache;
+    
+    // Write budget for flushes and compactions an LSMTree creates its rate
+    // limiter with when none is supplied (0 leaves background writes unthrottled)
+    int64_t rateLimitBytesPerSec = 0;
+    
+    // Let the write budget grow with the level 0 backlog, up to this rate (0 disables)
+    int64_t rateLimitMaxBytesPerSec = 0;
+    
+    // Rate limiter shared by the flush thread and compaction workers
+    std::shared_ptr<RateLimiter> rateLimiter;
+    
+    // Edits appended to a manifest before it is rewritten as a single snapshot
+    size_t maxManifestEdits = 1024;
+};
+
+#endif // LSM_OPTIONS_H
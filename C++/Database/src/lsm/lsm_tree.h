@@ -4,13 +4,37 @@
 #include "memtable.h"
 #include "sstable.h"
 #include "compaction.h"
+#include "lsm_options.h"
+#include "wal.h"
+#include "write_batch.h"
 #include "../storage/mmap_manager.h"
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <deque>
+#include <thread>
 #include <vector>
 #include <string>
 #include <optional>
 #include <atomic>
+#include <chrono>
+#include <future>
+
+// Whether writes are held back because flushes or compactions fell behind
+enum class WriteStallCondition {
+    Normal,
+    Delayed,    // Past a slowdown threshold: write groups are rate limited
+    Stopped     // Past a stop threshold: write groups wait for the backlog to shrink
+};
+
+// Measure of the backlog that caused a write stall
+enum class WriteStallCause {
+    None,
+    MemTables,               // Immutable memtables waiting to be flushed
+    Level0Tables,            // Level 0 tables waiting to be compacted
+    PendingCompactionBytes   // Bytes compaction has to rewrite
+};
 
 /**
  * LSMTree - Log-Structured Merge Tree implementation
@@ -20,60 +44,332 @@
  * - Persistent storage via SSTables
  * - Background compaction for performance maintenance
  * - Write-ahead logging for durability
+ *
+ * Every write is appended to the write-ahead log segment of the active
+ * memtable before it is applied, and a memtable's segment is deleted once its
+ * SSTable is recorded in the manifest. A segment that fails an append is
+ * replaced by a new one, so an I/O error fails only the write group that
+ * hit it. On open, the segments that are not obsolete are read and checked
+ * in parallel a few segments ahead, replayed record by record in order into
+ * memtables, and flushed in the background while the tree serves requests.
+ *
+ * A pool of flush workers writes immutable memtables to SSTables in
+ * parallel. Each worker takes the oldest memtable no one is flushing yet,
+ * and finished tables are installed in level 0 strictly oldest memtable
+ * first, so a newer table never sits below an older one.
+ *
+ * Concurrent writers queue up: the writer at the head of the queue leads a
+ * group of the batches queued behind it, logs them as one record, and
+ * applies them, or has each writer apply its own batch concurrently, before
+ * waking the followers with the result. Writes carry sequence numbers in log
+ * order, so the memtable resolves writes to the same key the way a replay
+ * of the log would.
+ *
+ * Before committing, a leader checks the flush and compaction backlog
+ * against the write stall thresholds of LSMOptions: past a slowdown
+ * threshold the group is paced by a rate limiter that slows down further as
+ * the backlog grows, and past a stop threshold it waits until a flush or
+ * compaction brings the backlog back down. The queue behind the leader
+ * waits with it, so writers cannot outrun the background threads.
+ *
+ * Reads go through a SuperVersion: an immutable, reference-counted snapshot
+ * of the active memtable, the immutable memtables and the table Version,
+ * replaced atomically whenever one of them changes. A reader takes it with
+ * one atomic load and holds no lock while searching, so memtable switches,
+ * flushes and compactions never block reads or close a table under them.
+ * Along with the SuperVersion a reader takes the sequence number of the
+ * last visible write, which the leader of a group advances only once every
+ * write of the group is applied, and reads the memtables as of that
+ * sequence number. Writes applied after it are skipped, so readers see a
+ * batch all at once without waiting for or retrying around writers.
  */
 template <typename Key, typename Value>
 class LSMTree {
+public:
+    // Startup metrics of the last open
+    struct RecoveryStats {
+        uint64_t segments = 0;            // Log segments replayed
+        uint64_t records = 0;             // Log records replayed
+        uint64_t bytes = 0;               // Size of the replayed segments
+        uint64_t tornSegments = 0;        // Segments that ended in a torn or corrupt record
+        uint64_t recoveredMemTables = 0;  // Memtables filled by the replay
+        uint64_t replayMicros = 0;        // Reading, checking and applying the segments
+        uint64_t openMicros = 0;          // Whole constructor, until requests are served
+        uint64_t flushMicros = 0;         // Until the recovered memtables were flushed (0 while pending)
+    };
+    
+    // Write stall state and counters
+    struct WriteStallStats {
+        // Condition a write would meet now, and the backlog behind it
+        WriteStallCondition condition = WriteStallCondition::Normal;
+        WriteStallCause cause = WriteStallCause::None;
+        size_t immutableMemTables = 0;
+        size_t level0Tables = 0;
+        uint64_t pendingCompactionBytes = 0;
+        
+        // Write groups delayed or stopped, indexed by WriteStallCause
+        uint64_t delays[4] = {};
+        uint64_t stops[4] = {};
+        
+        // Time write groups spent delayed and stopped
+        uint64_t delayMicros = 0;
+        uint64_t stopMicros = 0;
+        
+        // Rate the last delayed group was held to
+        int64_t delayedWriteRate = 0;
+    };
+    
 private:
-    // Current active memtable for writes
-    std::unique_ptr<MemTable<Key, Value>> activeMemTable;
+    // Current active memtable for writes; memtables are shared with the
+    // SuperVersions that readers hold
+    std::shared_ptr<MemTable<Key, Value>> activeMemTable;
+    
+    // Write-ahead log segment of the active memtable (null if disabled)
+    std::unique_ptr<WriteAheadLog> activeLog;
+    
+    // A memtable waiting to be flushed, with the log segment of its writes
+    struct ImmutableMemTable {
+        ImmutableMemTable() = default;
+        ImmutableMemTable(std::shared_ptr<MemTable<Key, Value>> memtable, std::unique_ptr<WriteAheadLog> log,
+                          uint64_t nextLogNumber)
+            : memtable(std::move(memtable)), log(std::move(log)), nextLogNumber(nextLogNumber) {}
+        
+        std::shared_ptr<MemTable<Key, Value>> memtable;
+        std::unique_ptr<WriteAheadLog> log;
+        
+        // Oldest log segment still needed once the memtable is flushed
+        // (0 if the flush does not make any segment obsolete)
+        uint64_t nextLogNumber = 0;
+        
+        // Set when a flush worker takes the memtable, along with the number
+        // of its table; numbers are handed out oldest memtable first, so
+        // level 0 epochs follow the age of the data
+        bool flushing = false;
+        uint64_t fileNumber = 0;
+        
+        // Level 0 epoch of the table: the file number of the first attempt,
+        // kept when a failed flush is retried under a new file number
+        uint64_t epoch = 0;
+        
+        // Failed flush attempts; a failed memtable stays queued, readable and
+        // logged, and is retried after a pause
+        size_t failures = 0;
+        
+        // Set when the worker is done; the table (null if it could not be
+        // written) waits here until the older memtables are installed
+        bool built = false;
+        std::unique_ptr<SSTable<Key, Value>> table;
+        
+        // Fulfilled once the table is installed and the log segments it made
+        // obsolete are deleted, with true; or with false when a flush of it
+        // or an older memtable fails, after which a new promise waits for
+        // the retry. The future is taken when a caller first waits for the
+        // memtable
+        std::promise<bool> installed;
+        std::shared_future<bool> installedFuture;
+    };
     
-    // Immutable memtables waiting to be flushed to disk
-    std::vector<std::unique_ptr<MemTable<Key, Value>>> immutableMemTables;
+    // Immutable memtables waiting to be flushed to disk, oldest first
+    std::vector<ImmutableMemTable> immutableMemTables;
+    
+    // Paces delayed write groups (null if delayedWriteRate is 0)
+    std::unique_ptr<RateLimiter> writeController;
+    
+    // Stopped leaders wait on stallCV; flushes and compactions notify it
+    // under stallMutex, which also guards stallStats (declared before the
+    // compaction manager, whose thread notifies it)
+    mutable std::mutex stallMutex;
+    std::condition_variable stallCV;
+    WriteStallStats stallStats;
+    
+    // Memory-mapped file manager (declared first so it outlives the SSTables)
+    std::unique_ptr<MMapManager> mmapManager;
     
     // Compaction manager for SSTables
     std::unique_ptr<CompactionManager<Key, Value>> compactionManager;
     
-    // Memory-mapped file manager
-    std::unique_ptr<MMapManager> mmapManager;
+    // Everything a read consults, as of the last memtable switch, flush or compaction
+    struct SuperVersion {
+        std::shared_ptr<MemTable<Key, Value>> activeMemTable;
+        std::vector<std::shared_ptr<MemTable<Key, Value>>> immutableMemTables;  // Newest first
+        std::shared_ptr<const Version<Key, Value>> tables;
+    };
+    
+    // Swapped atomically; readers copy it and never wait for a lock
+    std::shared_ptr<const SuperVersion> superVersion;
     
-    // Custom memory allocator
-    std::unique_ptr<MemoryAllocator> allocator;
+    // Sequence number of the last write readers may see; advanced past a
+    // write group once all of it is applied, under logMutex
+    std::atomic<uint64_t> visibleSequence;
     
     // Settings
     std::string dataDirectory;
     size_t memTableSizeBytes;
+    LSMOptions options;
+    
+    // Protects the memtable pointers and the flush queue; switching
+    // memtables and publishing a SuperVersion take it exclusively. Reads do
+    // not take it.
+    mutable std::shared_mutex mutex;
+    
+    // A batch waiting in the write queue
+    struct Writer {
+        const WriteBatch<Key, Value>* batch = nullptr;
+        bool done = false;
+        bool ok = false;
+        std::condition_variable cv;
+        
+        // Set by the leader to have the writer apply its own batch
+        MemTable<Key, Value>* memtable = nullptr;
+        uint64_t sequence = 0;      // Sequence number of the batch's first write
+        size_t* pending = nullptr;  // Writers of the group still applying
+        Writer* leader = nullptr;
+    };
+    
+    // Most writes a leader takes into its group, unless its own batch is larger
+    static constexpr size_t MAX_GROUP_WRITES = 4096;
     
-    // Mutex for protecting memtable operations
-    std::mutex mutex;
+    // Write queue; the writer at the front leads the next group
+    std::mutex writeMutex;
+    std::deque<Writer*> writers;
     
-    // Background flushing thread state
-    std::thread flushThread;
-    std::condition_variable flushCV;
+    // Held by the leader from logging a group until it is applied, and to
+    // switch memtables, so a group always lands in the memtable of the
+    // segment that logged it
+    std::mutex logMutex;
+    
+    // Sequence number of the last logged write; guarded by logMutex
+    uint64_t lastSequence;
+    
+    // Startup metrics; a flush worker sets flushMicros under the mutex
+    std::chrono::steady_clock::time_point openStart;
+    RecoveryStats recoveryStats;
+    size_t recoveryFlushesPending;
+    
+    // Background flush workers
+    std::vector<std::thread> flushThreads;
+    std::condition_variable_any flushCV;
     std::atomic<bool> stopRequested;
     
-    // Background flushing thread function
+    // Held while installing flushed tables, so only one worker installs at a time
+    std::mutex installMutex;
+    
+    // Pause before retrying a failed flush, per failure so far (at most MAX_FLUSH_RETRY_DELAY)
+    static constexpr std::chrono::milliseconds FLUSH_RETRY_DELAY{100};
+    static constexpr std::chrono::milliseconds MAX_FLUSH_RETRY_DELAY{2000};
+    
+    // Flush worker function
     void flushThreadFunc();
     
-    // Create a new memtable
-    std::unique_ptr<MemTable<Key, Value>> createMemTable();
+    // Stop the flush workers once nothing is left to flush, and join them
+    void stopFlushThreads();
     
-    // Flush an immutable memtable to disk
-    void flushMemTable(MemTable<Key, Value>* memtable);
+    // Create a new memtable of the configured type
+    std::shared_ptr<MemTable<Key, Value>> createMemTable();
+    
+    // Publish the current memtables and the given tables as the
+    // SuperVersion; the caller holds the mutex exclusively
+    void installSuperVersion(std::shared_ptr<const Version<Key, Value>> tables);
+    
+    // SuperVersion for a read, and in *sequence the last write it may see
+    // in the memtables
+    std::shared_ptr<const SuperVersion> acquireSuperVersion(uint64_t* sequence) const;
+    
+    // Search the memtables of a SuperVersion for a key as of sequence, newest first
+    LookupResult lookupMemTables(const SuperVersion& version, uint64_t sequence, const Key& key,
+                                 Value& value) const;
+    
+    // Create a new write-ahead log segment; throws if it cannot be created
+    std::unique_ptr<WriteAheadLog> createLog();
+    
+    // Queue the active memtable for flushing and start a new one with a new
+    // log segment; the caller holds the mutex exclusively
+    void switchMemTable();
+    
+    // Move writes off a segment that failed an append: seal it with the
+    // active memtable, or drop it if the memtable is empty, and start a new
+    // segment; the caller holds the mutex exclusively. Throws like createLog
+    void replaceFailedLog();
+    
+    // Replay the log segments left by the last run into memtables queued
+    // for flushing
+    void recoverLogs();
+    
+    // Write an immutable memtable to a level 0 table; null on failure
+    std::unique_ptr<SSTable<Key, Value>> buildTable(MemTable<Key, Value>* memtable, uint64_t fileNumber,
+                                                    uint64_t epoch);
+    
+    // Install the built tables at the front of immutableMemTables, oldest
+    // first, marking the log segments their memtables no longer need
+    // obsolete in the same manifest edit. Installation stops at a failed
+    // flush, which is queued for a retry, so the manifest never moves past
+    // a segment whose writes are in no table
+    void installFlushedTables();
+    
+    // Queue the oldest memtable for another flush attempt and fail the
+    // futures waiting on it and on newer memtables; the caller holds the
+    // mutex exclusively
+    void retryFailedFlush();
+    
+    // Measure the backlog into stats and return the condition it calls for;
+    // severity tells how far a delayed write is from a stop (0 to 1)
+    WriteStallCondition checkWriteStall(WriteStallStats& stats, double* severity) const;
+    
+    // Delay or hold a write group as the backlog requires; called by its
+    // leader before committing the group
+    void delayWrite(const std::vector<Writer*>& group);
+    
+    // Wake stopped writers to check the backlog again
+    void notifyWriteStall();
+    
+    // Log and apply the batches of a write group; called by its leader
+    bool commitGroup(const std::vector<Writer*>& group);
+    
+    // Apply one write of a batch to a memtable, regardless of its memory limit
+    static void applyEntry(const typename WriteBatch<Key, Value>::Entry& entry, uint64_t sequence,
+                           MemTable<Key, Value>& memtable);
+    
+    // Apply a batch whose writes are numbered from sequence on
+    static void applyBatch(const WriteBatch<Key, Value>& batch, uint64_t sequence,
+                           MemTable<Key, Value>& memtable);
 
 public:
-    LSMTree(const std::string& directory, size_t memTableSizeMB = 64);
+    LSMTree(const std::string& directory, size_t memTableSizeMB = 64,
+            const LSMOptions& options = LSMOptions());
     ~LSMTree();
     
     // Write operations
     bool put(const Key& key, const Value& value);
+    
+    // Write a tombstone that hides every older version of the key
     bool remove(const Key& key);
     
+    // Delete every key in [startKey, endKey] with one range tombstone
+    bool deleteRange(const Key& startKey, const Key& endKey);
+    
+    // Log the batch in one record and apply it to one memtable; its writes
+    // become visible to readers together, so they see all of it or none of it
+    bool write(const WriteBatch<Key, Value>& batch);
+    
     // Read operations
     std::optional<Value> get(const Key& key);
     std::vector<std::pair<Key, Value>> range(const Key& startKey, const Key& endKey);
     
     // Administrative operations
+    
+    // Queue the active memtable for flushing; the future is ready, with
+    // true, once it and every older memtable are in SSTables and their log
+    // segments are deleted, or with false as soon as one of those flushes
+    // fails (the memtables stay queued, and the flush is retried)
+    std::shared_future<bool> flushAsync();
+    
+    // Schedule a compaction; the future is ready once it is installed
+    std::future<void> compactAsync(int level = 0, bool majorCompaction = true);
+    
+    // Flush every memtable and wait for it
     void flush();
+    
+    // Compact a level; a major compaction waits until it is installed
     void compact(int level = 0, bool majorCompaction = true);
     void clear(); // Add method to properly clean up resources
     
@@ -81,6 +377,9 @@ public:
     size_t getMemTableSize() const;
     size_t getImmutableMemTableCount() const;
     std::vector<size_t> getSSTableCountsByLevel() const;
+    BlockCache::Stats getBlockCacheStats() const;
+    RecoveryStats getRecoveryStats() const;
+    WriteStallStats getWriteStallStats() const;
 };
 
 #include "lsm_tree.tpp"
@@ -2,155 +2,818 @@
 #define LSM_TREE_TPP
 
 #include "lsm_tree.h"
+#include <algorithm>
 #include <filesystem>
+#include <future>
 #include <thread>
 
 template <typename Key, typename Value>
-LSMTree<Key, Value>::LSMTree(const std::string& directory, size_t memTableSizeMB)
-    : dataDirectory(directory), memTableSizeBytes(memTableSizeMB * 1024 * 1024), stopRequested(false) {
+LSMTree<Key, Value>::LSMTree(const std::string& directory, size_t memTableSizeMB,
+                             const LSMOptions& options)
+    : visibleSequence(0), dataDirectory(directory), memTableSizeBytes(memTableSizeMB * 1024 * 1024),
+      options(options), lastSequence(0), openStart(std::chrono::steady_clock::now()), recoveryFlushesPending(0),
+      stopRequested(false) {
     
     // Create data directory if it doesn't exist
     std::filesystem::create_directories(directory);
     
     // Initialize components
-    allocator = std::make_unique<MemoryAllocator>();
     mmapManager = std::make_unique<MMapManager>();
     
+    // All SSTables of this tree share one block cache
+    if (!this->options.blockCache && this->options.blockCacheCapacity > 0) {
+        this->options.blockCache = std::make_shared<BlockCache>(this->options.blockCacheCapacity);
+    }
+    
+    // Open tables count against one table cache
+    if (!this->options.tableCache && (this->options.maxOpenTables > 0 || this->options.maxMappedBytes > 0)) {
+        this->options.tableCache = std::make_shared<TableCache>(
+            this->options.maxOpenTables, static_cast<size_t>(this->options.maxMappedBytes));
+    }
+    
+    // Flushes and compactions share one write budget
+    if (!this->options.rateLimiter && this->options.rateLimitBytesPerSec > 0) {
+        this->options.rateLimiter = std::make_shared<RateLimiter>(
+            this->options.rateLimitBytesPerSec, this->options.rateLimitMaxBytesPerSec);
+    }
+    
+    // Delayed write groups are paced separately from background writes
+    if (this->options.delayedWriteRate > 0) {
+        writeController = std::make_unique<RateLimiter>(this->options.delayedWriteRate);
+    }
+    
     // Create the active memtable
     activeMemTable = createMemTable();
     
-    // Initialize compaction manager
+    // Initialize compaction manager; readers pick up the tables of a finished
+    // compaction, which may also end a write stall
     compactionManager = std::make_unique<CompactionManager<Key, Value>>(
-        mmapManager.get(), dataDirectory);
+        mmapManager.get(), dataDirectory, this->options,
+        [this](std::shared_ptr<const Version<Key, Value>> tables) {
+            {
+                std::unique_lock<std::shared_mutex> lock(mutex);
+                installSuperVersion(std::move(tables));
+            }
+            notifyWriteStall();
+        });
+    
+    // Writes of the last run that never reached a table are flushed in the
+    // background; reads see them in the meantime
+    recoverLogs();
+    visibleSequence.store(lastSequence);
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        installSuperVersion(compactionManager->getCurrentVersion());
+    }
     
-    // Start background flush thread
-    flushThread = std::thread(&LSMTree::flushThreadFunc, this);
+    // Start the flush workers
+    size_t flushWorkers = std::max<size_t>(this->options.maxBackgroundFlushes, 1);
+    for (size_t i = 0; i < flushWorkers; ++i) {
+        flushThreads.emplace_back(&LSMTree::flushThreadFunc, this);
+    }
+    
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    recoveryStats.openMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - openStart).count();
 }
 
 template <typename Key, typename Value>
 LSMTree<Key, Value>::~LSMTree() {
-    // Signal flush thread to stop and wait for it
-    stopRequested = true;
-    flushCV.notify_all();
+    // Flush any remaining memtables while the flush workers are still running
+    if (!flushThreads.empty()) {
+        flush();
+    }
+    stopFlushThreads();
     
-    if (flushThread.joinable()) {
-        flushThread.join();
+    // Every write is in a table now, so the active segment is not needed
+    if (activeLog && activeMemTable && activeMemTable->size() == 0) {
+        std::string path = activeLog->getPath();
+        activeLog.reset();
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
     }
     
-    // Flush any remaining memtables
-    flush();
+    // Stop the compaction thread while the members its callback uses are alive
+    compactionManager.reset();
+    superVersion.reset();
+}
+
+template <typename Key, typename Value>
+std::shared_ptr<MemTable<Key, Value>> LSMTree<Key, Value>::createMemTable() {
+    return std::make_shared<MemTable<Key, Value>>(memTableSizeBytes, options.memTableType);
+}
+
+template <typename Key, typename Value>
+void LSMTree<Key, Value>::installSuperVersion(std::shared_ptr<const Version<Key, Value>> tables) {
+    auto version = std::make_shared<SuperVersion>();
+    version->activeMemTable = activeMemTable;
+    for (auto it = immutableMemTables.rbegin(); it != immutableMemTables.rend(); ++it) {
+        version->immutableMemTables.push_back(it->memtable);
+    }
+    version->tables = std::move(tables);
+    std::atomic_store(&superVersion, std::shared_ptr<const SuperVersion>(std::move(version)));
+}
+
+template <typename Key, typename Value>
+std::shared_ptr<const typename LSMTree<Key, Value>::SuperVersion> LSMTree<Key, Value>::acquireSuperVersion(
+    uint64_t* sequence) const {
+    // Loaded after the SuperVersion: its immutable memtables and tables were
+    // complete when it was installed, and the bound hides any write to its
+    // active memtable that is still being applied
+    auto version = std::atomic_load(&superVersion);
+    *sequence = visibleSequence.load(std::memory_order_acquire);
+    return version;
+}
+
+template <typename Key, typename Value>
+LookupResult LSMTree<Key, Value>::lookupMemTables(const SuperVersion& version, uint64_t sequence,
+                                                  const Key& key, Value& value) const {
+    LookupResult result = version.activeMemTable->lookup(key, value, sequence);
+    for (auto it = version.immutableMemTables.begin();
+         result == LookupResult::NotFound && it != version.immutableMemTables.end(); ++it) {
+        result = (*it)->lookup(key, value, sequence);
+    }
+    return result;
 }
 
 template <typename Key, typename Value>
-std::unique_ptr<MemTable<Key, Value>> LSMTree<Key, Value>::createMemTable() {
-    return std::make_unique<MemTable<Key, Value>>(memTableSizeBytes, allocator.get());
+std::unique_ptr<WriteAheadLog> LSMTree<Key, Value>::createLog() {
+    uint64_t number = compactionManager->newFileNumber();
+    std::string path = (std::filesystem::path(dataDirectory) / Manifest::logFileName(number)).string();
+    return std::make_unique<WriteAheadLog>(path, number, options.walSyncMode, options.walSyncIntervalMs);
+}
+
+template <typename Key, typename Value>
+void LSMTree<Key, Value>::recoverLogs() {
+    auto replayStart = std::chrono::steady_clock::now();
+    Manifest* manifest = compactionManager->getManifest();
+    auto logs = manifest->getLiveLogFiles();
+    
+    // Checked records of one segment
+    struct Segment {
+        std::string contents;
+        bool intact = true;
+    };
+    
+    // Workers read and check the segments ahead of this thread, which decodes
+    // each record straight into the active memtable, oldest segment first.
+    // Besides the segment being applied, each worker holds at most one
+    size_t threads = std::max<size_t>(1, std::min(options.walRecoveryThreads, logs.size()));
+    std::deque<std::future<Segment>> segments;
+    {
+        ThreadPool pool(threads);
+        auto next = logs.begin();
+        auto submitNext = [&] {
+            manifest->markFileNumberUsed(next->first);
+            segments.push_back(pool.submit([path = next->second]() {
+                Segment segment;
+                segment.intact = WriteAheadLog::read(path, segment.contents);
+                return segment;
+            }));
+            ++next;
+        };
+        while (segments.size() < threads && next != logs.end()) {
+            submitNext();
+        }
+        
+        // Wait for every submitted segment before reporting a failure
+        std::exception_ptr failure;
+        WriteBatch<Key, Value> writes;
+        for (auto log = logs.begin(); !segments.empty(); ++log) {
+            const std::string& path = log->second;
+            std::future<Segment> future = std::move(segments.front());
+            segments.pop_front();
+            try {
+                Segment segment = future.get();
+                if (failure) {
+                    continue;
+                }
+                if (next != logs.end()) {
+                    submitNext();
+                }
+                
+                // Segments are replayed into as many memtables as they fill
+                uint64_t records = 0;
+                uint64_t malformed = 0;
+                WriteAheadLog::forEachRecord(segment.contents, [&](std::string_view record) {
+                    records++;
+                    writes.clear();
+                    if (!writes.decode(record)) {
+                        malformed++;
+                    }
+                    for (const auto& entry : writes.getEntries()) {
+                        applyEntry(entry, ++lastSequence, *activeMemTable);
+                        if (activeMemTable->isFull()) {
+                            activeMemTable->makeImmutable();
+                            immutableMemTables.emplace_back(std::move(activeMemTable), nullptr, 0);
+                            activeMemTable = createMemTable();
+                        }
+                    }
+                });
+                
+                if (malformed > 0) {
+                    std::cerr << "Skipped " << malformed << " malformed records in "
+                              << path << std::endl;
+                }
+                if (!segment.intact) {
+                    std::cerr << "Write-ahead log " << path << " ends in a torn record; "
+                              << "recovered the writes before it" << std::endl;
+                    recoveryStats.tornSegments++;
+                }
+                recoveryStats.segments++;
+                recoveryStats.records += records;
+                std::error_code ec;
+                recoveryStats.bytes += std::filesystem::file_size(path, ec);
+            } catch (...) {
+                failure = std::current_exception();
+            }
+        }
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+    }
+    
+    if (options.enableWAL) {
+        activeLog = createLog();
+    }
+    
+    if (activeMemTable->size() > 0) {
+        activeMemTable->makeImmutable();
+        immutableMemTables.emplace_back(std::move(activeMemTable), nullptr, 0);
+        activeMemTable = createMemTable();
+    }
+    
+    if (!immutableMemTables.empty()) {
+        // Once the last recovered memtable is flushed, every replayed segment is obsolete
+        immutableMemTables.back().nextLogNumber =
+            activeLog ? activeLog->getNumber() : compactionManager->newFileNumber();
+    } else {
+        // Nothing to recover
+        std::error_code ec;
+        for (const auto& [number, path] : logs) {
+            std::filesystem::remove(path, ec);
+        }
+    }
+    
+    recoveryStats.recoveredMemTables = immutableMemTables.size();
+    recoveryFlushesPending = immutableMemTables.size();
+    recoveryStats.replayMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - replayStart).count();
 }
 
 template <typename Key, typename Value>
 void LSMTree<Key, Value>::flushThreadFunc() {
-    while (!stopRequested) {
-        std::unique_ptr<MemTable<Key, Value>> tableToFlush;
+    while (true) {
+        MemTable<Key, Value>* tableToFlush = nullptr;
+        uint64_t fileNumber = 0;
+        uint64_t epoch = 0;
         
         {
-            std::unique_lock<std::mutex> lock(mutex);
+            std::unique_lock<std::shared_mutex> lock(mutex);
             
-            // Wait until we have an immutable memtable to flush or stop is requested
-            flushCV.wait(lock, [this] {
-                return stopRequested || !immutableMemTables.empty();
+            // Wait until a memtable needs a worker or stop is requested. A
+            // failed memtable is not retried once stopping; its log segment
+            // is replayed on the next open instead
+            auto unclaimed = [this] {
+                return std::find_if(immutableMemTables.begin(), immutableMemTables.end(),
+                                    [this](const ImmutableMemTable& entry) {
+                                        return !entry.flushing && (entry.failures == 0 || !stopRequested);
+                                    });
+            };
+            flushCV.wait(lock, [&] {
+                return stopRequested || unclaimed() != immutableMemTables.end();
             });
             
-            if (stopRequested && immutableMemTables.empty()) {
+            // Workers keep going until every memtable is taken, even when stopping
+            auto it = unclaimed();
+            if (it == immutableMemTables.end()) {
                 break;
             }
             
-            if (!immutableMemTables.empty()) {
-                // Take the oldest immutable memtable for flushing
-                tableToFlush = std::move(immutableMemTables.front());
-                immutableMemTables.erase(immutableMemTables.begin());
+            // Take the oldest memtable no one is flushing; it stays readable
+            // until its SSTable is installed
+            it->flushing = true;
+            
+            // Give a failing flush (a full disk, say) time to clear up
+            if (it->failures > 0) {
+                uint64_t epoch = it->epoch;
+                std::chrono::milliseconds delay = std::min<std::chrono::milliseconds>(
+                    FLUSH_RETRY_DELAY * it->failures, MAX_FLUSH_RETRY_DELAY);
+                flushCV.wait_for(lock, delay, [this] { return stopRequested.load(); });
+                
+                // The entry may have moved while the lock was released
+                it = std::find_if(immutableMemTables.begin(), immutableMemTables.end(),
+                                  [epoch](const ImmutableMemTable& entry) { return entry.epoch == epoch; });
+                if (stopRequested) {
+                    it->flushing = false;
+                    continue;
+                }
+            }
+            
+            it->fileNumber = compactionManager->newFileNumber();
+            if (it->epoch == 0) {
+                it->epoch = it->fileNumber;
             }
+            tableToFlush = it->memtable.get();
+            fileNumber = it->fileNumber;
+            epoch = it->epoch;
         }
         
-        if (tableToFlush) {
-            flushMemTable(tableToFlush.get());
+        auto table = buildTable(tableToFlush, fileNumber, epoch);
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            for (auto& entry : immutableMemTables) {
+                if (entry.flushing && entry.fileNumber == fileNumber) {
+                    entry.table = std::move(table);
+                    entry.built = true;
+                    break;
+                }
+            }
+        }
+        
+        // Install this table if every older one is in, along with any newer
+        // ones that finished while waiting for it
+        installFlushedTables();
+    }
+}
+
+template <typename Key, typename Value>
+void LSMTree<Key, Value>::stopFlushThreads() {
+    stopRequested = true;
+    flushCV.notify_all();
+    notifyWriteStall();
+    
+    for (auto& thread : flushThreads) {
+        if (thread.joinable()) {
+            thread.join();
         }
     }
+    flushThreads.clear();
 }
 
 template <typename Key, typename Value>
-void LSMTree<Key, Value>::flushMemTable(MemTable<Key, Value>* memtable) {
+std::unique_ptr<SSTable<Key, Value>> LSMTree<Key, Value>::buildTable(MemTable<Key, Value>* memtable,
+                                                                     uint64_t fileNumber, uint64_t epoch) {
+    std::string path = compactionManager->tableFilePath(fileNumber);
     try {
-        // Create an SSTable from the memtable
-        auto sstable = SSTable<Key, Value>::createFromMemTable(
-            *memtable, mmapManager.get(), dataDirectory, 0);
-        
-        // Add the SSTable to the compaction manager
-        compactionManager->addTable(std::move(sstable));
+        // Create an SSTable from the memtable, named by its manifest file number
+        auto sstable = SSTable<Key, Value>::writeMemTable(*memtable, mmapManager.get(), path, 0, options);
+        sstable->setFileNumber(fileNumber, epoch);
+        return sstable;
     }
     catch (const std::exception& ex) {
-        // In a production system, we would log the error and handle it appropriately
+        // The memtable stays queued for a retry; a partial file is never used
         std::cerr << "Error flushing memtable: " << ex.what() << std::endl;
+        std::error_code ec;
+        if (std::filesystem::is_regular_file(path, ec)) {
+            std::filesystem::remove(path, ec);
+        }
+        return nullptr;
     }
 }
 
 template <typename Key, typename Value>
-bool LSMTree<Key, Value>::put(const Key& key, const Value& value) {
-    std::unique_lock<std::mutex> lock(mutex);
+void LSMTree<Key, Value>::installFlushedTables() {
+    std::lock_guard<std::mutex> installLock(installMutex);
     
-    // Try to insert into the active memtable
-    if (!activeMemTable->put(key, value)) {
-        // If it's full, make it immutable
-        activeMemTable->makeImmutable();
-        immutableMemTables.push_back(std::move(activeMemTable));
+    while (true) {
+        std::unique_ptr<SSTable<Key, Value>> table;
+        uint64_t logNumber = 0;
+        {
+            // A newer table waits for the worker of the oldest memtable to install it
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            if (immutableMemTables.empty() || !immutableMemTables.front().built) {
+                return;
+            }
+            table = std::move(immutableMemTables.front().table);
+            logNumber = immutableMemTables.front().nextLogNumber;
+        }
         
-        // Create a new active memtable
-        activeMemTable = createMemTable();
+        // Add the SSTable to the compaction manager; it is durable once the manifest records it
+        bool flushed = false;
+        if (table) {
+            try {
+                compactionManager->addTable(std::move(table), logNumber);
+                flushed = true;
+            }
+            catch (const std::exception& ex) {
+                std::cerr << "Error installing flushed table: " << ex.what() << std::endl;
+            }
+        }
         
-        // Notify flush thread
-        flushCV.notify_one();
+        // Newer tables wait until the retry installs this one
+        if (!flushed) {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            retryFailedFlush();
+            return;
+        }
         
-        // Try again with the new memtable
-        return activeMemTable->put(key, value);
+        ImmutableMemTable done;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            done = std::move(immutableMemTables.front());
+            immutableMemTables.erase(immutableMemTables.begin());
+            installSuperVersion(compactionManager->getCurrentVersion());
+            
+            // Recovered memtables are the first to be flushed
+            if (recoveryFlushesPending > 0 && --recoveryFlushesPending == 0) {
+                recoveryStats.flushMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - openStart).count();
+            }
+        }
+        
+        // Close the segment outside the lock, then delete it along with
+        // any other segment the manifest no longer needs
+        std::promise<bool> installed = std::move(done.installed);
+        done = ImmutableMemTable{};
+        if (logNumber > 0) {
+            compactionManager->getManifest()->removeObsoleteLogs();
+        }
+        installed.set_value(true);
+        notifyWriteStall();
     }
+}
+
+template <typename Key, typename Value>
+void LSMTree<Key, Value>::retryFailedFlush() {
+    ImmutableMemTable& failed = immutableMemTables.front();
+    failed.flushing = false;
+    failed.built = false;
+    failed.failures++;
     
-    return true;
+    // Callers waiting on this or a newer memtable learn of the failure; a
+    // later flushAsync waits for the retry
+    for (auto& entry : immutableMemTables) {
+        if (entry.installedFuture.valid()) {
+            entry.installed.set_value(false);
+            entry.installed = std::promise<bool>();
+            entry.installedFuture = std::shared_future<bool>();
+        }
+    }
+    flushCV.notify_one();
 }
 
 template <typename Key, typename Value>
-bool LSMTree<Key, Value>::remove(const Key& key) {
-    std::unique_lock<std::mutex> lock(mutex);
+void LSMTree<Key, Value>::switchMemTable() {
+    // Create the new segment first, so a failure leaves the tree unchanged
+    std::unique_ptr<WriteAheadLog> log;
+    if (options.enableWAL) {
+        log = createLog();
+    }
     
-    // In a real implementation, we would insert a tombstone marker
-    // For simplicity, we'll just remove from active memtable
-    return activeMemTable->remove(key);
+    // Once the memtable is flushed, its segment and older ones are obsolete
+    uint64_t nextLogNumber = log ? log->getNumber() : 0;
+    activeMemTable->makeImmutable();
+    immutableMemTables.emplace_back(std::move(activeMemTable), std::move(activeLog), nextLogNumber);
+    
+    // Create a new active memtable
+    activeMemTable = createMemTable();
+    activeLog = std::move(log);
+    installSuperVersion(compactionManager->getCurrentVersion());
+    
+    // Wake a flush worker
+    flushCV.notify_one();
 }
 
 template <typename Key, typename Value>
-std::optional<Value> LSMTree<Key, Value>::get(const Key& key) {
-    // First check active memtable
+void LSMTree<Key, Value>::replaceFailedLog() {
+    // Writes already applied are only logged in the failed segment, so it
+    // is kept until their memtable is flushed, as for any other switch
+    if (activeMemTable->size() > 0) {
+        switchMemTable();
+        return;
+    }
+    
+    // No applied write needs the failed segment
+    auto log = createLog();
+    std::string path = activeLog->getPath();
+    activeLog = std::move(log);
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+}
+
+template <typename Key, typename Value>
+bool LSMTree<Key, Value>::write(const WriteBatch<Key, Value>& batch) {
+    if (batch.empty()) {
+        return true;
+    }
+    
+    Writer writer;
+    writer.batch = &batch;
+    
+    std::unique_lock<std::mutex> lock(writeMutex);
+    writers.push_back(&writer);
+    
+    // Followers wait until a leader has committed their batch or asks them to
+    // apply it, or until they reach the head of the queue
+    writer.cv.wait(lock, [&] {
+        return writer.done || writer.memtable || writers.front() == &writer;
+    });
+    if (writer.memtable && !writer.done) {
+        lock.unlock();
+        applyBatch(batch, writer.sequence, *writer.memtable);
+        lock.lock();
+        if (--*writer.pending == 0) {
+            writer.leader->cv.notify_one();
+        }
+        writer.cv.wait(lock, [&] { return writer.done; });
+    }
+    if (writer.done) {
+        return writer.ok;
+    }
+    
+    // This writer leads: take the batches queued so far, within a bound so
+    // the leader's own write is not held up by a long queue
+    std::vector<Writer*> group;
+    size_t entries = 0;
+    for (Writer* member : writers) {
+        if (!group.empty() && entries + member->batch->count() > MAX_GROUP_WRITES) {
+            break;
+        }
+        group.push_back(member);
+        entries += member->batch->count();
+    }
+    
+    // New writers queue up behind the group while it is delayed and committed
+    lock.unlock();
+    delayWrite(group);
+    bool ok = commitGroup(group);
+    lock.lock();
+    
+    for (size_t i = 0; i < group.size(); ++i) {
+        Writer* member = writers.front();
+        writers.pop_front();
+        member->ok = ok;
+        member->done = true;
+        if (member != &writer) {
+            member->cv.notify_one();
+        }
+    }
+    
+    // Hand leadership to the next queued writer
+    if (!writers.empty()) {
+        writers.front()->cv.notify_one();
+    }
+    return ok;
+}
+
+template <typename Key, typename Value>
+WriteStallCondition LSMTree<Key, Value>::checkWriteStall(WriteStallStats& stats, double* severity) const {
+    stats.immutableMemTables = getImmutableMemTableCount();
+    stats.level0Tables = compactionManager->getTableCount(0);
+    stats.pendingCompactionBytes = compactionManager->getPendingCompactionBytes();
+    
+    struct Threshold {
+        WriteStallCause cause;
+        double value;
+        double slowdown;
+        double stop;
+    };
+    const Threshold thresholds[] = {
+        {WriteStallCause::MemTables, static_cast<double>(stats.immutableMemTables),
+         static_cast<double>(options.memTableSlowdownWritesTrigger),
+         static_cast<double>(options.memTableStopWritesTrigger)},
+        {WriteStallCause::Level0Tables, static_cast<double>(stats.level0Tables),
+         static_cast<double>(options.level0SlowdownWritesTrigger),
+         static_cast<double>(options.level0StopWritesTrigger)},
+        {WriteStallCause::PendingCompactionBytes, static_cast<double>(stats.pendingCompactionBytes),
+         static_cast<double>(options.softPendingCompactionBytesLimit),
+         static_cast<double>(options.hardPendingCompactionBytesLimit)},
+    };
+    
+    // Any stop wins; otherwise the delay closest to its stop sets the pace
+    stats.condition = WriteStallCondition::Normal;
+    stats.cause = WriteStallCause::None;
+    *severity = 0.0;
+    for (const Threshold& threshold : thresholds) {
+        if (threshold.stop > 0 && threshold.value >= threshold.stop) {
+            stats.condition = WriteStallCondition::Stopped;
+            stats.cause = threshold.cause;
+            return stats.condition;
+        }
+        if (threshold.slowdown > 0 && threshold.value >= threshold.slowdown) {
+            double distance = threshold.stop > threshold.slowdown
+                ? (threshold.value - threshold.slowdown) / (threshold.stop - threshold.slowdown)
+                : 0.0;
+            if (stats.condition == WriteStallCondition::Normal || distance > *severity) {
+                stats.condition = WriteStallCondition::Delayed;
+                stats.cause = threshold.cause;
+                *severity = distance;
+            }
+        }
+    }
+    return stats.condition;
+}
+
+template <typename Key, typename Value>
+void LSMTree<Key, Value>::delayWrite(const std::vector<Writer*>& group) {
+    std::unique_lock<std::mutex> lock(stallMutex);
+    double severity = 0.0;
+    if (checkWriteStall(stallStats, &severity) == WriteStallCondition::Normal) {
+        return;
+    }
+    
+    if (stallStats.condition == WriteStallCondition::Stopped) {
+        // Hold the group until a flush or compaction clears the stop
+        auto start = std::chrono::steady_clock::now();
+        ++stallStats.stops[static_cast<size_t>(stallStats.cause)];
+        stallCV.wait(lock, [&] {
+            return stopRequested || checkWriteStall(stallStats, &severity) != WriteStallCondition::Stopped;
+        });
+        stallStats.stopMicros += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+    
+    if (stallStats.condition != WriteStallCondition::Delayed || !writeController) {
+        return;
+    }
+    
+    // Pace the group, the slower the closer the backlog is to a stop
+    ++stallStats.delays[static_cast<size_t>(stallStats.cause)];
+    double rate = static_cast<double>(options.delayedWriteRate) * (1.0 - std::min(severity, 1.0));
+    int64_t bytesPerSecond = std::max<int64_t>(static_cast<int64_t>(rate),
+                                               std::max<int64_t>(options.delayedWriteRate / 16, 1));
+    stallStats.delayedWriteRate = bytesPerSecond;
+    lock.unlock();
+    
+    size_t bytes = 0;
+    for (Writer* member : group) {
+        bytes += member->batch->approximateSize();
+    }
+    auto start = std::chrono::steady_clock::now();
+    writeController->setBytesPerSecond(bytesPerSecond);
+    writeController->request(static_cast<int64_t>(bytes), RateLimiter::Priority::High);
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    
+    lock.lock();
+    stallStats.delayMicros += micros;
+}
+
+template <typename Key, typename Value>
+void LSMTree<Key, Value>::notifyWriteStall() {
+    // Taking the mutex orders the notification after a waiter's last check
     {
-        std::unique_lock<std::mutex> lock(mutex);
-        
-        Value value;
-        if (activeMemTable->get(key, value)) {
-            return value;
+        std::lock_guard<std::mutex> lock(stallMutex);
+    }
+    stallCV.notify_all();
+}
+
+template <typename Key, typename Value>
+bool LSMTree<Key, Value>::commitGroup(const std::vector<Writer*>& group) {
+    std::lock_guard<std::mutex> logLock(logMutex);
+    
+    // Rotation happens here, so only the leader ever waits for it
+    if (activeMemTable->isFull()) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        try {
+            switchMemTable();
         }
-        
-        // Check immutable memtables (newest to oldest)
-        for (auto it = immutableMemTables.rbegin(); it != immutableMemTables.rend(); ++it) {
-            if ((*it)->get(key, value)) {
-                return value;
+        catch (const std::exception& ex) {
+            std::cerr << "Error switching memtables: " << ex.what() << std::endl;
+            return false;
+        }
+    }
+    
+    // The memtable and segment cannot change while logMutex is held
+    MemTable<Key, Value>* memtable = activeMemTable.get();
+    if (activeLog) {
+        std::vector<const WriteBatch<Key, Value>*> batches;
+        for (Writer* member : group) {
+            batches.push_back(member->batch);
+        }
+        std::string record;
+        WriteBatch<Key, Value>::encode(batches, record);
+        if (!activeLog->append(record)) {
+            // The group fails, but later groups go to a new segment
+            std::cerr << "Error writing to the write-ahead log" << std::endl;
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            try {
+                replaceFailedLog();
             }
+            catch (const std::exception& ex) {
+                std::cerr << "Error switching write-ahead logs: " << ex.what() << std::endl;
+            }
+            return false;
+        }
+    }
+    
+    // Number the writes in log order. Batches may be applied concurrently,
+    // except range deletions, which a concurrent put of an older key could
+    // slip under
+    bool concurrent = options.concurrentMemTableWrites && options.memTableType == MemTableType::SkipList &&
+                      group.size() > 1;
+    for (Writer* member : group) {
+        member->sequence = lastSequence + 1;
+        lastSequence += member->batch->count();
+        for (const auto& entry : member->batch->getEntries()) {
+            if (entry.type == RecordType::RangeDeletion) {
+                concurrent = false;
+            }
+        }
+    }
+    
+    // Readers see the group once all of it is applied, so they never see
+    // part of a batch
+    if (!concurrent) {
+        for (Writer* member : group) {
+            applyBatch(*member->batch, member->sequence, *memtable);
+        }
+        visibleSequence.store(lastSequence, std::memory_order_release);
+        return true;
+    }
+    
+    // Followers apply their own writes while the leader applies its own
+    Writer* leader = group.front();
+    size_t pending = group.size() - 1;
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        for (size_t i = 1; i < group.size(); ++i) {
+            group[i]->memtable = memtable;
+            group[i]->pending = &pending;
+            group[i]->leader = leader;
+            group[i]->cv.notify_one();
         }
     }
+    applyBatch(*leader->batch, leader->sequence, *memtable);
+    
+    std::unique_lock<std::mutex> lock(writeMutex);
+    leader->cv.wait(lock, [&] { return pending == 0; });
+    visibleSequence.store(lastSequence, std::memory_order_release);
+    return true;
+}
+
+template <typename Key, typename Value>
+bool LSMTree<Key, Value>::put(const Key& key, const Value& value) {
+    WriteBatch<Key, Value> batch;
+    batch.put(key, value);
+    return write(batch);
+}
+
+template <typename Key, typename Value>
+bool LSMTree<Key, Value>::remove(const Key& key) {
+    // The tombstone travels through flush and compaction like a value
+    WriteBatch<Key, Value> batch;
+    batch.remove(key);
+    return write(batch);
+}
+
+template <typename Key, typename Value>
+bool LSMTree<Key, Value>::deleteRange(const Key& startKey, const Key& endKey) {
+    if (endKey < startKey) {
+        return false;
+    }
     
-    // Check SSTables using compaction manager
-    auto tables = compactionManager->getTablesForKey(key);
+    WriteBatch<Key, Value> batch;
+    batch.deleteRange(startKey, endKey);
+    return write(batch);
+}
+
+template <typename Key, typename Value>
+void LSMTree<Key, Value>::applyEntry(const typename WriteBatch<Key, Value>::Entry& entry,
+                                     uint64_t sequence, MemTable<Key, Value>& memtable) {
+    if (entry.type == RecordType::RangeDeletion) {
+        memtable.addRangeTombstone(entry.key, entry.endKey, sequence);
+    } else {
+        memtable.add(entry.key, entry.value, sequence);
+    }
+}
+
+template <typename Key, typename Value>
+void LSMTree<Key, Value>::applyBatch(const WriteBatch<Key, Value>& batch, uint64_t sequence,
+                                     MemTable<Key, Value>& memtable) {
+    for (const auto& entry : batch.getEntries()) {
+        applyEntry(entry, sequence++, memtable);
+    }
+}
+
+template <typename Key, typename Value>
+std::optional<Value> LSMTree<Key, Value>::get(const Key& key) {
+    // Every source is searched newest first; the first record found for the
+    // key decides the result, and a tombstone means the key is gone. The
+    // SuperVersion keeps its memtables and tables alive until the read ends
+    uint64_t sequence = 0;
+    auto version = acquireSuperVersion(&sequence);
+    Value value;
+    
+    // First check the memtables
+    LookupResult result = lookupMemTables(*version, sequence, key, value);
+    if (result == LookupResult::Found) {
+        return value;
+    }
+    if (result == LookupResult::Deleted) {
+        return std::nullopt;
+    }
     
     // Check tables from newest to oldest
-    for (auto it = tables.rbegin(); it != tables.rend(); ++it) {
-        auto result = (*it)->get(key);
-        if (result) {
-            return *result;
+    for (const auto& table : version->tables->getTablesForKey(key)) {
+        switch (table->lookup(key, value)) {
+            case LookupResult::Found:
+                return value;
+            case LookupResult::Deleted:
+                return std::nullopt;
+            case LookupResult::NotFound:
+                break;
         }
     }
     
@@ -163,48 +826,45 @@ std::vector<std::pair<Key, Value>> LSMTree<Key, Value>::range(
     const Key& startKey, const Key& endKey) {
     
     std::vector<std::pair<Key, Value>> result;
-    std::map<Key, Value> mergedResult; // For deduplication
     
-    // First collect from active memtable
-    {
-        std::unique_lock<std::mutex> lock(mutex);
-        
-        auto activeResults = activeMemTable->range(startKey, endKey);
-        for (const auto& [key, value] : activeResults) {
-            mergedResult[key] = value;
-        }
-        
-        // Collect from immutable memtables (newest to oldest)
-        for (auto it = immutableMemTables.rbegin(); it != immutableMemTables.rend(); ++it) {
-            auto tableResults = (*it)->range(startKey, endKey);
-            for (const auto& [key, value] : tableResults) {
-                // Only insert if not already present (newer value takes precedence)
-                if (mergedResult.find(key) == mergedResult.end()) {
-                    mergedResult[key] = value;
-                }
+    // For deduplication; an empty value is a tombstone that hides older versions
+    std::map<Key, std::optional<Value>> mergedResult;
+    
+    // Ranges deleted by the sources merged so far
+    RangeTombstoneList<Key> deletedRanges;
+    
+    // Only insert keys not already present (newer records take precedence) and
+    // not range deleted by a newer source; then apply the source's own ranges
+    auto mergeRecords = [&](std::vector<std::pair<Key, std::optional<Value>>> records,
+                            const RangeTombstoneList<Key>& rangeTombstones) {
+        for (auto& [key, value] : records) {
+            if (!deletedRanges.covers(key)) {
+                mergedResult.try_emplace(std::move(key), std::move(value));
             }
         }
-    }
+        deletedRanges.addAll(rangeTombstones);
+    };
     
-    // Collect from SSTables
-    auto tables = compactionManager->getTablesForRange(startKey, endKey);
+    // First collect from the memtables (newest to oldest), as of the last
+    // visible write
+    uint64_t sequence = 0;
+    auto version = acquireSuperVersion(&sequence);
+    mergeRecords(version->activeMemTable->rangeRecords(startKey, endKey, sequence),
+                 version->activeMemTable->getRangeTombstones(sequence));
+    for (const auto& memtable : version->immutableMemTables) {
+        mergeRecords(memtable->rangeRecords(startKey, endKey, sequence), memtable->getRangeTombstones(sequence));
+    }
     
     // Process tables from newest to oldest
-    for (auto it = tables.rbegin(); it != tables.rend(); ++it) {
-        auto tableResults = (*it)->range(startKey, endKey);
-        for (const auto& [key, value] : tableResults) {
-            // Only insert if not already present (newer value takes precedence)
-            if (mergedResult.find(key) == mergedResult.end()) {
-                mergedResult[key] = value;
-            }
-        }
+    for (const auto& table : version->tables->getTablesForRange(startKey, endKey)) {
+        mergeRecords(table->rangeRecords(startKey, endKey), table->getRangeTombstones());
     }
     
-    // Convert map back to vector
+    // Convert map back to vector, leaving out deleted keys
     result.reserve(mergedResult.size());
     for (const auto& [key, value] : mergedResult) {
-        if (key >= startKey && key <= endKey) {
-            result.emplace_back(key, value);
+        if (value && key >= startKey && key <= endKey) {
+            result.emplace_back(key, *value);
         }
     }
     
@@ -212,49 +872,65 @@ std::vector<std::pair<Key, Value>> LSMTree<Key, Value>::range(
 }
 
 template <typename Key, typename Value>
-void LSMTree<Key, Value>::flush() {
-    // Make active memtable immutable and flush all immutable memtables
-    {
-        std::unique_lock<std::mutex> lock(mutex);
-        
-        // Make active memtable immutable if it's not empty
-        if (activeMemTable->size() > 0) {
-            activeMemTable->makeImmutable();
-            immutableMemTables.push_back(std::move(activeMemTable));
-            activeMemTable = createMemTable();
-            flushCV.notify_one();
+std::shared_future<bool> LSMTree<Key, Value>::flushAsync() {
+    std::lock_guard<std::mutex> logLock(logMutex);
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    
+    // Make active memtable immutable if it's not empty
+    if (activeMemTable->size() > 0) {
+        try {
+            switchMemTable();
+        }
+        catch (const std::exception& ex) {
+            std::cerr << "Error switching memtables: " << ex.what() << std::endl;
+            std::promise<bool> failed;
+            failed.set_value(false);
+            return failed.get_future().share();
         }
     }
     
-    // Wait for all memtables to be flushed
-    bool allFlushed = false;
-    while (!allFlushed) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        
-        std::unique_lock<std::mutex> lock(mutex);
-        allFlushed = immutableMemTables.empty();
+    // Tables are installed oldest first, so the newest memtable is the last one in
+    if (immutableMemTables.empty()) {
+        std::promise<bool> flushed;
+        flushed.set_value(true);
+        return flushed.get_future().share();
+    }
+    auto& newest = immutableMemTables.back();
+    if (!newest.installedFuture.valid()) {
+        newest.installedFuture = newest.installed.get_future().share();
     }
+    return newest.installedFuture;
+}
+
+template <typename Key, typename Value>
+std::future<void> LSMTree<Key, Value>::compactAsync(int level, bool majorCompaction) {
+    return compactionManager->scheduleCompaction(level, majorCompaction);
+}
+
+template <typename Key, typename Value>
+void LSMTree<Key, Value>::flush() {
+    flushAsync().wait();
 }
 
 template <typename Key, typename Value>
 void LSMTree<Key, Value>::compact(int level, bool majorCompaction) {
-    compactionManager->scheduleCompaction(level, majorCompaction);
+    auto done = compactAsync(level, majorCompaction);
     
     // Optionally wait for compaction to complete
     if (majorCompaction) {
-        compactionManager->waitForCompactions();
+        done.wait();
     }
 }
 
 template <typename Key, typename Value>
 size_t LSMTree<Key, Value>::getMemTableSize() const {
-    std::unique_lock<std::mutex> lock(mutex);
+    std::shared_lock<std::shared_mutex> lock(mutex);
     return activeMemTable->size();
 }
 
 template <typename Key, typename Value>
 size_t LSMTree<Key, Value>::getImmutableMemTableCount() const {
-    std::unique_lock<std::mutex> lock(mutex);
+    std::shared_lock<std::shared_mutex> lock(mutex);
     return immutableMemTables.size();
 }
 
@@ -271,18 +947,38 @@ std::vector<size_t> LSMTree<Key, Value>::getSSTableCountsByLevel() const {
     return counts;
 }
 
+template <typename Key, typename Value>
+BlockCache::Stats LSMTree<Key, Value>::getBlockCacheStats() const {
+    if (!options.blockCache) {
+        return BlockCache::Stats{};
+    }
+    return options.blockCache->getStats();
+}
+
+template <typename Key, typename Value>
+typename LSMTree<Key, Value>::RecoveryStats LSMTree<Key, Value>::getRecoveryStats() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return recoveryStats;
+}
+
+template <typename Key, typename Value>
+typename LSMTree<Key, Value>::WriteStallStats LSMTree<Key, Value>::getWriteStallStats() const {
+    std::lock_guard<std::mutex> lock(stallMutex);
+    WriteStallStats stats = stallStats;
+    double severity = 0.0;
+    checkWriteStall(stats, &severity);
+    return stats;
+}
+
 template <typename Key, typename Value>
 void LSMTree<Key, Value>::clear() {
     std::cout << "Clearing LSM tree resources..." << std::endl;
     
-    // Stop background flush thread if it's still running
-    stopRequested = true;
-    flushCV.notify_all();
-    
-    if (flushThread.joinable()) {
-        std::cout << "  Joining LSM flush thread..." << std::endl;
-        flushThread.join();
-        std::cout << "  LSM flush thread joined." << std::endl;
+    // Stop the flush workers if they are still running
+    if (!flushThreads.empty()) {
+        std::cout << "  Joining LSM flush threads..." << std::endl;
+        stopFlushThreads();
+        std::cout << "  LSM flush threads joined." << std::endl;
     }
 
     std::cout << "  Clearing active memtable..." << std::endl;
@@ -294,16 +990,20 @@ void LSMTree<Key, Value>::clear() {
     std::cout << "  Clearing immutable memtables (" << immutableMemTables.size() << " tables)..." << std::endl;
     // Clear immutable memtables
     for (auto& table : immutableMemTables) {
-        if (table) {
-            table->clear();
+        if (table.memtable) {
+            table.memtable->clear();
         }
     }
     immutableMemTables.clear();
+    activeLog.reset();
     
     std::cout << "  Clearing compaction manager..." << std::endl;
     // Clear compaction manager
     if (compactionManager) {
         compactionManager->shutdown();
+        
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        installSuperVersion(compactionManager->getCurrentVersion());
     }
     
     std::cout << "  Clearing mmap manager..." << std::endl;
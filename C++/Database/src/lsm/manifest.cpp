@@ -0,0 +1,441 @@
+#include "manifest.h"
+#include "coding.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Field tags inside a VersionEdit record
+constexpr uint32_t TAG_NEXT_FILE_NUMBER = 1;
+constexpr uint32_t TAG_ADDED_FILE = 2;
+constexpr uint32_t TAG_DELETED_FILE = 3;
+constexpr uint32_t TAG_LOG_NUMBER = 4;
+
+constexpr size_t RECORD_HEADER_SIZE = 8;  // fixed32 crc | fixed32 length
+
+const char* const CURRENT_FILE = "CURRENT";
+const char* const MANIFEST_PREFIX = "MANIFEST-";
+const char* const TABLE_PREFIX = "sstable_";
+const char* const LOG_PREFIX = "wal_";
+const char* const LOG_SUFFIX = ".log";
+
+void putLengthPrefixed(std::string& dst, std::string_view value) {
+    putVarint32(dst, static_cast<uint32_t>(value.size()));
+    dst.append(value.data(), value.size());
+}
+
+const char* getLengthPrefixed(const char* ptr, const char* limit, std::string* value) {
+    uint32_t length = 0;
+    ptr = getVarint32(ptr, limit, &length);
+    if (!ptr || static_cast<size_t>(limit - ptr) < length) {
+        return nullptr;
+    }
+    value->assign(ptr, length);
+    return ptr + length;
+}
+
+std::string manifestFileName(uint64_t number) {
+    std::stringstream ss;
+    ss << MANIFEST_PREFIX << std::setw(6) << std::setfill('0') << number;
+    return ss.str();
+}
+
+// Flush a stdio stream and force it to stable storage
+bool syncFile(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+} // namespace
+
+// VersionEdit implementation
+
+void VersionEdit::encode(std::string& out) const {
+    putVarint32(out, TAG_NEXT_FILE_NUMBER);
+    putVarint64(out, nextFileNumber);
+
+    for (const auto& file : addedFiles) {
+        putVarint32(out, TAG_ADDED_FILE);
+        putVarint32(out, static_cast<uint32_t>(file.level));
+        putVarint64(out, file.number);
+        putVarint64(out, file.epoch);
+        putLengthPrefixed(out, file.fileName);
+        putVarint64(out, file.fileSize);
+        putVarint32(out, file.keyCount);
+        putVarint32(out, file.rangeTombstoneCount);
+        putLengthPrefixed(out, file.smallestKey);
+        putLengthPrefixed(out, file.largestKey);
+    }
+
+    for (const auto& [level, number] : deletedFiles) {
+        putVarint32(out, TAG_DELETED_FILE);
+        putVarint32(out, static_cast<uint32_t>(level));
+        putVarint64(out, number);
+    }
+
+    if (logNumber != 0) {
+        putVarint32(out, TAG_LOG_NUMBER);
+        putVarint64(out, logNumber);
+    }
+}
+
+bool VersionEdit::decode(std::string_view in) {
+    const char* ptr = in.data();
+    const char* limit = ptr + in.size();
+
+    while (ptr && ptr < limit) {
+        uint32_t tag = 0;
+        ptr = getVarint32(ptr, limit, &tag);
+        if (!ptr) {
+            return false;
+        }
+
+        switch (tag) {
+            case TAG_NEXT_FILE_NUMBER:
+                ptr = getVarint64(ptr, limit, &nextFileNumber);
+                break;
+
+            case TAG_ADDED_FILE: {
+                FileMetaData file;
+                uint32_t level = 0;
+                ptr = getVarint32(ptr, limit, &level);
+                if (ptr) ptr = getVarint64(ptr, limit, &file.number);
+                if (ptr) ptr = getVarint64(ptr, limit, &file.epoch);
+                if (ptr) ptr = getLengthPrefixed(ptr, limit, &file.fileName);
+                if (ptr) ptr = getVarint64(ptr, limit, &file.fileSize);
+                if (ptr) ptr = getVarint32(ptr, limit, &file.keyCount);
+                if (ptr) ptr = getVarint32(ptr, limit, &file.rangeTombstoneCount);
+                if (ptr) ptr = getLengthPrefixed(ptr, limit, &file.smallestKey);
+                if (ptr) ptr = getLengthPrefixed(ptr, limit, &file.largestKey);
+                file.level = static_cast<int>(level);
+                addedFiles.push_back(std::move(file));
+                break;
+            }
+
+            case TAG_DELETED_FILE: {
+                uint32_t level = 0;
+                uint64_t number = 0;
+                ptr = getVarint32(ptr, limit, &level);
+                if (ptr) ptr = getVarint64(ptr, limit, &number);
+                deletedFiles.emplace_back(static_cast<int>(level), number);
+                break;
+            }
+
+            case TAG_LOG_NUMBER:
+                ptr = getVarint64(ptr, limit, &logNumber);
+                break;
+
+            default:
+                return false;
+        }
+    }
+    return ptr != nullptr;
+}
+
+// Manifest implementation
+
+Manifest::Manifest(const std::string& directory, size_t maxEdits)
+    : directory(directory), maxEdits(std::max<size_t>(maxEdits, 1)), nextFileNumber(1), logNumber(0),
+      file(nullptr), manifestNumber(0), editCount(0) {
+}
+
+Manifest::~Manifest() {
+    if (file) {
+        std::fclose(file);
+    }
+}
+
+bool Manifest::recover() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::ifstream current(directory + "/" + CURRENT_FILE);
+    std::string name;
+    if (!current || !std::getline(current, name) || name.empty()) {
+        return false;
+    }
+
+    std::ifstream in(directory + "/" + name, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("CURRENT names a missing manifest: " + name);
+    }
+    std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    // Replay records until the end or the first torn or corrupt one
+    uint64_t recordedNextNumber = 0;
+    size_t pos = 0;
+    while (pos < contents.size()) {
+        if (contents.size() - pos < RECORD_HEADER_SIZE) {
+            std::cerr << "Ignoring torn record at the end of " << name << std::endl;
+            break;
+        }
+        uint32_t crc = decodeFixed32(contents.data() + pos);
+        uint32_t length = decodeFixed32(contents.data() + pos + 4);
+        if (contents.size() - pos - RECORD_HEADER_SIZE < length) {
+            std::cerr << "Ignoring torn record at the end of " << name << std::endl;
+            break;
+        }
+        const char* payload = contents.data() + pos + RECORD_HEADER_SIZE;
+        VersionEdit edit;
+        if (crc32(payload, length) != crc || !edit.decode(std::string_view(payload, length))) {
+            std::cerr << "Ignoring corrupt record in " << name << " at offset " << pos << std::endl;
+            break;
+        }
+        apply(edit);
+        recordedNextNumber = std::max(recordedNextNumber, edit.nextFileNumber);
+        pos += RECORD_HEADER_SIZE + length;
+    }
+
+    // Never hand out a number that is already in use
+    uint64_t next = std::max<uint64_t>(recordedNextNumber, 1);
+    if (name.rfind(MANIFEST_PREFIX, 0) == 0) {
+        next = std::max<uint64_t>(next, std::stoull(name.substr(std::char_traits<char>::length(MANIFEST_PREFIX))) + 1);
+    }
+    if (!liveFiles.empty()) {
+        next = std::max(next, liveFiles.rbegin()->first + 1);
+    }
+    auto logs = listLogFiles();
+    if (!logs.empty()) {
+        next = std::max(next, logs.rbegin()->first + 1);
+    }
+    nextFileNumber = next;
+
+    // Continue in a fresh manifest rather than appending after a possibly torn tail
+    writeSnapshot();
+    return true;
+}
+
+uint64_t Manifest::newFileNumber() {
+    return nextFileNumber.fetch_add(1);
+}
+
+void Manifest::markFileNumberUsed(uint64_t number) {
+    uint64_t next = nextFileNumber.load();
+    while (next <= number && !nextFileNumber.compare_exchange_weak(next, number + 1)) {
+    }
+}
+
+std::string Manifest::tableFileName(uint64_t number) {
+    std::stringstream ss;
+    ss << TABLE_PREFIX << std::setw(6) << std::setfill('0') << number << ".db";
+    return ss.str();
+}
+
+std::string Manifest::logFileName(uint64_t number) {
+    std::stringstream ss;
+    ss << LOG_PREFIX << std::setw(6) << std::setfill('0') << number << LOG_SUFFIX;
+    return ss.str();
+}
+
+uint64_t Manifest::getLogNumber() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return logNumber;
+}
+
+std::map<uint64_t, std::string> Manifest::getLiveLogFiles() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto logs = listLogFiles();
+    logs.erase(logs.begin(), logs.lower_bound(logNumber));
+    return logs;
+}
+
+void Manifest::removeObsoleteLogs() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto logs = listLogFiles();
+    std::error_code ec;
+    for (auto it = logs.begin(); it != logs.end() && it->first < logNumber; ++it) {
+        std::filesystem::remove(it->second, ec);
+    }
+}
+
+std::map<uint64_t, std::string> Manifest::listLogFiles() const {
+    std::map<uint64_t, std::string> logs;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        std::string name = entry.path().filename().string();
+        if (!entry.is_regular_file() || name.rfind(LOG_PREFIX, 0) != 0 ||
+            entry.path().extension() != LOG_SUFFIX) {
+            continue;
+        }
+        std::string digits = name.substr(std::char_traits<char>::length(LOG_PREFIX),
+                                         name.size() - std::char_traits<char>::length(LOG_PREFIX) -
+                                             std::char_traits<char>::length(LOG_SUFFIX));
+        if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos) {
+            continue;
+        }
+        logs[std::stoull(digits)] = entry.path().string();
+    }
+    return logs;
+}
+
+void Manifest::logAndApply(const VersionEdit& edit) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!file) {
+        // First edit of a new tree (or after a failed append): a new snapshot holds it
+        auto previous = liveFiles;
+        apply(edit);
+        try {
+            writeSnapshot();
+        } catch (...) {
+            liveFiles = std::move(previous);
+            throw;
+        }
+        return;
+    }
+
+    VersionEdit logged = edit;
+    logged.nextFileNumber = nextFileNumber.load();
+    std::string payload;
+    logged.encode(payload);
+    try {
+        appendRecord(payload);
+    } catch (...) {
+        // The file may end in a partial record now; the next edit starts a new manifest
+        std::fclose(file);
+        file = nullptr;
+        throw;
+    }
+    apply(edit);
+
+    if (++editCount >= maxEdits) {
+        writeSnapshot();
+    }
+}
+
+std::map<uint64_t, FileMetaData> Manifest::getLiveFiles() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return liveFiles;
+}
+
+void Manifest::removeObsoleteFiles() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<std::string> live;
+    for (const auto& [number, meta] : liveFiles) {
+        live.push_back(meta.fileName);
+    }
+    std::sort(live.begin(), live.end());
+    std::string currentManifest = manifestFileName(manifestNumber);
+
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        std::string name = entry.path().filename().string();
+        bool obsolete = false;
+        if (name.rfind(MANIFEST_PREFIX, 0) == 0) {
+            obsolete = name != currentManifest;
+        } else if (name == std::string(CURRENT_FILE) + ".tmp") {
+            obsolete = true;
+        } else if (entry.path().extension() == ".db") {
+            obsolete = !std::binary_search(live.begin(), live.end(), name);
+        }
+        if (obsolete) {
+            std::filesystem::remove(entry.path(), ec);
+        }
+    }
+
+    auto logs = listLogFiles();
+    for (auto it = logs.begin(); it != logs.end() && it->first < logNumber; ++it) {
+        std::filesystem::remove(it->second, ec);
+    }
+}
+
+void Manifest::writeSnapshot() {
+    uint64_t number = nextFileNumber.fetch_add(1);
+    std::string name = manifestFileName(number);
+    std::string path = directory + "/" + name;
+
+    std::FILE* newFile = std::fopen(path.c_str(), "wb");
+    if (!newFile) {
+        throw std::runtime_error("Failed to create manifest: " + path);
+    }
+
+    // One record that adds every live table
+    VersionEdit snapshot;
+    for (const auto& [fileNumber, meta] : liveFiles) {
+        snapshot.addFile(meta);
+    }
+    snapshot.nextFileNumber = nextFileNumber.load();
+    snapshot.logNumber = logNumber;
+    std::string payload;
+    snapshot.encode(payload);
+
+    std::FILE* oldFile = file;
+    uint64_t oldNumber = manifestNumber;
+    file = newFile;
+    try {
+        appendRecord(payload);
+    } catch (...) {
+        std::fclose(newFile);
+        std::filesystem::remove(path);
+        file = oldFile;
+        throw;
+    }
+
+    // Switch CURRENT with an atomic rename
+    std::string tempPath = directory + "/" + CURRENT_FILE + ".tmp";
+    std::FILE* current = std::fopen(tempPath.c_str(), "wb");
+    bool ok = current && std::fputs((name + "\n").c_str(), current) >= 0 && syncFile(current);
+    if (current) {
+        std::fclose(current);
+    }
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(tempPath, directory + "/" + CURRENT_FILE, ec);
+    }
+    if (!ok || ec) {
+        std::fclose(newFile);
+        std::filesystem::remove(path, ec);
+        std::filesystem::remove(tempPath, ec);
+        file = oldFile;
+        throw std::runtime_error("Failed to update CURRENT in " + directory);
+    }
+
+    if (oldFile) {
+        std::fclose(oldFile);
+        std::filesystem::remove(directory + "/" + manifestFileName(oldNumber), ec);
+    }
+    manifestNumber = number;
+    editCount = 0;
+}
+
+void Manifest::appendRecord(std::string_view payload) {
+    std::string record;
+    putFixed32(record, crc32(payload.data(), payload.size()));
+    putFixed32(record, static_cast<uint32_t>(payload.size()));
+    record.append(payload.data(), payload.size());
+
+    if (std::fwrite(record.data(), 1, record.size(), file) != record.size() || !syncFile(file)) {
+        throw std::runtime_error("Failed to write manifest in " + directory);
+    }
+}
+
+void Manifest::apply(const VersionEdit& edit) {
+    for (const auto& [level, number] : edit.deletedFiles) {
+        liveFiles.erase(number);
+    }
+    for (const auto& added : edit.addedFiles) {
+        liveFiles[added.number] = added;
+    }
+    logNumber = std::max(logNumber, edit.logNumber);
+}
@@ -0,0 +1,143 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * FileMetaData - What the manifest records about one live SSTable
+ *
+ * Keys are kept in their encoded (Serializer) form so the manifest does not
+ * depend on the table's key type.
+ */
+struct FileMetaData {
+    uint64_t number = 0;               // Unique, increasing file number
+    int level = 0;
+    uint64_t epoch = 0;                // Newest flush whose data the table holds; orders level 0
+    std::string fileName;              // Relative to the data directory
+    uint64_t fileSize = 0;
+    uint32_t keyCount = 0;
+    uint32_t rangeTombstoneCount = 0;
+    std::string smallestKey;
+    std::string largestKey;
+};
+
+/**
+ * VersionEdit - One atomic change to the set of live tables
+ */
+struct VersionEdit {
+    std::vector<FileMetaData> addedFiles;
+    std::vector<std::pair<int, uint64_t>> deletedFiles;  // (level, file number)
+    uint64_t nextFileNumber = 0;                          // Set by the manifest when logged
+    uint64_t logNumber = 0;     // Oldest write-ahead log segment still needed (0: unchanged)
+
+    void addFile(FileMetaData file) { addedFiles.push_back(std::move(file)); }
+    void deleteFile(int level, uint64_t number) { deletedFiles.emplace_back(level, number); }
+    bool empty() const { return addedFiles.empty() && deletedFiles.empty() && logNumber == 0; }
+
+    void encode(std::string& out) const;
+
+    // Returns false if the record is malformed
+    bool decode(std::string_view in);
+};
+
+/**
+ * Manifest - Durable log of the table set of an LSM tree
+ *
+ * Every flush and compaction result is appended as a VersionEdit record
+ * (fixed32 crc | fixed32 length | payload) and synced before it takes effect,
+ * so a table is either fully installed or not at all. The CURRENT file names
+ * the active MANIFEST-<number> file. Once a manifest holds maxEdits records a
+ * new one is started with a single snapshot record of the live tables, and
+ * CURRENT is switched to it with an atomic rename.
+ *
+ * Recovery replays the records up to the first torn or corrupt one and then
+ * rolls over to a fresh manifest, so a crash during an append loses only that
+ * edit. File numbers come from a single counter and are never reused for
+ * files that are live.
+ *
+ * Write-ahead log segments share the file number counter. The manifest
+ * records the oldest segment whose writes are not in a table yet; older
+ * segments are obsolete and never replayed.
+ */
+class Manifest {
+public:
+    explicit Manifest(const std::string& directory, size_t maxEdits = 1024);
+    ~Manifest();
+
+    Manifest(const Manifest&) = delete;
+    Manifest& operator=(const Manifest&) = delete;
+
+    /**
+     * Load the table set named by CURRENT
+     * @return false if the directory has no manifest yet
+     */
+    bool recover();
+
+    // Allocate a file number (also used as the epoch of a flushed table)
+    uint64_t newFileNumber();
+
+    // Keep number from being handed out again (e.g. a log segment found on disk)
+    void markFileNumberUsed(uint64_t number);
+
+    // Name of the table file with the given number, e.g. "sstable_000042.db"
+    static std::string tableFileName(uint64_t number);
+
+    // Name of the log segment with the given number, e.g. "wal_000042.log"
+    static std::string logFileName(uint64_t number);
+
+    // Oldest log segment that may hold writes missing from the tables
+    uint64_t getLogNumber() const;
+
+    // Log segments in the directory that are not obsolete, by number
+    std::map<uint64_t, std::string> getLiveLogFiles() const;
+
+    // Delete the log segments older than the log number; safe at any time
+    void removeObsoleteLogs() const;
+
+    // Durably record an edit, then apply it to the live set; throws on I/O errors
+    void logAndApply(const VersionEdit& edit);
+
+    // Tables that are currently live, by file number
+    std::map<uint64_t, FileMetaData> getLiveFiles() const;
+
+    // Delete table files and manifests that no live state refers to; only safe
+    // while no table is being written (i.e. at startup)
+    void removeObsoleteFiles() const;
+
+    const std::string& getDirectory() const { return directory; }
+
+private:
+    std::string directory;
+    size_t maxEdits;
+
+    mutable std::mutex mutex;
+    std::map<uint64_t, FileMetaData> liveFiles;
+    std::atomic<uint64_t> nextFileNumber;
+    uint64_t logNumber;
+
+    // Active manifest file and the number of records in it
+    std::FILE* file;
+    uint64_t manifestNumber;
+    size_t editCount;
+
+    // Write a new manifest holding a snapshot of liveFiles and point CURRENT at it
+    void writeSnapshot();
+
+    // Append one record to the active manifest and sync it
+    void appendRecord(std::string_view payload);
+
+    void apply(const VersionEdit& edit);
+
+    // Log segments in the directory by number; the caller holds the mutex
+    std::map<uint64_t, std::string> listLogFiles() const;
+};
+
+#endif // MANIFEST_H
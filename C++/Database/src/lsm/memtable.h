@@ -1,37 +1,100 @@
 #ifndef MEMTABLE_H
 #define MEMTABLE_H
 
-#include <map>
 #include <string>
 #include <vector>
 #include <mutex>
 #include <atomic>
 #include <memory>
 #include <functional>
-#include "../memory/memory_allocator.h"
+#include <optional>
+#include "record_type.h"
+#include "range_tombstone.h"
+#include "memtable_rep.h"
 
 /**
  * MemTable - In-memory sorted structure that buffers recent writes
  * 
  * The MemTable provides fast write performance by storing key-value pairs
  * in memory before flushing to disk. It maintains keys in sorted order
- * for efficient lookups and range queries.
+ * for efficient lookups and range queries. A removed key is kept as a
+ * tombstone (an empty entry) so the deletion reaches the SSTables on flush.
+ * Deleted ranges are kept as range tombstones; entries already in the range
+ * are dropped when it is deleted, so the remaining entries are all newer.
+ * Reads may be bounded by a sequence number: they then see the memtable as
+ * it was once every write up to it was applied, ignoring newer entries and
+ * range tombstones.
+ *
+ * The entries live in a MemTableRep chosen at construction, in an arena
+ * whose blocks are an eighth of the memory limit (at most ARENA_BLOCK_SIZE),
+ * so usage grows in small steps relative to the limit; destroying the
+ * memtable releases the blocks in bulk. With the skiplist
+ * representation puts and lookups of concurrent threads do not block each
+ * other; only range deletions serialize on the memtable mutex.
  */
 template <typename Key, typename Value>
 class MemTable {
 private:
-    using KeyValueMap = std::map<Key, Value>;
-    KeyValueMap data;
-    mutable std::mutex mutex;  // Mark mutex as mutable to allow locking in const methods
-    size_t memoryUsage;
+    // A deleted range with the sequence number of its deletion
+    struct SequencedRange {
+        Key startKey;
+        Key endKey;
+        uint64_t sequence;
+    };
+
+    // Point entries; an empty optional is a tombstone
+    std::unique_ptr<MemTableRep<Key, Value>> rep;
+    RangeTombstoneList<Key> rangeTombstones;
+    std::vector<SequencedRange> rangeDeletions;  // Each range as deleted, for bounded reads
+    uint64_t lastRangeDeletion;                  // Highest sequence in rangeDeletions
+    std::atomic<size_t> rangeTombstoneCount;  // Lets lookups skip the mutex while there are none
+    mutable std::mutex mutex;  // Guards the range tombstones
+
+    // Range tombstones as of maxSequence; the caller holds the mutex
+    RangeTombstoneList<Key> rangeTombstonesAt(uint64_t maxSequence) const;
     const size_t memoryLimit;
     std::atomic<bool> immutable;
 
-    // Optional: Custom allocator for better memory management
-    MemoryAllocator* allocator;
+    // Highest sequence number written so far
+    std::atomic<uint64_t> lastSequence;
+
+    // Sequence number for put(), remove() and deleteRange()
+    uint64_t nextSequence();
+    void observeSequence(uint64_t sequence);
+
+    // Insert a value, or a tombstone if value is empty
+    bool insertRecord(const Key& key, std::optional<Value> value);
 
 public:
-    MemTable(size_t maxMemoryBytes, MemoryAllocator* alloc = nullptr);
+    /**
+     * Iterator - Forward iterator over all entries, tombstones included
+     *
+     * Yields (key, optional value) pairs decoded from the memtable's arena;
+     * only compare against end().
+     */
+    class Iterator {
+    public:
+        Iterator() = default;
+        explicit Iterator(std::unique_ptr<typename MemTableRep<Key, Value>::Cursor> cursor)
+            : cursor(std::move(cursor)) {}
+
+        std::pair<Key, std::optional<Value>> operator*() const {
+            return {cursor->key(), cursor->value()};
+        }
+        Iterator& operator++() {
+            cursor->next();
+            return *this;
+        }
+        bool operator==(const Iterator& other) const { return valid() == other.valid(); }
+        bool operator!=(const Iterator& other) const { return valid() != other.valid(); }
+
+    private:
+        std::unique_ptr<typename MemTableRep<Key, Value>::Cursor> cursor;
+
+        bool valid() const { return cursor && cursor->valid(); }
+    };
+
+    MemTable(size_t maxMemoryBytes, MemTableType type = MemTableType::Map);
     
     /**
      * Insert a key-value pair into the memtable
@@ -41,15 +104,49 @@ public:
     
     /**
      * Look up a value by key
-     * @return true if found, false otherwise
+     * @return true if a live value was found, false if missing or deleted
      */
     bool get(const Key& key, Value& value) const;
     
     /**
-     * Delete a key from the memtable (tombstone)
+     * Look up a key as of maxSequence, distinguishing deleted keys from
+     * missing ones
+     */
+    LookupResult lookup(const Key& key, Value& value, uint64_t maxSequence = MAX_SEQUENCE) const;
+    
+    /**
+     * Delete a key by writing a tombstone that shadows older versions
+     * @return true if successful, false if memtable is immutable or memory limit reached
      */
     bool remove(const Key& key);
     
+    /**
+     * Delete every key in [startKey, endKey] with a single range tombstone
+     * @return true if successful, false if memtable is immutable or memory limit reached
+     */
+    bool deleteRange(const Key& startKey, const Key& endKey);
+    
+    /**
+     * Insert a value, or a tombstone if value is empty, regardless of the
+     * memory limit; used for writes already committed to the write-ahead log.
+     * Writes may arrive out of order: the entry keeps the one with the
+     * highest sequence number
+     * @return false only if the memtable is immutable
+     */
+    bool add(const Key& key, const std::optional<Value>& value, uint64_t sequence);
+    
+    /**
+     * Delete [startKey, endKey] regardless of the memory limit, except for
+     * entries with a higher sequence number
+     * @return false only if the memtable is immutable
+     */
+    bool addRangeTombstone(const Key& startKey, const Key& endKey, uint64_t sequence);
+    
+    /**
+     * Copy of the range tombstones as of maxSequence
+     */
+    RangeTombstoneList<Key> getRangeTombstones(uint64_t maxSequence = MAX_SEQUENCE) const;
+    
     /**
      * Make this memtable immutable to prepare for flushing to disk
      */
@@ -61,12 +158,12 @@ public:
     bool isImmutable() const;
     
     /**
-     * Get approximate memory usage
+     * Get memory usage: the bytes of the entry arena plus the range tombstones
      */
     size_t getMemoryUsage() const;
     
     /**
-     * Get number of entries
+     * Get number of entries, counting each range tombstone as one
      */
     size_t size() const;
     
@@ -76,10 +173,11 @@ public:
     bool isFull() const;
     
     /**
-     * Get iterator to all entries
+     * Get iterator to all entries, tombstones included; with the map
+     * representation the memtable must not change during the iteration
      */
-    auto begin() const { return data.cbegin(); }
-    auto end() const { return data.cend(); }
+    Iterator begin() const { return Iterator(rep->newCursor()); }
+    Iterator end() const { return Iterator(); }
     
     /**
      * Range query - return all key-value pairs in the range [startKey, endKey]
@@ -87,7 +185,13 @@ public:
     std::vector<std::pair<Key, Value>> range(const Key& startKey, const Key& endKey) const;
     
     /**
-     * Apply a function to each entry in the memtable
+     * Range query as of maxSequence that also returns tombstones (as empty values)
+     */
+    std::vector<std::pair<Key, std::optional<Value>>> rangeRecords(
+        const Key& startKey, const Key& endKey, uint64_t maxSequence = MAX_SEQUENCE) const;
+    
+    /**
+     * Apply a function to each live entry in the memtable
      */
     void forEach(const std::function<void(const Key&, const Value&)>& func) const;
     
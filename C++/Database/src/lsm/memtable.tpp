@@ -5,69 +5,146 @@
 #include <algorithm>
 
 template <typename Key, typename Value>
-MemTable<Key, Value>::MemTable(size_t maxMemoryBytes, MemoryAllocator* alloc)
-    : memoryUsage(0), memoryLimit(maxMemoryBytes), immutable(false), allocator(alloc) {
+MemTable<Key, Value>::MemTable(size_t maxMemoryBytes, MemTableType type)
+    : rep(MemTableRep<Key, Value>::create(type, std::min(maxMemoryBytes / 8, ARENA_BLOCK_SIZE))),
+      lastRangeDeletion(0), rangeTombstoneCount(0), memoryLimit(maxMemoryBytes), immutable(false),
+      lastSequence(0) {
+}
+
+template <typename Key, typename Value>
+uint64_t MemTable<Key, Value>::nextSequence() {
+    return lastSequence.fetch_add(1) + 1;
+}
+
+template <typename Key, typename Value>
+void MemTable<Key, Value>::observeSequence(uint64_t sequence) {
+    // Later put() calls must stay newer than a write with an explicit sequence
+    uint64_t last = lastSequence.load();
+    while (last < sequence && !lastSequence.compare_exchange_weak(last, sequence)) {
+    }
 }
 
 template <typename Key, typename Value>
 bool MemTable<Key, Value>::put(const Key& key, const Value& value) {
+    return insertRecord(key, value);
+}
+
+template <typename Key, typename Value>
+bool MemTable<Key, Value>::insertRecord(const Key& key, std::optional<Value> value) {
     if (immutable.load()) {
         return false;  // Cannot modify an immutable memtable
     }
     
-    std::lock_guard<std::mutex> lock(mutex);
-    
-    // Calculate approximate memory usage for this entry
-    // This is a simplified estimation - in real implementation we would need more precise tracking
-    size_t entrySize = sizeof(key) + sizeof(value);
-    
-    // Check if adding this entry would exceed memory limit
-    if (memoryUsage + entrySize > memoryLimit) {
+    // The arena holds the entry's node, key and value bytes; once it reaches
+    // the limit the memtable takes no more writes (concurrent writers may
+    // overshoot it by one entry each)
+    if (isFull()) {
         return false;
     }
     
-    // Insert or update value
-    auto result = data.insert_or_assign(key, value);
-    
-    // If it's a new insertion (not an update), increase memory usage
-    if (result.second) {
-        memoryUsage += entrySize;
+    return add(key, value, nextSequence());
+}
+
+template <typename Key, typename Value>
+bool MemTable<Key, Value>::add(const Key& key, const std::optional<Value>& value, uint64_t sequence) {
+    if (immutable.load()) {
+        return false;
     }
     
+    observeSequence(sequence);
+    
+    // Insert or update value (or tombstone)
+    rep->insert(key, value, sequence);
     return true;
 }
 
 template <typename Key, typename Value>
 bool MemTable<Key, Value>::get(const Key& key, Value& value) const {
-    std::lock_guard<std::mutex> lock(mutex);
-    
-    auto it = data.find(key);
-    if (it != data.end()) {
-        value = it->second;
-        return true;
+    return lookup(key, value) == LookupResult::Found;
+}
+
+template <typename Key, typename Value>
+LookupResult MemTable<Key, Value>::lookup(const Key& key, Value& value, uint64_t maxSequence) const {
+    LookupResult result = rep->lookup(key, value, maxSequence);
+    if (result != LookupResult::NotFound || rangeTombstoneCount.load() == 0) {
+        return result;
     }
     
-    return false;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (maxSequence >= lastRangeDeletion) {
+        return rangeTombstones.covers(key) ? LookupResult::Deleted : LookupResult::NotFound;
+    }
+    for (const auto& range : rangeDeletions) {
+        if (range.sequence <= maxSequence && !(key < range.startKey) && !(range.endKey < key)) {
+            return LookupResult::Deleted;
+        }
+    }
+    return LookupResult::NotFound;
 }
 
 template <typename Key, typename Value>
 bool MemTable<Key, Value>::remove(const Key& key) {
+    // The tombstone must be kept even if the key is not in this memtable,
+    // since older memtables and SSTables may still hold it
+    return insertRecord(key, std::nullopt);
+}
+
+template <typename Key, typename Value>
+bool MemTable<Key, Value>::deleteRange(const Key& startKey, const Key& endKey) {
     if (immutable.load()) {
         return false;  // Cannot modify an immutable memtable
     }
     
+    if (isFull()) {
+        return false;
+    }
+    
+    return addRangeTombstone(startKey, endKey, nextSequence());
+}
+
+template <typename Key, typename Value>
+bool MemTable<Key, Value>::addRangeTombstone(const Key& startKey, const Key& endKey,
+                                             uint64_t sequence) {
+    if (immutable.load()) {
+        return false;
+    }
+    
+    observeSequence(sequence);
+    
     std::lock_guard<std::mutex> lock(mutex);
     
-    auto it = data.find(key);
-    if (it != data.end()) {
-        // In a full LSM implementation we would insert a tombstone marker
-        // For simplicity, we'll just remove the entry from memory
-        memoryUsage -= (sizeof(key) + sizeof(it->second));
-        data.erase(it);
-        return true;
+    // The tombstone goes in first, so a lookup that misses an entry being
+    // erased still finds the key deleted
+    rangeTombstones.add(startKey, endKey);
+    rangeDeletions.push_back(SequencedRange{startKey, endKey, sequence});
+    lastRangeDeletion = std::max(lastRangeDeletion, sequence);
+    rangeTombstoneCount.store(rangeTombstones.size());
+    
+    // Older entries in the range are dead; later writes land in the memtable
+    // again and take precedence over the tombstone
+    rep->eraseRange(startKey, endKey, sequence);
+    return true;
+}
+
+template <typename Key, typename Value>
+RangeTombstoneList<Key> MemTable<Key, Value>::getRangeTombstones(uint64_t maxSequence) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return rangeTombstonesAt(maxSequence);
+}
+
+template <typename Key, typename Value>
+RangeTombstoneList<Key> MemTable<Key, Value>::rangeTombstonesAt(uint64_t maxSequence) const {
+    if (maxSequence >= lastRangeDeletion) {
+        return rangeTombstones;
     }
     
-    return false;
+    RangeTombstoneList<Key> visible;
+    for (const auto& range : rangeDeletions) {
+        if (range.sequence <= maxSequence) {
+            visible.add(range.startKey, range.endKey);
+        }
+    }
+    return visible;
 }
 
 template <typename Key, typename Value>
@@ -82,32 +159,41 @@ bool MemTable<Key, Value>::isImmutable() const {
 
 template <typename Key, typename Value>
 size_t MemTable<Key, Value>::getMemoryUsage() const {
-    return memoryUsage;
+    return rep->getMemoryUsage() + rangeTombstoneCount.load() * 2 * sizeof(Key);
 }
 
 template <typename Key, typename Value>
 size_t MemTable<Key, Value>::size() const {
-    std::lock_guard<std::mutex> lock(mutex);
-    return data.size();
+    return rep->size() + rangeTombstoneCount.load();
 }
 
 template <typename Key, typename Value>
 bool MemTable<Key, Value>::isFull() const {
-    return memoryUsage >= memoryLimit;
+    return getMemoryUsage() >= memoryLimit;
 }
 
 template <typename Key, typename Value>
 std::vector<std::pair<Key, Value>> MemTable<Key, Value>::range(
     const Key& startKey, const Key& endKey) const {
     
-    std::lock_guard<std::mutex> lock(mutex);
     std::vector<std::pair<Key, Value>> result;
+    rep->scan(&startKey, &endKey, [&](const Key& key, const std::optional<Value>& value) {
+        if (value) {
+            result.emplace_back(key, *value);
+        }
+    }, MAX_SEQUENCE);
     
-    auto it = data.lower_bound(startKey);
-    while (it != data.end() && it->first <= endKey) {
-        result.emplace_back(it->first, it->second);
-        ++it;
-    }
+    return result;
+}
+
+template <typename Key, typename Value>
+std::vector<std::pair<Key, std::optional<Value>>> MemTable<Key, Value>::rangeRecords(
+    const Key& startKey, const Key& endKey, uint64_t maxSequence) const {
+    
+    std::vector<std::pair<Key, std::optional<Value>>> result;
+    rep->scan(&startKey, &endKey, [&](const Key& key, const std::optional<Value>& value) {
+        result.emplace_back(key, value);
+    }, maxSequence);
     
     return result;
 }
@@ -116,17 +202,21 @@ template <typename Key, typename Value>
 void MemTable<Key, Value>::forEach(
     const std::function<void(const Key&, const Value&)>& func) const {
     
-    std::lock_guard<std::mutex> lock(mutex);
-    for (const auto& [key, value] : data) {
-        func(key, value);
-    }
+    rep->scan(nullptr, nullptr, [&](const Key& key, const std::optional<Value>& value) {
+        if (value) {
+            func(key, *value);
+        }
+    }, MAX_SEQUENCE);
 }
 
 template <typename Key, typename Value>
 void MemTable<Key, Value>::clear() {
     std::lock_guard<std::mutex> lock(mutex);
-    data.clear();
-    memoryUsage = 0;
+    rep->clear();
+    rangeTombstones.clear();
+    rangeDeletions.clear();
+    lastRangeDeletion = 0;
+    rangeTombstoneCount.store(0);
 }
 
 #endif // MEMTABLE_TPP
\ No newline at end of file
@@ -0,0 +1,213 @@
+#ifndef MEMTABLE_REP_H
+#define MEMTABLE_REP_H
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <functional>
+#include "../memory/arena.h"
+#include "lsm_options.h"
+#include "record_type.h"
+#include "serializer.h"
+#include "skiplist.h"
+
+/**
+ * MemTableRep - Sorted point entries of a MemTable
+ *
+ * Maps each key to its newest value, or to an empty value for a tombstone.
+ * Every write carries a sequence number, and a write older than the one the
+ * entry holds is dropped, so concurrent writers may apply writes out of
+ * order. The versions an entry replaces stay chained behind it, newest
+ * first, so lookups and scans can be bounded by a sequence number and see
+ * the entry as it was then; writes above the bound are skipped. Every method
+ * is safe to call concurrently except clear(); cursors see the newest
+ * versions and are consistent only once the memtable is immutable, unless
+ * the representation says otherwise. Range tombstones are kept by the
+ * MemTable.
+ *
+ * Entries live in a per-representation Arena: keys and values are kept as
+ * Serializer views, and types whose view does not own its data (such as
+ * std::string) have their encoded bytes copied into the arena. Nothing in an
+ * entry needs a destructor, so dropping a memtable releases its memory a
+ * block at a time, and the arena size is the real memory footprint.
+ */
+template <typename Key, typename Value>
+class MemTableRep {
+public:
+    using ScanFunction = std::function<void(const Key&, const std::optional<Value>&)>;
+
+    /**
+     * Cursor - Position in the entries, in key order
+     */
+    class Cursor {
+    public:
+        virtual ~Cursor() = default;
+        virtual bool valid() const = 0;
+        virtual void next() = 0;
+        virtual Key key() const = 0;
+        virtual std::optional<Value> value() const = 0;
+    };
+
+    virtual ~MemTableRep() = default;
+
+    // Representation for the given type whose arena uses blocks of arenaBlockSize bytes
+    static std::unique_ptr<MemTableRep> create(MemTableType type, size_t arenaBlockSize);
+
+    // Insert or overwrite an entry unless it holds a newer write; returns
+    // true if the key had no entry
+    virtual bool insert(const Key& key, const std::optional<Value>& value, uint64_t sequence) = 0;
+
+    // Newest version of the entry for key written at or below maxSequence:
+    // Found, Deleted for a tombstone, or NotFound
+    virtual LookupResult lookup(const Key& key, Value& value, uint64_t maxSequence) const = 0;
+
+    // Drop the entries in [startKey, endKey] older than sequence, by giving
+    // them an erased version
+    virtual void eraseRange(const Key& startKey, const Key& endKey, uint64_t sequence) = 0;
+
+    // Call func for each entry in [*startKey, *endKey] as of maxSequence,
+    // tombstones included; a null bound leaves that side open
+    virtual void scan(const Key* startKey, const Key* endKey, const ScanFunction& func,
+                      uint64_t maxSequence) const = 0;
+
+    virtual std::unique_ptr<Cursor> newCursor() const = 0;
+
+    // Number of entries
+    virtual size_t size() const = 0;
+
+    // Bytes held by the arena
+    virtual size_t getMemoryUsage() const = 0;
+
+    // Drop every entry; no other thread may use the representation
+    virtual void clear() = 0;
+
+protected:
+    using KeyView = typename Serializer<Key>::View;
+    using ValueView = typename Serializer<Value>::View;
+
+    // Stored form of a point entry's value
+    struct StoredValue {
+        ValueView value;
+        RecordType type;
+        uint64_t sequence;
+    };
+
+    // One version of an entry; versions are chained newest first
+    struct Version {
+        StoredValue stored;
+        bool erased;                    // Dropped by a range deletion
+        Version* older;
+    };
+
+    // View of data that stays valid as long as the arena
+    template <typename T>
+    static typename Serializer<T>::View copyToArena(Arena& arena, const T& data);
+
+    static StoredValue storeValue(Arena& arena, const std::optional<Value>& value, uint64_t sequence);
+
+    static std::optional<Value> loadValue(const StoredValue& stored);
+
+    static Version* newVersion(Arena& arena, const StoredValue& stored, bool erased);
+
+    // Newest version in a chain written at or below maxSequence, or null
+    static const Version* visibleVersion(const Version* newest, uint64_t maxSequence);
+
+    // Lookup result of a version (null: NotFound)
+    static LookupResult loadVersion(const Version* version, Value& value);
+};
+
+/**
+ * MapMemTableRep - std::map behind a mutex, with its nodes in the arena
+ *
+ * Each key maps to its newest version. Writers and readers serialize on the
+ * mutex; cursors do not take it.
+ */
+template <typename Key, typename Value>
+class MapMemTableRep : public MemTableRep<Key, Value> {
+public:
+    using typename MemTableRep<Key, Value>::Cursor;
+    using typename MemTableRep<Key, Value>::ScanFunction;
+
+    explicit MapMemTableRep(size_t arenaBlockSize);
+
+    bool insert(const Key& key, const std::optional<Value>& value, uint64_t sequence) override;
+    LookupResult lookup(const Key& key, Value& value, uint64_t maxSequence) const override;
+    void eraseRange(const Key& startKey, const Key& endKey, uint64_t sequence) override;
+    void scan(const Key* startKey, const Key* endKey, const ScanFunction& func,
+              uint64_t maxSequence) const override;
+    std::unique_ptr<Cursor> newCursor() const override;
+    size_t size() const override;
+    size_t getMemoryUsage() const override;
+    void clear() override;
+
+private:
+    using typename MemTableRep<Key, Value>::KeyView;
+    using typename MemTableRep<Key, Value>::StoredValue;
+    using typename MemTableRep<Key, Value>::Version;
+    using KeyValueMap = std::map<KeyView, Version*, std::less<KeyView>,
+                                 ArenaAllocator<std::pair<const KeyView, Version*>>>;
+
+    class MapCursor;
+
+    size_t arenaBlockSize;
+
+    // Declared first so it outlives the map
+    std::unique_ptr<Arena> arena;
+    std::unique_ptr<KeyValueMap> data;
+    size_t entryCount;  // Keys whose newest version is not erased
+    mutable std::mutex mutex;
+};
+
+/**
+ * SkipListMemTableRep - Lock-free SkipList whose nodes live in an Arena
+ *
+ * Inserts of different keys proceed in parallel and readers never block. An
+ * update publishes a new version of the entry with one compare-and-swap on
+ * the node; erased entries get an erased version, since nodes are never
+ * unlinked. Old versions stay readable until the representation is
+ * destroyed, so cursors and scans are safe during concurrent writes.
+ */
+template <typename Key, typename Value>
+class SkipListMemTableRep : public MemTableRep<Key, Value> {
+public:
+    using typename MemTableRep<Key, Value>::Cursor;
+    using typename MemTableRep<Key, Value>::ScanFunction;
+
+    explicit SkipListMemTableRep(size_t arenaBlockSize);
+
+    bool insert(const Key& key, const std::optional<Value>& value, uint64_t sequence) override;
+    LookupResult lookup(const Key& key, Value& value, uint64_t maxSequence) const override;
+    void eraseRange(const Key& startKey, const Key& endKey, uint64_t sequence) override;
+    void scan(const Key* startKey, const Key* endKey, const ScanFunction& func,
+              uint64_t maxSequence) const override;
+    std::unique_ptr<Cursor> newCursor() const override;
+    size_t size() const override;
+    size_t getMemoryUsage() const override;
+    void clear() override;
+
+private:
+    using typename MemTableRep<Key, Value>::KeyView;
+    using typename MemTableRep<Key, Value>::StoredValue;
+    using typename MemTableRep<Key, Value>::Version;
+
+    using List = SkipList<KeyView, Version>;
+
+    class SkipListCursor;
+
+    size_t arenaBlockSize;
+
+    // Declared first so it outlives the list
+    std::unique_ptr<Arena> arena;
+    std::unique_ptr<List> list;
+    std::atomic<size_t> entryCount;
+
+    // Publish version as the newest one of node unless the node holds a
+    // newer one; returns false if it does, else sets *replaced
+    static bool publish(typename List::Node* node, Version* version, Version** replaced);
+};
+
+#include "memtable_rep.tpp"
+
+#endif // MEMTABLE_REP_H
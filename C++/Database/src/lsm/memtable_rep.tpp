@@ -0,0 +1,371 @@
+#ifndef MEMTABLE_REP_TPP
+#define MEMTABLE_REP_TPP
+
+#include "memtable_rep.h"
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <string>
+#include <type_traits>
+
+template <typename Key, typename Value>
+std::unique_ptr<MemTableRep<Key, Value>> MemTableRep<Key, Value>::create(
+    MemTableType type, size_t arenaBlockSize) {
+    switch (type) {
+        case MemTableType::SkipList:
+            return std::make_unique<SkipListMemTableRep<Key, Value>>(arenaBlockSize);
+        case MemTableType::Map:
+        default:
+            return std::make_unique<MapMemTableRep<Key, Value>>(arenaBlockSize);
+    }
+}
+
+template <typename Key, typename Value>
+template <typename T>
+typename Serializer<T>::View MemTableRep<Key, Value>::copyToArena(Arena& arena, const T& data) {
+    using View = typename Serializer<T>::View;
+
+    // Arithmetic views hold the value itself
+    if constexpr (std::is_same_v<View, T>) {
+        return data;
+    } else {
+        thread_local std::string scratch;
+        scratch.clear();
+        Serializer<T>::encode(data, scratch);
+        char* bytes = arena.allocate(scratch.size());
+        std::memcpy(bytes, scratch.data(), scratch.size());
+        return Serializer<T>::decodeView(bytes, scratch.size());
+    }
+}
+
+template <typename Key, typename Value>
+typename MemTableRep<Key, Value>::StoredValue MemTableRep<Key, Value>::storeValue(
+    Arena& arena, const std::optional<Value>& value, uint64_t sequence) {
+    if (!value) {
+        return StoredValue{ValueView{}, RecordType::Deletion, sequence};
+    }
+    return StoredValue{copyToArena(arena, *value), RecordType::Value, sequence};
+}
+
+template <typename Key, typename Value>
+std::optional<Value> MemTableRep<Key, Value>::loadValue(const StoredValue& stored) {
+    if (stored.type == RecordType::Deletion) {
+        return std::nullopt;
+    }
+    return Value(stored.value);
+}
+
+template <typename Key, typename Value>
+typename MemTableRep<Key, Value>::Version* MemTableRep<Key, Value>::newVersion(
+    Arena& arena, const StoredValue& stored, bool erased) {
+    static_assert(std::is_trivially_destructible_v<Version>,
+                  "Arena entries are released without running destructors");
+    return new (arena.allocate(sizeof(Version))) Version{stored, erased, nullptr};
+}
+
+template <typename Key, typename Value>
+const typename MemTableRep<Key, Value>::Version* MemTableRep<Key, Value>::visibleVersion(
+    const Version* newest, uint64_t maxSequence) {
+    while (newest && newest->stored.sequence > maxSequence) {
+        newest = newest->older;
+    }
+    return newest;
+}
+
+template <typename Key, typename Value>
+LookupResult MemTableRep<Key, Value>::loadVersion(const Version* version, Value& value) {
+    if (!version || version->erased) {
+        return LookupResult::NotFound;
+    }
+    if (version->stored.type == RecordType::Deletion) {
+        return LookupResult::Deleted;
+    }
+    value = Value(version->stored.value);
+    return LookupResult::Found;
+}
+
+// MapMemTableRep implementation
+
+template <typename Key, typename Value>
+class MapMemTableRep<Key, Value>::MapCursor : public MemTableRep<Key, Value>::Cursor {
+public:
+    explicit MapCursor(const KeyValueMap& data) : it(data.begin()), end(data.end()) {
+        skipErased();
+    }
+
+    bool valid() const override { return it != end; }
+
+    void next() override {
+        ++it;
+        skipErased();
+    }
+
+    Key key() const override { return Key(it->first); }
+    std::optional<Value> value() const override { return MapMemTableRep::loadValue(it->second->stored); }
+
+private:
+    typename KeyValueMap::const_iterator it;
+    typename KeyValueMap::const_iterator end;
+
+    void skipErased() {
+        while (it != end && it->second->erased) {
+            ++it;
+        }
+    }
+};
+
+template <typename Key, typename Value>
+MapMemTableRep<Key, Value>::MapMemTableRep(size_t arenaBlockSize)
+    : arenaBlockSize(arenaBlockSize), arena(std::make_unique<Arena>(arenaBlockSize)),
+      data(std::make_unique<KeyValueMap>(typename KeyValueMap::allocator_type(arena.get()))),
+      entryCount(0) {
+}
+
+template <typename Key, typename Value>
+bool MapMemTableRep<Key, Value>::insert(const Key& key, const std::optional<Value>& value,
+                                        uint64_t sequence) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Chain a new version in front unless the entry holds a newer write; the
+    // old version stays in the arena for reads bounded below this write
+    auto it = data->lower_bound(KeyView(key));
+    if (it != data->end() && !(KeyView(key) < it->first)) {
+        Version* current = it->second;
+        if (current->stored.sequence > sequence) {
+            return false;
+        }
+        Version* version = this->newVersion(*arena, this->storeValue(*arena, value, sequence), false);
+        version->older = current;
+        it->second = version;
+        if (!current->erased) {
+            return false;
+        }
+        ++entryCount;
+        return true;
+    }
+
+    Version* version = this->newVersion(*arena, this->storeValue(*arena, value, sequence), false);
+    data->emplace_hint(it, this->copyToArena(*arena, key), version);
+    ++entryCount;
+    return true;
+}
+
+template <typename Key, typename Value>
+LookupResult MapMemTableRep<Key, Value>::lookup(const Key& key, Value& value,
+                                                uint64_t maxSequence) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = data->find(KeyView(key));
+    if (it == data->end()) {
+        return LookupResult::NotFound;
+    }
+    return this->loadVersion(this->visibleVersion(it->second, maxSequence), value);
+}
+
+template <typename Key, typename Value>
+void MapMemTableRep<Key, Value>::eraseRange(const Key& startKey, const Key& endKey,
+                                            uint64_t sequence) {
+    if (endKey < startKey) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = data->lower_bound(KeyView(startKey));
+    auto end = data->upper_bound(KeyView(endKey));
+    for (; it != end; ++it) {
+        Version* current = it->second;
+        if (current->erased || current->stored.sequence >= sequence) {
+            continue;
+        }
+        Version* version = this->newVersion(*arena, StoredValue{{}, RecordType::Deletion, sequence}, true);
+        version->older = current;
+        it->second = version;
+        --entryCount;
+    }
+}
+
+template <typename Key, typename Value>
+void MapMemTableRep<Key, Value>::scan(const Key* startKey, const Key* endKey,
+                                      const ScanFunction& func, uint64_t maxSequence) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = startKey ? data->lower_bound(KeyView(*startKey)) : data->begin();
+    for (; it != data->end() && (!endKey || !(KeyView(*endKey) < it->first)); ++it) {
+        const Version* version = this->visibleVersion(it->second, maxSequence);
+        if (version && !version->erased) {
+            func(Key(it->first), this->loadValue(version->stored));
+        }
+    }
+}
+
+template <typename Key, typename Value>
+std::unique_ptr<typename MemTableRep<Key, Value>::Cursor> MapMemTableRep<Key, Value>::newCursor() const {
+    return std::make_unique<MapCursor>(*data);
+}
+
+template <typename Key, typename Value>
+size_t MapMemTableRep<Key, Value>::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entryCount;
+}
+
+template <typename Key, typename Value>
+size_t MapMemTableRep<Key, Value>::getMemoryUsage() const {
+    return arena->getMemoryUsage();
+}
+
+template <typename Key, typename Value>
+void MapMemTableRep<Key, Value>::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    data.reset();
+    arena = std::make_unique<Arena>(arenaBlockSize);
+    data = std::make_unique<KeyValueMap>(typename KeyValueMap::allocator_type(arena.get()));
+    entryCount = 0;
+}
+
+// SkipListMemTableRep implementation
+
+template <typename Key, typename Value>
+class SkipListMemTableRep<Key, Value>::SkipListCursor : public MemTableRep<Key, Value>::Cursor {
+public:
+    explicit SkipListCursor(const List* list) : it(list->newIterator()), version(nullptr) {
+        it.seekToFirst();
+        skipErased();
+    }
+
+    bool valid() const override { return it.valid(); }
+
+    void next() override {
+        it.next();
+        skipErased();
+    }
+
+    Key key() const override { return Key(it.current()->key); }
+    std::optional<Value> value() const override { return SkipListMemTableRep::loadValue(version->stored); }
+
+private:
+    typename List::Iterator it;
+    const Version* version;  // Newest version when the cursor reached the node
+
+    void skipErased() {
+        for (; it.valid(); it.next()) {
+            version = it.current()->value.load(std::memory_order_acquire);
+            if (!version->erased) {
+                break;
+            }
+        }
+    }
+};
+
+template <typename Key, typename Value>
+SkipListMemTableRep<Key, Value>::SkipListMemTableRep(size_t arenaBlockSize)
+    : arenaBlockSize(arenaBlockSize), arena(std::make_unique<Arena>(arenaBlockSize)),
+      list(std::make_unique<List>(arena.get())), entryCount(0) {
+}
+
+template <typename Key, typename Value>
+bool SkipListMemTableRep<Key, Value>::publish(typename List::Node* node, Version* version,
+                                              Version** replaced) {
+    Version* current = node->value.load(std::memory_order_acquire);
+    do {
+        // A write that lost the race to a newer one is dropped
+        if (current->stored.sequence > version->stored.sequence) {
+            return false;
+        }
+        version->older = current;
+    } while (!node->value.compare_exchange_weak(current, version, std::memory_order_acq_rel,
+                                                std::memory_order_acquire));
+    *replaced = current;
+    return true;
+}
+
+template <typename Key, typename Value>
+bool SkipListMemTableRep<Key, Value>::insert(const Key& key, const std::optional<Value>& value,
+                                             uint64_t sequence) {
+    Version* version = this->newVersion(*arena, this->storeValue(*arena, value, sequence), false);
+
+    // The key bytes are copied into the arena only for a new node
+    bool inserted = false;
+    auto* node = list->insert(KeyView(key), version, &inserted,
+                              [&] { return this->copyToArena(*arena, key); });
+    Version* replaced = nullptr;
+    if (!inserted && (!publish(node, version, &replaced) || !replaced->erased)) {
+        return false;
+    }
+    entryCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+template <typename Key, typename Value>
+LookupResult SkipListMemTableRep<Key, Value>::lookup(const Key& key, Value& value,
+                                                     uint64_t maxSequence) const {
+    auto* node = list->find(KeyView(key));
+    if (!node) {
+        return LookupResult::NotFound;
+    }
+    return this->loadVersion(this->visibleVersion(node->value.load(std::memory_order_acquire), maxSequence),
+                             value);
+}
+
+template <typename Key, typename Value>
+void SkipListMemTableRep<Key, Value>::eraseRange(const Key& startKey, const Key& endKey,
+                                                 uint64_t sequence) {
+    auto it = list->newIterator();
+    for (it.seek(KeyView(startKey)); it.valid() && !(KeyView(endKey) < it.current()->key); it.next()) {
+        auto* node = const_cast<typename List::Node*>(it.current());
+        if (node->value.load(std::memory_order_acquire)->erased) {
+            continue;
+        }
+        // A concurrent range deletion or a newer write may get there first
+        Version* replaced = nullptr;
+        if (publish(node, this->newVersion(*arena, StoredValue{{}, RecordType::Deletion, sequence}, true),
+                    &replaced) &&
+            !replaced->erased) {
+            entryCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+template <typename Key, typename Value>
+void SkipListMemTableRep<Key, Value>::scan(const Key* startKey, const Key* endKey,
+                                           const ScanFunction& func, uint64_t maxSequence) const {
+    auto it = list->newIterator();
+    if (startKey) {
+        it.seek(KeyView(*startKey));
+    } else {
+        it.seekToFirst();
+    }
+
+    for (; it.valid() && (!endKey || !(KeyView(*endKey) < it.current()->key)); it.next()) {
+        const Version* version = this->visibleVersion(it.current()->value.load(std::memory_order_acquire),
+                                                      maxSequence);
+        if (version && !version->erased) {
+            func(Key(it.current()->key), this->loadValue(version->stored));
+        }
+    }
+}
+
+template <typename Key, typename Value>
+std::unique_ptr<typename MemTableRep<Key, Value>::Cursor> SkipListMemTableRep<Key, Value>::newCursor() const {
+    return std::make_unique<SkipListCursor>(list.get());
+}
+
+template <typename Key, typename Value>
+size_t SkipListMemTableRep<Key, Value>::size() const {
+    return entryCount.load(std::memory_order_relaxed);
+}
+
+template <typename Key, typename Value>
+size_t SkipListMemTableRep<Key, Value>::getMemoryUsage() const {
+    return arena->getMemoryUsage();
+}
+
+template <typename Key, typename Value>
+void SkipListMemTableRep<Key, Value>::clear() {
+    list.reset();
+    arena = std::make_unique<Arena>(arenaBlockSize);
+    list = std::make_unique<List>(arena.get());
+    entryCount = 0;
+}
+
+#endif // MEMTABLE_REP_TPP
@@ -0,0 +1,60 @@
+#ifndef MERGING_ITERATOR_H
+#define MERGING_ITERATOR_H
+
+#include <vector>
+#include <string_view>
+#include "sstable.h"
+
+/**
+ * MergingIterator - K-way merge over several SSTable iterators
+ *
+ * Yields the union of its sources in key order using a binary heap of the
+ * source positions, so only one block per source is resident at a time.
+ * Sources are ordered newest first: when several sources hold the same key,
+ * only the entry from the lowest-indexed (most recent) source is returned and
+ * the older versions are skipped. Tombstones are returned like any other
+ * entry; the caller decides whether they can be dropped.
+ */
+template <typename Key, typename Value>
+class MergingIterator {
+public:
+    using TableIterator = typename SSTable<Key, Value>::Iterator;
+
+    explicit MergingIterator(std::vector<TableIterator> sources);
+
+    bool valid() const;
+    void seekToFirst();
+
+    // Position at the first key >= target
+    void seek(const Key& target);
+    void next();
+
+    // Current entry, from the newest source that holds this key
+    typename Serializer<Key>::View keyView() const;
+    Key key() const;
+    Value value() const;
+    RecordType type() const;
+    std::string_view rawKey() const;
+    std::string_view rawValue() const;
+
+    // Index of the source the current entry comes from
+    size_t sourceIndex() const;
+
+private:
+    std::vector<TableIterator> sources;
+
+    // Indexes of the valid sources, arranged as a min-heap on (key, source index)
+    std::vector<size_t> heap;
+
+    // Heap ordering: true if source a should be returned after source b
+    bool after(size_t a, size_t b) const;
+
+    // Rebuild the heap after every source was repositioned
+    void rebuildHeap();
+
+    const TableIterator& current() const { return sources[heap.front()]; }
+};
+
+#include "merging_iterator.tpp"
+
+#endif // MERGING_ITERATOR_H
@@ -0,0 +1,120 @@
+#ifndef MERGING_ITERATOR_TPP
+#define MERGING_ITERATOR_TPP
+
+#include "merging_iterator.h"
+#include <algorithm>
+
+template <typename Key, typename Value>
+MergingIterator<Key, Value>::MergingIterator(std::vector<TableIterator> sources)
+    : sources(std::move(sources)) {
+    heap.reserve(this->sources.size());
+}
+
+template <typename Key, typename Value>
+bool MergingIterator<Key, Value>::after(size_t a, size_t b) const {
+    auto keyA = sources[a].keyView();
+    auto keyB = sources[b].keyView();
+    if (keyB < keyA) {
+        return true;
+    }
+    if (keyA < keyB) {
+        return false;
+    }
+    // Same key: the newer (lower-indexed) source comes first
+    return a > b;
+}
+
+template <typename Key, typename Value>
+void MergingIterator<Key, Value>::rebuildHeap() {
+    heap.clear();
+    for (size_t i = 0; i < sources.size(); ++i) {
+        if (sources[i].valid()) {
+            heap.push_back(i);
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(),
+                   [this](size_t a, size_t b) { return after(a, b); });
+}
+
+template <typename Key, typename Value>
+bool MergingIterator<Key, Value>::valid() const {
+    return !heap.empty();
+}
+
+template <typename Key, typename Value>
+void MergingIterator<Key, Value>::seekToFirst() {
+    for (auto& source : sources) {
+        source.seekToFirst();
+    }
+    rebuildHeap();
+}
+
+template <typename Key, typename Value>
+void MergingIterator<Key, Value>::seek(const Key& target) {
+    for (auto& source : sources) {
+        source.seek(target);
+    }
+    rebuildHeap();
+}
+
+template <typename Key, typename Value>
+void MergingIterator<Key, Value>::next() {
+    auto comp = [this](size_t a, size_t b) { return after(a, b); };
+    Key currentKey = key();
+    
+    // Advance every source positioned at the current key; the older
+    // versions are shadowed by the entry just returned
+    while (!heap.empty()) {
+        auto topKey = current().keyView();
+        if (topKey < currentKey || currentKey < topKey) {
+            break;
+        }
+        
+        std::pop_heap(heap.begin(), heap.end(), comp);
+        size_t idx = heap.back();
+        heap.pop_back();
+        
+        sources[idx].next();
+        if (sources[idx].valid()) {
+            heap.push_back(idx);
+            std::push_heap(heap.begin(), heap.end(), comp);
+        }
+    }
+}
+
+template <typename Key, typename Value>
+typename Serializer<Key>::View MergingIterator<Key, Value>::keyView() const {
+    return current().keyView();
+}
+
+template <typename Key, typename Value>
+Key MergingIterator<Key, Value>::key() const {
+    return current().key();
+}
+
+template <typename Key, typename Value>
+Value MergingIterator<Key, Value>::value() const {
+    return current().value();
+}
+
+template <typename Key, typename Value>
+RecordType MergingIterator<Key, Value>::type() const {
+    return current().type();
+}
+
+template <typename Key, typename Value>
+std::string_view MergingIterator<Key, Value>::rawKey() const {
+    return current().rawKey();
+}
+
+template <typename Key, typename Value>
+std::string_view MergingIterator<Key, Value>::rawValue() const {
+    return current().rawValue();
+}
+
+template <typename Key, typename Value>
+size_t MergingIterator<Key, Value>::sourceIndex() const {
+    return heap.front();
+}
+
+#endif // MERGING_ITERATOR_TPP
@@ -0,0 +1,61 @@
+#ifndef RANGE_TOMBSTONE_H
+#define RANGE_TOMBSTONE_H
+
+#include <map>
+#include <cstddef>
+
+/**
+ * RangeTombstoneList - Set of deleted key ranges [start, end] (inclusive)
+ *
+ * A range tombstone hides every version of the keys it covers that is older
+ * than the memtable or SSTable holding it; point entries in the same memtable
+ * or table are newer and win. Overlapping ranges are merged on insertion, so
+ * the list is a sorted sequence of disjoint ranges and coverage checks are a
+ * single binary search.
+ */
+template <typename Key>
+class RangeTombstoneList {
+public:
+    using Map = std::map<Key, Key>;  // start -> end
+
+    // Delete [start, end]; ignored if start > end
+    void add(const Key& start, const Key& end);
+
+    // Merge every range of another list into this one
+    void addAll(const RangeTombstoneList& other);
+
+    // True if some range contains key
+    bool covers(const Key& key) const;
+
+    // True if a single range contains all of [start, end]
+    bool covers(const Key& start, const Key& end) const;
+
+    // True if some range contains a key in [start, end]
+    bool overlaps(const Key& start, const Key& end) const;
+
+    // True if a range contains both key and a key greater than it, i.e. a
+    // table boundary placed right after key would split the range
+    bool spans(const Key& key) const;
+
+    bool empty() const { return ranges.empty(); }
+    size_t size() const { return ranges.size(); }
+    void clear() { ranges.clear(); }
+
+    // Disjoint ranges in key order
+    typename Map::const_iterator begin() const { return ranges.begin(); }
+    typename Map::const_iterator end() const { return ranges.end(); }
+
+    // Smallest start and largest end; the list must not be empty
+    const Key& smallestKey() const { return ranges.begin()->first; }
+    const Key& largestKey() const { return ranges.rbegin()->second; }
+
+private:
+    Map ranges;
+
+    // The range containing key, or end()
+    typename Map::const_iterator find(const Key& key) const;
+};
+
+#include "range_tombstone.tpp"
+
+#endif // RANGE_TOMBSTONE_H
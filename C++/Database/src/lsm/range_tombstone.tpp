@@ -0,0 +1,80 @@
+#ifndef RANGE_TOMBSTONE_TPP
+#define RANGE_TOMBSTONE_TPP
+
+#include "range_tombstone.h"
+#include <iterator>
+
+template <typename Key>
+void RangeTombstoneList<Key>::add(const Key& start, const Key& end) {
+    if (end < start) {
+        return;
+    }
+    Key mergedStart = start;
+    Key mergedEnd = end;
+    
+    // Absorb the range before start if it reaches into the new one
+    auto it = ranges.upper_bound(start);
+    if (it != ranges.begin()) {
+        auto prev = std::prev(it);
+        if (!(prev->second < start)) {
+            mergedStart = prev->first;
+            if (mergedEnd < prev->second) mergedEnd = prev->second;
+            it = ranges.erase(prev);
+        }
+    }
+    
+    // Absorb every range that starts inside the new one
+    while (it != ranges.end() && !(end < it->first)) {
+        if (mergedEnd < it->second) mergedEnd = it->second;
+        it = ranges.erase(it);
+    }
+    
+    ranges.emplace(std::move(mergedStart), std::move(mergedEnd));
+}
+
+template <typename Key>
+void RangeTombstoneList<Key>::addAll(const RangeTombstoneList& other) {
+    for (const auto& [start, end] : other.ranges) {
+        add(start, end);
+    }
+}
+
+template <typename Key>
+typename RangeTombstoneList<Key>::Map::const_iterator
+RangeTombstoneList<Key>::find(const Key& key) const {
+    auto it = ranges.upper_bound(key);
+    if (it == ranges.begin()) {
+        return ranges.end();
+    }
+    --it;
+    return it->second < key ? ranges.end() : it;
+}
+
+template <typename Key>
+bool RangeTombstoneList<Key>::covers(const Key& key) const {
+    return find(key) != ranges.end();
+}
+
+template <typename Key>
+bool RangeTombstoneList<Key>::covers(const Key& start, const Key& end) const {
+    auto it = find(start);
+    return it != ranges.end() && !(it->second < end);
+}
+
+template <typename Key>
+bool RangeTombstoneList<Key>::overlaps(const Key& start, const Key& end) const {
+    if (covers(start)) {
+        return true;
+    }
+    // Otherwise a range must start inside (start, end]
+    auto it = ranges.upper_bound(start);
+    return it != ranges.end() && !(end < it->first);
+}
+
+template <typename Key>
+bool RangeTombstoneList<Key>::spans(const Key& key) const {
+    auto it = find(key);
+    return it != ranges.end() && key < it->second;
+}
+
+#endif // RANGE_TOMBSTONE_TPP
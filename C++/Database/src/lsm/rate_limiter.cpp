@@ -0,0 +1,101 @@
+#include "rate_limiter.h"
+#include <algorithm>
+
+RateLimiter::RateLimiter(int64_t bytesPerSecond, int64_t maxBytesPerSecond,
+                         std::chrono::microseconds refillPeriod)
+    : baseBytesPerSecond(std::max<int64_t>(bytesPerSecond, 1)),
+      maxBytesPerSecond(maxBytesPerSecond),
+      bytesPerSecond(std::max<int64_t>(bytesPerSecond, 1)),
+      refillPeriod(std::max(refillPeriod, std::chrono::microseconds(1000))),
+      available(0), lastRefill(Clock::now()), highPriorityWaiters(0), stats{} {
+}
+
+void RateLimiter::refill() {
+    Clock::time_point now = Clock::now();
+    double elapsed = std::chrono::duration<double>(now - lastRefill).count();
+    lastRefill = now;
+    
+    available = std::min(available + elapsed * static_cast<double>(bytesPerSecond), burstBytes());
+}
+
+double RateLimiter::burstBytes() const {
+    return static_cast<double>(bytesPerSecond) * std::chrono::duration<double>(refillPeriod).count();
+}
+
+void RateLimiter::request(int64_t bytes, Priority priority) {
+    std::unique_lock<std::mutex> lock(mutex);
+    
+    stats.requests++;
+    stats.bytesThrough[static_cast<int>(priority)] += static_cast<uint64_t>(std::max<int64_t>(bytes, 0));
+    
+    bool waited = false;
+    bool high = priority == Priority::High;
+    if (high) {
+        highPriorityWaiters++;
+    }
+    
+    // Requests larger than the burst are granted in burst-sized pieces
+    double remaining = static_cast<double>(bytes);
+    while (remaining > 0) {
+        refill();
+        double chunk = std::min(remaining, burstBytes());
+        bool eligible = high || highPriorityWaiters == 0;
+        if (eligible && available >= chunk) {
+            available -= chunk;
+            remaining -= chunk;
+            continue;
+        }
+        
+        // Sleep roughly until the missing tokens have accrued (or a flush finishes)
+        waited = true;
+        double missing = eligible ? chunk - available : chunk;
+        auto wait = std::chrono::microseconds(static_cast<int64_t>(
+            missing * 1e6 / static_cast<double>(bytesPerSecond)) + 1);
+        cv.wait_for(lock, std::min(wait, refillPeriod));
+    }
+    
+    if (high) {
+        highPriorityWaiters--;
+        if (highPriorityWaiters == 0) {
+            cv.notify_all();
+        }
+    }
+    if (waited) {
+        stats.waits++;
+    }
+}
+
+void RateLimiter::setBytesPerSecond(int64_t rate) {
+    std::lock_guard<std::mutex> lock(mutex);
+    refill();
+    // Auto-tuning raises it again on the next debt report
+    baseBytesPerSecond = std::max<int64_t>(rate, 1);
+    bytesPerSecond = baseBytesPerSecond;
+    cv.notify_all();
+}
+
+void RateLimiter::updateCompactionDebt(double debt) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (maxBytesPerSecond <= baseBytesPerSecond) {
+        return;
+    }
+    
+    // Tokens accrued so far count at the old rate
+    refill();
+    double scale = 1.0 + std::max(debt - 1.0, 0.0);
+    double target = static_cast<double>(baseBytesPerSecond) * scale;
+    bytesPerSecond = static_cast<int64_t>(std::min(target, static_cast<double>(maxBytesPerSecond)));
+    cv.notify_all();
+}
+
+int64_t RateLimiter::getBytesPerSecond() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytesPerSecond;
+}
+
+RateLimiter::Stats RateLimiter::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats result = stats;
+    result.bytesPerSecond = bytesPerSecond;
+    return result;
+}
@@ -0,0 +1,88 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * RateLimiter - Token bucket that paces background SSTable writes
+ *
+ * Writers call request() before handing bytes to the file and block until
+ * the bucket holds enough tokens. Tokens accrue continuously at the current
+ * rate, with at most one refill period's worth banked as burst. Flushes
+ * request at High priority: while any flush is waiting, compactions (Low)
+ * get no tokens, so memtables drain ahead of background merging.
+ *
+ * In auto-tune mode the rate floats between the configured base rate and a
+ * maximum, driven by the compaction debt reported through
+ * updateCompactionDebt(): a backlog of level 0 tables lets compactions run
+ * faster so they catch up before writes have to stall.
+ */
+class RateLimiter {
+public:
+    enum class Priority {
+        Low,    // Compaction
+        High    // Flush
+    };
+
+    struct Stats {
+        uint64_t bytesThrough[2];   // Indexed by Priority
+        uint64_t requests;
+        uint64_t waits;             // Requests that had to block
+        int64_t bytesPerSecond;     // Current rate
+    };
+
+    /**
+     * @param bytesPerSecond base rate (must be positive)
+     * @param maxBytesPerSecond auto-tune ceiling; 0 disables auto-tuning
+     * @param refillPeriod burst window, also the longest a waiter sleeps between checks
+     */
+    explicit RateLimiter(int64_t bytesPerSecond, int64_t maxBytesPerSecond = 0,
+                         std::chrono::microseconds refillPeriod = std::chrono::milliseconds(100));
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    // Block until the bytes may be written
+    void request(int64_t bytes, Priority priority);
+
+    // Change the base rate
+    void setBytesPerSecond(int64_t bytesPerSecond);
+
+    /**
+     * Report the compaction backlog as a multiple of what is considered
+     * healthy (e.g. level 0 tables / level 0 compaction trigger). In auto-tune
+     * mode the rate grows linearly with the debt above 1, up to the maximum.
+     */
+    void updateCompactionDebt(double debt);
+
+    int64_t getBytesPerSecond() const;
+    Stats getStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+
+    int64_t baseBytesPerSecond;
+    int64_t maxBytesPerSecond;
+    int64_t bytesPerSecond;
+    std::chrono::microseconds refillPeriod;
+
+    double available;          // Tokens in the bucket
+    Clock::time_point lastRefill;
+    int highPriorityWaiters;
+
+    Stats stats;
+
+    // Add the tokens accrued since the last refill; the caller holds the mutex
+    void refill();
+
+    // Most tokens the bucket can bank at the current rate
+    double burstBytes() const;
+};
+
+#endif // RATE_LIMITER_H
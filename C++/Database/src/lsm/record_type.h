@@ -0,0 +1,29 @@
+#ifndef RECORD_TYPE_H
+#define RECORD_TYPE_H
+
+#include <cstdint>
+
+/**
+ * RecordType - Kind of entry stored under a key in memtables and SSTables
+ *
+ * A deletion is written as a tombstone rather than by erasing the key, so it
+ * shadows older versions of the key in lower memtables, tables and levels
+ * until compaction reaches the bottom of the tree and drops both.
+ */
+enum class RecordType : uint8_t {
+    Value = 0,          // The key maps to a value
+    Deletion = 1,       // Tombstone: the key was removed
+    RangeDeletion = 2   // Write-ahead log only: the keys from the key to an end key were removed
+};
+
+// Outcome of a point lookup in a single memtable or table
+enum class LookupResult {
+    NotFound,   // Keep searching older data
+    Found,      // A live value was found
+    Deleted     // A tombstone was found; older versions are hidden
+};
+
+// Sequence bound of a memtable read that sees every write
+constexpr uint64_t MAX_SEQUENCE = UINT64_MAX;
+
+#endif // RECORD_TYPE_H
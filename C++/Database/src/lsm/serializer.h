@@ -0,0 +1,89 @@
+#ifndef SERIALIZER_H
+#define SERIALIZER_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * Serializer - Converts keys and values to and from their on-disk byte form
+ *
+ * SSTables store every key and value as a length-prefixed run of bytes. A
+ * Serializer specialization defines how a type maps to those bytes:
+ * - encode() appends the serialized form to a buffer
+ * - decodeView() returns a cheap view over bytes that live in the mapping
+ * - decode() materializes an owning object from those bytes
+ *
+ * View types must be comparable with the owning type so lookups can compare
+ * keys in place without constructing temporaries.
+ */
+template <typename T, typename Enable = void>
+struct Serializer {
+    static_assert(sizeof(T) == 0,
+        "No Serializer specialization for this type; add one in serializer.h");
+};
+
+/**
+ * Arithmetic types are written big-endian with a fixed width. Sequential
+ * integers then share their leading bytes, which keeps them compact under
+ * prefix compression.
+ */
+template <typename T>
+struct Serializer<T, std::enable_if_t<std::is_arithmetic_v<T>>> {
+    using View = T;
+    using Bits = std::conditional_t<sizeof(T) == 1, uint8_t,
+                 std::conditional_t<sizeof(T) == 2, uint16_t,
+                 std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>>;
+
+    static constexpr size_t encodedSize(const T&) { return sizeof(T); }
+
+    static void encode(const T& value, std::string& out) {
+        Bits bits;
+        std::memcpy(&bits, &value, sizeof(T));
+        char buf[sizeof(T)];
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            buf[i] = static_cast<char>((bits >> (8 * (sizeof(T) - 1 - i))) & 0xff);
+        }
+        out.append(buf, sizeof(T));
+    }
+
+    // Returns false if the byte count does not match the fixed width
+    static bool valid(const char*, size_t size) { return size == sizeof(T); }
+
+    static View decodeView(const char* data, size_t) {
+        const auto* p = reinterpret_cast<const unsigned char*>(data);
+        Bits bits = 0;
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            bits = static_cast<Bits>((bits << 8) | p[i]);
+        }
+        T value;
+        std::memcpy(&value, &bits, sizeof(T));
+        return value;
+    }
+
+    static T decode(const char* data, size_t size) { return decodeView(data, size); }
+};
+
+/**
+ * Strings are stored as their raw bytes; views point straight into the mapping.
+ */
+template <>
+struct Serializer<std::string> {
+    using View = std::string_view;
+
+    static size_t encodedSize(const std::string& value) { return value.size(); }
+
+    static void encode(const std::string& value, std::string& out) {
+        out.append(value);
+    }
+
+    static bool valid(const char*, size_t) { return true; }
+
+    static View decodeView(const char* data, size_t size) { return View(data, size); }
+
+    static std::string decode(const char* data, size_t size) { return std::string(data, size); }
+};
+
+#endif // SERIALIZER_H
@@ -0,0 +1,104 @@
+#ifndef SKIPLIST_H
+#define SKIPLIST_H
+
+#include <atomic>
+#include <cstdint>
+#include "../memory/arena.h"
+
+/**
+ * SkipList - Concurrent sorted map from keys to pointers, allocated in an Arena
+ *
+ * Inserts are lock-free: a new node is linked bottom-up with one
+ * compare-and-swap per level, and a failed CAS only re-searches that level
+ * from the predecessor found before. Readers never wait; they follow
+ * acquire-loaded next pointers and see every node whose level 0 link is
+ * published. Nodes are never unlinked, so the structure only grows until the
+ * list and its arena are destroyed; the value pointer of a node can be
+ * swapped atomically to update an existing key.
+ *
+ * A node keeps the key returned by the caller's storeKey function, so keys
+ * that are views can point at bytes the caller placed in the same arena.
+ * Keys are destroyed with the list; values are owned by the caller.
+ */
+template <typename Key, typename T>
+class SkipList {
+public:
+    static constexpr int MAX_HEIGHT = 12;
+
+    struct Node {
+        const Key key;
+        std::atomic<T*> value;
+
+        Node* next(int level) const { return links[level].load(std::memory_order_acquire); }
+
+    private:
+        friend class SkipList;
+
+        const int height;
+        // Followed by height - 1 more links in the same allocation
+        std::atomic<Node*> links[1];
+
+        Node(const Key& key, T* value, int height);
+
+        bool casNext(int level, Node* expected, Node* node);
+    };
+
+    /**
+     * Iterator - Walks the nodes in key order; safe during concurrent inserts
+     */
+    class Iterator {
+    public:
+        explicit Iterator(const SkipList* list) : list(list), node(nullptr) {}
+
+        bool valid() const { return node != nullptr; }
+        const Node* current() const { return node; }
+        void seekToFirst() { node = list->head->next(0); }
+
+        // Position at the first node with key >= target
+        void seek(const Key& target) { node = list->findGreaterOrEqual(target, nullptr); }
+        void next() { node = node->next(0); }
+
+    private:
+        const SkipList* list;
+        const Node* node;
+    };
+
+    explicit SkipList(Arena* arena);
+    ~SkipList();
+
+    SkipList(const SkipList&) = delete;
+    SkipList& operator=(const SkipList&) = delete;
+
+    /**
+     * Insert key with value unless the key is present; storeKey() is called
+     * only when a node is created and returns the key the node keeps
+     * @return the node holding key; inserted tells whether value was installed
+     */
+    template <typename StoreKey>
+    Node* insert(const Key& key, T* value, bool* inserted, StoreKey storeKey);
+
+    // Node holding key, or null
+    Node* find(const Key& key) const;
+
+    Iterator newIterator() const { return Iterator(this); }
+
+private:
+    Arena* const arena;
+    Node* const head;
+
+    // Height of the tallest node; searches start there
+    std::atomic<int> maxHeight;
+
+    Node* newNode(const Key& key, T* value, int height);
+    static int randomHeight();
+
+    // First node with key >= target; fills prev[level] with the last node before it
+    Node* findGreaterOrEqual(const Key& target, Node** prev) const;
+
+    // Move (*prev, *succ) at level forward from start so that prev < key <= succ
+    void findSpliceForLevel(const Key& key, Node* start, int level, Node** prev, Node** succ) const;
+};
+
+#include "skiplist.tpp"
+
+#endif // SKIPLIST_H
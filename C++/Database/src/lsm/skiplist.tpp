@@ -0,0 +1,153 @@
+#ifndef SKIPLIST_TPP
+#define SKIPLIST_TPP
+
+#include "skiplist.h"
+#include <new>
+#include <random>
+#include <type_traits>
+
+template <typename Key, typename T>
+SkipList<Key, T>::Node::Node(const Key& key, T* value, int height)
+    : key(key), value(value), height(height) {
+    for (int i = 0; i < height; ++i) {
+        new (&links[i]) std::atomic<Node*>(nullptr);
+    }
+}
+
+template <typename Key, typename T>
+bool SkipList<Key, T>::Node::casNext(int level, Node* expected, Node* node) {
+    return links[level].compare_exchange_strong(expected, node, std::memory_order_release,
+                                                std::memory_order_relaxed);
+}
+
+template <typename Key, typename T>
+SkipList<Key, T>::SkipList(Arena* arena)
+    : arena(arena), head(newNode(Key(), nullptr, MAX_HEIGHT)), maxHeight(1) {
+}
+
+template <typename Key, typename T>
+SkipList<Key, T>::~SkipList() {
+    // The arena releases the nodes; only the keys may own memory of their own
+    if constexpr (!std::is_trivially_destructible_v<Key>) {
+        Node* node = head;
+        while (node) {
+            Node* next = node->next(0);
+            node->~Node();
+            node = next;
+        }
+    }
+}
+
+template <typename Key, typename T>
+typename SkipList<Key, T>::Node* SkipList<Key, T>::newNode(const Key& key, T* value, int height) {
+    size_t bytes = sizeof(Node) + sizeof(std::atomic<Node*>) * (height - 1);
+    return new (arena->allocate(bytes)) Node(key, value, height);
+}
+
+template <typename Key, typename T>
+int SkipList<Key, T>::randomHeight() {
+    // Each level holds about a quarter of the nodes of the one below
+    thread_local std::minstd_rand rng(std::random_device{}());
+    int height = 1;
+    while (height < MAX_HEIGHT && rng() % 4 == 0) {
+        ++height;
+    }
+    return height;
+}
+
+template <typename Key, typename T>
+typename SkipList<Key, T>::Node* SkipList<Key, T>::findGreaterOrEqual(
+    const Key& target, Node** prev) const {
+
+    Node* node = head;
+    for (int level = maxHeight.load(std::memory_order_relaxed) - 1; level >= 0; --level) {
+        Node* next = node->next(level);
+        while (next && next->key < target) {
+            node = next;
+            next = node->next(level);
+        }
+        if (prev) {
+            prev[level] = node;
+        }
+        if (level == 0) {
+            return next;
+        }
+    }
+    return nullptr;
+}
+
+template <typename Key, typename T>
+void SkipList<Key, T>::findSpliceForLevel(const Key& key, Node* start, int level,
+                                          Node** prev, Node** succ) const {
+    Node* node = start;
+    Node* next = node->next(level);
+    while (next && next->key < key) {
+        node = next;
+        next = node->next(level);
+    }
+    *prev = node;
+    *succ = next;
+}
+
+template <typename Key, typename T>
+template <typename StoreKey>
+typename SkipList<Key, T>::Node* SkipList<Key, T>::insert(const Key& key, T* value, bool* inserted,
+                                                          StoreKey storeKey) {
+    // Splice at every level: prev[level] < key <= succ[level]
+    Node* prev[MAX_HEIGHT];
+    Node* succ[MAX_HEIGHT];
+    int searchHeight = maxHeight.load(std::memory_order_relaxed);
+    for (int level = MAX_HEIGHT - 1; level >= searchHeight; --level) {
+        prev[level] = head;
+        succ[level] = nullptr;
+    }
+    for (int level = searchHeight - 1; level >= 0; --level) {
+        findSpliceForLevel(key, level == searchHeight - 1 ? head : prev[level + 1], level,
+                           &prev[level], &succ[level]);
+    }
+
+    if (succ[0] && !(key < succ[0]->key)) {
+        *inserted = false;
+        return succ[0];
+    }
+
+    int height = randomHeight();
+    int currentMax = maxHeight.load(std::memory_order_relaxed);
+    while (height > currentMax &&
+           !maxHeight.compare_exchange_weak(currentMax, height, std::memory_order_relaxed)) {
+    }
+
+    Node* node = newNode(storeKey(), value, height);
+    for (int level = 0; level < height; ++level) {
+        while (true) {
+            node->links[level].store(succ[level], std::memory_order_relaxed);
+            if (prev[level]->casNext(level, succ[level], node)) {
+                break;
+            }
+
+            // Another insert changed this level; nodes are never removed, so
+            // the old predecessor is still before key
+            findSpliceForLevel(key, prev[level], level, &prev[level], &succ[level]);
+            if (level == 0 && succ[0] && !(key < succ[0]->key)) {
+                // Lost the race to insert the same key; the node was never published
+                node->~Node();
+                *inserted = false;
+                return succ[0];
+            }
+        }
+    }
+
+    *inserted = true;
+    return node;
+}
+
+template <typename Key, typename T>
+typename SkipList<Key, T>::Node* SkipList<Key, T>::find(const Key& key) const {
+    Node* node = findGreaterOrEqual(key, nullptr);
+    if (node && !(key < node->key)) {
+        return node;
+    }
+    return nullptr;
+}
+
+#endif // SKIPLIST_TPP
@@ -7,7 +7,21 @@
 #include <cstdint>
 #include <functional>
 #include <optional>
+#include <mutex>
+#include <condition_variable>
 #include "../storage/mmap_manager.h"
+#include "serializer.h"
+#include "bloom_filter.h"
+#include "block.h"
+#include "block_cache.h"
+#include "table_cache.h"
+#include "lsm_options.h"
+#include "compression.h"
+#include "sstable_builder.h"
+#include "record_type.h"
+#include "range_tombstone.h"
+#include "manifest.h"
+#include "learned_index.h"
 
 // Forward declaration
 template <typename Key, typename Value>
@@ -15,97 +29,290 @@ class MemTable;
 
 /**
  * SSTable - Sorted String Table for on-disk storage in the LSM-Tree
- * 
+ *
  * This class represents an immutable, sorted table of key-value pairs stored on disk.
  * It includes index blocks for fast lookups and supports Bloom filters to quickly
  * determine if a key might be present.
+ *
+ * File layout:
+ *   [data blocks]   prefix-compressed entries with restart points (see Block),
+ *                   each optionally compressed and followed by a one-byte
+ *                   codec id trailer (format v4+); every value starts with
+ *                   a one-byte RecordType (format v5+)
+ *   [index block]   one entry per data block: last key -> varint offset, varint size
+ *   [range dels]    range tombstones as a block of start key -> end key
+ *                   (format v6+, may be empty)
+ *   [learned index] piecewise-linear model of the index for arithmetic
+ *                   keys (format v7+, may be empty; see LearnedIndex)
+ *   [filter]        blocked Bloom filter over the encoded keys, padded to
+ *                   start on a cache-line boundary (may be empty)
+ *   [meta]          varint len | minKey bytes | varint len | maxKey bytes
+ *                   (v6+: | varint offset | varint size of the range dels)
+ *                   (v7+: | varint offset | varint size of the learned index)
+ *   [footer]        keyCount, level, dataSize, indexOffset, indexSize,
+ *                   filterOffset, metaOffset, format version, magic
+ *                   (SSTABLE_FOOTER_SIZE bytes)
+ *
+ * Keys and values are encoded with Serializer<T>, so variable-size types such
+ * as std::string are stored inline rather than as raw object bytes. The sparse
+ * block index and the filter are read in place from the mapping; a lookup
+ * binary searches the index block's restart points once and then searches
+ * inside a single data block. Deleted keys are stored as
+ * tombstones; get() and range() hide them, while lookup(), rangeRecords() and
+ * the iterator expose them so newer tombstones can shadow older tables.
+ * Range tombstones are loaded at open time; the key range of the table
+ * includes them, and they hide keys of older tables but not the point
+ * entries of this one.
+ *
+ * Tables recovered from the manifest are opened lazily: the key range,
+ * counts and size come from the manifest record, and the file is mapped on
+ * the first lookup or scan. With a TableCache the mapping is closed again
+ * when the table falls out of the cache and reopened on demand.
  */
 template <typename Key, typename Value>
 class SSTable {
+private:
+    // Mapping and in-place structures of an open table (defined below)
+    struct Contents;
+
 public:
-    // Structure to represent a key-value entry in the index
-    struct IndexEntry {
-        Key key;
+    // Location of a block inside the file
+    struct BlockHandle {
         uint64_t offset;
-        uint32_t size;
+        uint64_t size;
     };
 
-    // Structure to represent an SSTable metadata
+    // Structure to represent an SSTable metadata; for a table that is not
+    // open yet only filePath, fileSize, level, keyCount, the key range and
+    // the manifest fields are known
     struct Metadata {
         uint32_t keyCount;
         uint64_t dataSize;
         uint64_t indexOffset;
+        uint64_t indexSize;
+        uint64_t filterOffset;
+        uint64_t metaOffset;
+        uint64_t fileSize;
+        uint32_t formatVersion;
         uint32_t level;
         std::string filePath;
         Key minKey;
         Key maxKey;
+        uint32_t rangeTombstoneCount = 0;
+        uint64_t learnedIndexOffset = 0;
+        uint64_t learnedIndexSize = 0;     // 0 if the table has no learned index
+        uint64_t fileNumber = 0;    // Assigned by the manifest
+        uint64_t epoch = 0;         // Newest flush the table holds (see FileMetaData)
+    };
+
+    /**
+     * Iterator - Walks the table in key order, one data block at a time
+     */
+    class Iterator {
+    public:
+        explicit Iterator(const SSTable* table);
+
+        bool valid() const;
+        void seekToFirst();
+
+        // Position at the first entry with key >= target
+        void seek(const Key& target);
+        void next();
+
+        // Current entry, decoded from the block; value() is only
+        // meaningful for RecordType::Value entries
+        typename Serializer<Key>::View keyView() const;
+        Key key() const;
+        Value value() const;
+        RecordType type() const;
+
+        // Current entry as stored on disk, without the record type
+        std::string_view rawKey() const;
+        std::string_view rawValue() const;
+
+    private:
+        const SSTable* table;
+        std::shared_ptr<const Contents> contents;  // Keeps the mapping open
+        std::unique_ptr<Block::Iterator> indexIter;
+        std::shared_ptr<const Block> block;
+        std::unique_ptr<Block::Iterator> blockIter;
+
+        // Open the data block the index iterator points at
+        void loadBlock();
+
+        // Move forward past exhausted blocks
+        void skipEmptyBlocks();
     };
 
 private:
+    // State of an open table: the mapping and the structures read in place
+    // from it. Readers hold a reference while they use it; closing the table
+    // only drops the table's (or the table cache's) reference.
+    struct Contents {
+        const SSTable* table;
+        const char* data;
+        Block index;            // Last key of each data block -> varint offset, varint size
+        BloomFilter filter;     // Blocked Bloom filter over the point entries
+        LearnedIndex<Key> learned;  // Empty unless the key type and table have one
+
+        Contents(const SSTable* table, const char* data);
+        ~Contents();
+    };
+
     // Memory-mapped file manager for I/O operations
     MMapManager* mmapManager;
-    
+
     // Metadata about this SSTable
     Metadata metadata;
-    
-    // In-memory index for fast lookups
-    std::vector<IndexEntry> index;
-    
-    // Cached data pointer from memory-mapped file
-    void* dataPtr;
-    
-    // Bloom filter for fast negative lookups
-    // In a production implementation, we'd have a proper Bloom filter class here
-    // For simplicity, we'll skip the actual implementation details
-    
-    // Load index from file
-    void loadIndex();
-    
-    // Binary search in index
-    int64_t findIndexEntry(const Key& key) const;
-    
-    // Read value from data file at offset
-    Value readValueAt(uint64_t offset, uint32_t size) const;
+
+    // Shared cache of decoded data blocks (may be null)
+    BlockCache* blockCache;
+
+    // Limits how many tables stay open (may be null: the table stays open)
+    TableCache* tableCache;
+
+    // Process-wide id used to key this table's blocks in the cache
+    uint64_t tableId;
+
+    // Set once the table has been replaced by compaction; the file is deleted on destruction
+    bool obsolete;
+
+    // Key ranges deleted in older tables
+    RangeTombstoneList<Key> rangeTombstones;
+
+    // Metadata came from the manifest; loadMetadata() only verifies it
+    bool fromManifest;
+
+    // The footer, meta section and range tombstones are read on the first open only
+    mutable std::once_flag metadataFlag;
+
+    // Guards opening; a path is mapped at most once, so a reopen waits
+    // until the previous mapping is gone
+    mutable std::mutex openMutex;
+    mutable std::condition_variable closedCV;
+    mutable bool mapped;
+    mutable std::weak_ptr<const Contents> openContents;
+
+    // Reference that keeps the table open when there is no table cache
+    mutable std::shared_ptr<const Contents> ownedContents;
+
+    // Open the table if needed and pin it for the caller
+    std::shared_ptr<const Contents> acquire() const;
+
+    // Map the file; the caller holds openMutex
+    std::shared_ptr<const Contents> open();
+
+    // Parse the footer and meta section
+    void loadMetadata(const char* data);
+
+    // Load the range tombstone block
+    void loadRangeTombstones(const char* data, uint64_t offset, uint64_t size);
+
+    // Bloom filter check for point entries only
+    bool filterMayContain(const Contents& contents, const Key& key) const;
+
+    // Decode and check a block handle from the index
+    BlockHandle decodeHandle(std::string_view handleBytes) const;
+
+    // Check a block handle against the data section
+    void checkHandle(const BlockHandle& handle) const;
+
+    // Handle of the first block whose last key is >= key, from the learned
+    // index if there is one; false if every block ends before key
+    bool findBlock(const Contents& contents, const Key& key, BlockHandle* handle) const;
+
+    // Access the contents of a data block through the block cache, decompressing if needed
+    std::shared_ptr<const Block> readBlock(const Contents& contents, const BlockHandle& handle) const;
+
+    // Split a stored value into its record type and value bytes
+    std::string_view decodeRecord(std::string_view stored, RecordType* type) const;
 
 public:
-    // Create a new SSTable from a MemTable
+    // Unique path for a table file written outside a tree (trees name their
+    // tables by manifest file number); names sort in creation order
+    static std::string newFilePath(const std::string& directory, uint32_t level);
+
+    // Write a MemTable to the given file and open it
+    static std::unique_ptr<SSTable<Key, Value>> writeMemTable(
+        const MemTable<Key, Value>& memTable,
+        MMapManager* mmapManager,
+        const std::string& filePath,
+        uint32_t level,
+        const LSMOptions& options = LSMOptions());
+
+    // Create a new SSTable from a MemTable in a new file of the directory
     static std::unique_ptr<SSTable<Key, Value>> createFromMemTable(
-        const MemTable<Key, Value>& memTable, 
+        const MemTable<Key, Value>& memTable,
         MMapManager* mmapManager,
         const std::string& directory,
-        uint32_t level);
-    
-    // Open an existing SSTable
-    SSTable(MMapManager* mmapManager, const std::string& filePath);
-    
-    // Destructor to cleanup resources
+        uint32_t level,
+        const LSMOptions& options = LSMOptions());
+
+    // Open an existing SSTable, optionally reading blocks through a shared cache
+    // and keeping it open through a table cache
+    SSTable(MMapManager* mmapManager, const std::string& filePath, BlockCache* blockCache = nullptr,
+            TableCache* tableCache = nullptr);
+
+    // Table recorded in the manifest; the file is opened on first use
+    SSTable(MMapManager* mmapManager, const std::string& filePath, const FileMetaData& fileMeta,
+            BlockCache* blockCache = nullptr, TableCache* tableCache = nullptr);
+
+    // Closes the table, deleting its file if the table is obsolete
     ~SSTable();
-    
-    // Check if key potentially exists (Bloom filter check)
+
+    SSTable(const SSTable&) = delete;
+    SSTable& operator=(const SSTable&) = delete;
+
+    // Mark the table as no longer part of the tree so its file is removed
+    void markObsolete();
+
+    // Record the manifest file number and epoch; called before the table is shared
+    void setFileNumber(uint64_t fileNumber, uint64_t epoch);
+
+    // Manifest record describing this table
+    FileMetaData getFileMetaData() const;
+
+    // Check if key potentially exists or is range deleted (key range and Bloom filter check)
     bool mayContain(const Key& key) const;
-    
-    // Get value for a key
+
+    // True if the table holds neither entries nor range tombstones
+    bool empty() const;
+
+    // Get value for a key (nothing if the key is missing or deleted)
     std::optional<Value> get(const Key& key) const;
-    
-    // Range query from start key to end key
+
+    // Look up a key, distinguishing a tombstone from a missing key
+    LookupResult lookup(const Key& key, Value& value) const;
+
+    // Range query from start key to end key, live entries only
     std::vector<std::pair<Key, Value>> range(const Key& startKey, const Key& endKey) const;
-    
+
+    // Range query that also returns tombstones (as empty values)
+    std::vector<std::pair<Key, std::optional<Value>>> rangeRecords(
+        const Key& startKey, const Key& endKey) const;
+
     // Get metadata
     const Metadata& getMetadata() const;
-    
-    // Get a specific index entry
-    const IndexEntry& getIndexEntry(size_t pos) const;
-    
-    // Get number of index entries
-    size_t getIndexSize() const;
-    
+
+    // Range tombstones stored in the table
+    const RangeTombstoneList<Key>& getRangeTombstones() const;
+
+    // Number of data blocks in the table
+    size_t getBlockCount() const;
+
+    // Largest key of each data block, from the sparse index
+    std::vector<Key> getBlockLastKeys() const;
+
     // Get file path
     const std::string& getFilePath() const;
-    
-    // Apply a function to each entry in the table
+
+    // Iterator over the whole table
+    Iterator newIterator() const;
+
+    // Apply a function to each live entry in the table
     void forEach(const std::function<void(const Key&, const Value&)>& func) const;
 };
 
 #include "sstable.tpp"
 
-#endif // SSTABLE_H
\ No newline at end of file
+#endif // SSTABLE_H
@@ -3,238 +3,545 @@
 
 #include "sstable.h"
 #include "memtable.h"
-#include <fstream>
+#include "coding.h"
 #include <algorithm>
-#include <cstring>
 #include <sstream>
 #include <filesystem>
 #include <chrono>
+#include <atomic>
+#include <iomanip>
 #include <ctime>
+#include <stdexcept>
+
+template <typename Key, typename Value>
+std::string SSTable<Key, Value>::newFilePath(const std::string& directory, uint32_t level) {
+    // The timestamp orders files across restarts, the sequence number within a process
+    static std::atomic<uint64_t> sequence{0};
+    auto timestamp = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    
+    std::string filePath;
+    do {
+        std::stringstream ss;
+        ss << directory << "/sstable_L" << level << "_" << timestamp << "_"
+           << std::setw(8) << std::setfill('0') << sequence++ << ".db";
+        filePath = ss.str();
+    } while (std::filesystem::exists(filePath));
+    return filePath;
+}
 
 template <typename Key, typename Value>
 std::unique_ptr<SSTable<Key, Value>> SSTable<Key, Value>::createFromMemTable(
     const MemTable<Key, Value>& memTable, 
     MMapManager* mmapManager,
     const std::string& directory,
-    uint32_t level) {
-    
-    // Generate a unique filename for this SSTable
-    auto now = std::chrono::system_clock::now();
-    auto timestamp = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << directory << "/sstable_L" << level << "_" << timestamp << ".db";
-    std::string filePath = ss.str();
-    
-    // Create the file header
-    std::ofstream file(filePath, std::ios::binary);
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to create SSTable file: " + filePath);
-    }
-    
-    // Prepare to write data
-    uint64_t indexOffset = 0;
-    uint32_t keyCount = 0;
+    uint32_t level,
+    const LSMOptions& options) {
     
-    // Store the min and max keys for metadata
-    Key minKey, maxKey;
-    bool firstKey = true;
+    return writeMemTable(memTable, mmapManager, newFilePath(directory, level), level, options);
+}
+
+template <typename Key, typename Value>
+std::unique_ptr<SSTable<Key, Value>> SSTable<Key, Value>::writeMemTable(
+    const MemTable<Key, Value>& memTable, 
+    MMapManager* mmapManager,
+    const std::string& filePath,
+    uint32_t level,
+    const LSMOptions& options) {
     
-    // First, write the data section
+    // Stream the sorted memtable contents into data blocks
+    SSTableBuilder<Key, Value> builder(filePath, level, options);
     for (const auto& [key, value] : memTable) {
-        if (firstKey) {
-            minKey = key;
-            maxKey = key;
-            firstKey = false;
+        if (value) {
+            builder.add(key, *value);
         } else {
-            if (key < minKey) minKey = key;
-            if (key > maxKey) maxKey = key;
+            builder.addDeletion(key);
         }
-        
-        // In a real implementation, we'd serialize key and value into a binary format
-        // For simplicity, we'll use a basic format here
-        
-        // Write the key size, key, value size, and value
-        uint32_t keySize = sizeof(key);
-        uint32_t valueSize = sizeof(value);
-        
-        file.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
-        file.write(reinterpret_cast<const char*>(&key), keySize);
-        file.write(reinterpret_cast<const char*>(&valueSize), sizeof(valueSize));
-        file.write(reinterpret_cast<const char*>(&value), valueSize);
-        
-        ++keyCount;
-    }
-    
-    // Record the index offset (start of index section)
-    indexOffset = file.tellp();
-    
-    // Now write the index entries
-    // In a real implementation, we'd use a sparse index that samples keys
-    // For simplicity, we'll index every key
-    uint64_t dataOffset = 0;
-    for (const auto& [key, value] : memTable) {
-        // Size of key and value plus their size fields
-        uint32_t entrySize = sizeof(key) + sizeof(value) + sizeof(uint32_t) * 2;
-        
-        // Write index entry (key, offset, size)
-        file.write(reinterpret_cast<const char*>(&key), sizeof(key));
-        file.write(reinterpret_cast<const char*>(&dataOffset), sizeof(dataOffset));
-        file.write(reinterpret_cast<const char*>(&entrySize), sizeof(entrySize));
-        
-        dataOffset += entrySize;
-    }
-    
-    // Finally, write the footer with metadata
-    uint64_t dataSize = indexOffset;
-    file.write(reinterpret_cast<const char*>(&keyCount), sizeof(keyCount));
-    file.write(reinterpret_cast<const char*>(&dataSize), sizeof(dataSize));
-    file.write(reinterpret_cast<const char*>(&indexOffset), sizeof(indexOffset));
-    file.write(reinterpret_cast<const char*>(&level), sizeof(level));
-    file.write(reinterpret_cast<const char*>(&minKey), sizeof(minKey));
-    file.write(reinterpret_cast<const char*>(&maxKey), sizeof(maxKey));
-    
-    file.close();
+    }
+    for (const auto& [start, end] : memTable.getRangeTombstones()) {
+        builder.addRangeTombstone(start, end);
+    }
+    builder.finish();
     
     // Create and return an SSTable object for the newly created file
-    return std::make_unique<SSTable<Key, Value>>(mmapManager, filePath);
+    return std::make_unique<SSTable<Key, Value>>(mmapManager, filePath, options.blockCache.get(),
+                                                 options.tableCache.get());
 }
 
 template <typename Key, typename Value>
-SSTable<Key, Value>::SSTable(MMapManager* mmapManager, const std::string& filePath) 
-    : mmapManager(mmapManager), dataPtr(nullptr) {
+SSTable<Key, Value>::SSTable(MMapManager* mmapManager, const std::string& filePath,
+                             BlockCache* blockCache, TableCache* tableCache) 
+    : mmapManager(mmapManager), blockCache(blockCache), tableCache(tableCache),
+      tableId(BlockCache::newTableId()), obsolete(false), fromManifest(false), mapped(false) {
     
     metadata.filePath = filePath;
     
+    // Read the metadata now; the table is not shared yet
+    acquire();
+}
+
+template <typename Key, typename Value>
+SSTable<Key, Value>::SSTable(MMapManager* mmapManager, const std::string& filePath,
+                             const FileMetaData& fileMeta, BlockCache* blockCache, TableCache* tableCache)
+    : mmapManager(mmapManager), blockCache(blockCache), tableCache(tableCache),
+      tableId(BlockCache::newTableId()), obsolete(false), fromManifest(true), mapped(false) {
+    
+    metadata.filePath = filePath;
+    metadata.fileSize = fileMeta.fileSize;
+    metadata.level = static_cast<uint32_t>(fileMeta.level);
+    metadata.keyCount = fileMeta.keyCount;
+    metadata.rangeTombstoneCount = fileMeta.rangeTombstoneCount;
+    metadata.fileNumber = fileMeta.number;
+    metadata.epoch = fileMeta.epoch;
+    metadata.formatVersion = 0;
+    if (metadata.keyCount > 0 || metadata.rangeTombstoneCount > 0) {
+        if (!Serializer<Key>::valid(fileMeta.smallestKey.data(), fileMeta.smallestKey.size()) ||
+            !Serializer<Key>::valid(fileMeta.largestKey.data(), fileMeta.largestKey.size())) {
+            throw std::runtime_error("Corrupted manifest key range for " + filePath);
+        }
+        metadata.minKey = Serializer<Key>::decode(fileMeta.smallestKey.data(), fileMeta.smallestKey.size());
+        metadata.maxKey = Serializer<Key>::decode(fileMeta.largestKey.data(), fileMeta.largestKey.size());
+    }
+}
+
+template <typename Key, typename Value>
+std::shared_ptr<const typename SSTable<Key, Value>::Contents> SSTable<Key, Value>::acquire() const {
+    std::shared_ptr<const Contents> contents;
+    {
+        std::unique_lock<std::mutex> lock(openMutex);
+        contents = openContents.lock();
+        if (!contents) {
+            // Opening only fills in state no reader has seen yet, so it may run on a const table
+            closedCV.wait(lock, [this] { return !mapped; });
+            contents = const_cast<SSTable*>(this)->open();
+            openContents = contents;
+            mapped = true;
+            if (!tableCache) {
+                ownedContents = contents;
+            }
+        }
+    }
+    
+    // Outside openMutex: evicting another table closes it under that table's lock
+    if (tableCache) {
+        tableCache->insert(tableId, contents, static_cast<size_t>(metadata.fileSize));
+    }
+    return contents;
+}
+
+template <typename Key, typename Value>
+std::shared_ptr<const typename SSTable<Key, Value>::Contents> SSTable<Key, Value>::open() {
     // Open the file with memory mapping
     // First determine the file size
-    std::filesystem::path path(filePath);
+    std::filesystem::path path(metadata.filePath);
     size_t fileSize = std::filesystem::file_size(path);
+    if (fileSize < SSTABLE_FOOTER_SIZE) {
+        throw std::runtime_error("SSTable file too small: " + metadata.filePath);
+    }
+    if (fromManifest && fileSize != metadata.fileSize) {
+        throw std::runtime_error("SSTable size does not match the manifest: " + metadata.filePath);
+    }
     
     // Memory map the whole file
-    dataPtr = mmapManager->mapFile(filePath, fileSize, true); // Read-only mapping
-    if (!dataPtr) {
-        throw std::runtime_error("Failed to memory map SSTable file: " + filePath);
+    const char* data = static_cast<const char*>(mmapManager->mapFile(metadata.filePath, fileSize, true)); // Read-only mapping
+    if (!data) {
+        throw std::runtime_error("Failed to memory map SSTable file: " + metadata.filePath);
     }
     
+    try {
+        std::call_once(metadataFlag, [this, data, fileSize]() {
+            // A manifest-known size is already checked above and may be read
+            // concurrently, so it is not written again
+            if (!fromManifest) {
+                metadata.fileSize = fileSize;
+            }
+            loadMetadata(data);
+        });
+        return std::make_shared<const Contents>(this, data);
+    } catch (...) {
+        mmapManager->unmapFile(metadata.filePath);
+        throw;
+    }
+}
+
+template <typename Key, typename Value>
+SSTable<Key, Value>::Contents::Contents(const SSTable* table, const char* data)
+    : table(table), data(data),
+      index(data + table->metadata.indexOffset, table->metadata.indexSize),
+      filter(data + table->metadata.filterOffset,
+             table->metadata.metaOffset - table->metadata.filterOffset) {
+    
+    if (!index.ok()) {
+        throw std::runtime_error("Corrupted SSTable index: " + table->metadata.filePath);
+    }
+    if constexpr (LearnedIndexTraits<Key>::supported) {
+        if (table->metadata.learnedIndexSize > 0) {
+            learned = LearnedIndex<Key>(data + table->metadata.learnedIndexOffset,
+                                        table->metadata.learnedIndexSize);
+            if (!learned.ok()) {
+                throw std::runtime_error("Corrupted SSTable learned index: " + table->metadata.filePath);
+            }
+        }
+    }
+}
+
+template <typename Key, typename Value>
+SSTable<Key, Value>::Contents::~Contents() {
+    std::lock_guard<std::mutex> lock(table->openMutex);
+    table->mmapManager->unmapFile(table->metadata.filePath);
+    table->mapped = false;
+    table->closedCV.notify_all();
+}
+
+template <typename Key, typename Value>
+SSTable<Key, Value>::~SSTable() {
+    // Drop the references that keep the table open; readers are done with it
+    if (tableCache) {
+        tableCache->erase(tableId);
+    }
+    ownedContents.reset();
+    if (obsolete) {
+        std::error_code ec;
+        std::filesystem::remove(metadata.filePath, ec);
+    }
+}
+
+template <typename Key, typename Value>
+void SSTable<Key, Value>::markObsolete() {
+    obsolete = true;
+}
+
+template <typename Key, typename Value>
+void SSTable<Key, Value>::setFileNumber(uint64_t fileNumber, uint64_t epoch) {
+    metadata.fileNumber = fileNumber;
+    metadata.epoch = epoch;
+}
+
+template <typename Key, typename Value>
+FileMetaData SSTable<Key, Value>::getFileMetaData() const {
+    FileMetaData fileMeta;
+    fileMeta.number = metadata.fileNumber;
+    fileMeta.level = static_cast<int>(metadata.level);
+    fileMeta.epoch = metadata.epoch;
+    fileMeta.fileName = std::filesystem::path(metadata.filePath).filename().string();
+    fileMeta.fileSize = metadata.fileSize;
+    fileMeta.keyCount = metadata.keyCount;
+    fileMeta.rangeTombstoneCount = metadata.rangeTombstoneCount;
+    if (!empty()) {
+        Serializer<Key>::encode(metadata.minKey, fileMeta.smallestKey);
+        Serializer<Key>::encode(metadata.maxKey, fileMeta.largestKey);
+    }
+    return fileMeta;
+}
+
+template <typename Key, typename Value>
+void SSTable<Key, Value>::loadMetadata(const char* data) {
     // Read the footer to get metadata
-    char* ptr = static_cast<char*>(dataPtr);
-    ptr += (fileSize - sizeof(Key) * 2 - sizeof(uint32_t) * 2 - sizeof(uint64_t) * 2);
-    
-    std::memcpy(&metadata.keyCount, ptr, sizeof(metadata.keyCount));
-    ptr += sizeof(metadata.keyCount);
-    
-    std::memcpy(&metadata.dataSize, ptr, sizeof(metadata.dataSize));
-    ptr += sizeof(metadata.dataSize);
+    const char* ptr = data + metadata.fileSize - SSTABLE_FOOTER_SIZE;
+    
+    // Fields known from the manifest may already be read by other threads
+    uint32_t keyCount = decodeFixed32(ptr);
+    if (!fromManifest) {
+        metadata.keyCount = keyCount;
+        metadata.level = decodeFixed32(ptr + 4);
+    } else if (keyCount != metadata.keyCount) {
+        throw std::runtime_error("SSTable does not match the manifest: " + metadata.filePath);
+    }
+    metadata.dataSize = decodeFixed64(ptr + 8);
+    metadata.indexOffset = decodeFixed64(ptr + 16);
+    metadata.indexSize = decodeFixed64(ptr + 24);
+    metadata.filterOffset = decodeFixed64(ptr + 32);
+    metadata.metaOffset = decodeFixed64(ptr + 40);
+    uint32_t version = decodeFixed32(ptr + 48);
+    uint64_t magic = decodeFixed64(ptr + 52);
+    
+    if (magic != SSTABLE_MAGIC) {
+        throw std::runtime_error("Not an SSTable (bad magic): " + metadata.filePath);
+    }
+    if (version < SSTABLE_MIN_FORMAT_VERSION || version > SSTABLE_FORMAT_VERSION) {
+        throw std::runtime_error("Unsupported SSTable format version " +
+                                 std::to_string(version) + ": " + metadata.filePath);
+    }
+    metadata.formatVersion = version;
+    if (metadata.dataSize > metadata.indexOffset ||
+        metadata.indexOffset + metadata.indexSize > metadata.filterOffset ||
+        metadata.filterOffset > metadata.metaOffset ||
+        metadata.metaOffset > metadata.fileSize - SSTABLE_FOOTER_SIZE) {
+        throw std::runtime_error("Corrupted SSTable footer: " + metadata.filePath);
+    }
     
-    std::memcpy(&metadata.indexOffset, ptr, sizeof(metadata.indexOffset));
-    ptr += sizeof(metadata.indexOffset);
+    // The meta section holds the encoded key range
+    const char* limit = data + metadata.fileSize - SSTABLE_FOOTER_SIZE;
+    ptr = data + metadata.metaOffset;
+    uint32_t minLen = 0, maxLen = 0;
     
-    std::memcpy(&metadata.level, ptr, sizeof(metadata.level));
-    ptr += sizeof(metadata.level);
+    ptr = getVarint32(ptr, limit, &minLen);
+    if (!ptr || static_cast<size_t>(limit - ptr) < minLen) {
+        throw std::runtime_error("Corrupted SSTable meta section: " + metadata.filePath);
+    }
+    const char* minPtr = ptr;
+    ptr += minLen;
     
-    std::memcpy(&metadata.minKey, ptr, sizeof(metadata.minKey));
-    ptr += sizeof(metadata.minKey);
+    ptr = getVarint32(ptr, limit, &maxLen);
+    if (!ptr || static_cast<size_t>(limit - ptr) < maxLen) {
+        throw std::runtime_error("Corrupted SSTable meta section: " + metadata.filePath);
+    }
+    const char* maxPtr = ptr;
+    ptr += maxLen;
+    
+    uint64_t tombstoneOffset = 0, tombstoneSize = 0;
+    if (version >= 6) {
+        ptr = getVarint64(ptr, limit, &tombstoneOffset);
+        if (ptr) {
+            ptr = getVarint64(ptr, limit, &tombstoneSize);
+        }
+        if (!ptr || (tombstoneSize > 0 &&
+                     (tombstoneOffset < metadata.indexOffset + metadata.indexSize ||
+                      tombstoneOffset + tombstoneSize > metadata.filterOffset))) {
+            throw std::runtime_error("Corrupted SSTable meta section: " + metadata.filePath);
+        }
+    }
+    if (version >= 7) {
+        ptr = getVarint64(ptr, limit, &metadata.learnedIndexOffset);
+        if (ptr) {
+            ptr = getVarint64(ptr, limit, &metadata.learnedIndexSize);
+        }
+        if (!ptr || (metadata.learnedIndexSize > 0 &&
+                     (metadata.learnedIndexOffset < metadata.indexOffset + metadata.indexSize ||
+                      metadata.learnedIndexOffset + metadata.learnedIndexSize > metadata.filterOffset))) {
+            throw std::runtime_error("Corrupted SSTable meta section: " + metadata.filePath);
+        }
+    }
     
-    std::memcpy(&metadata.maxKey, ptr, sizeof(metadata.maxKey));
+    if (!fromManifest && (metadata.keyCount > 0 || tombstoneSize > 0)) {
+        metadata.minKey = Serializer<Key>::decode(minPtr, minLen);
+        metadata.maxKey = Serializer<Key>::decode(maxPtr, maxLen);
+    }
+    if (tombstoneSize > 0) {
+        loadRangeTombstones(data, tombstoneOffset, tombstoneSize);
+    }
+    if (!fromManifest) {
+        metadata.rangeTombstoneCount = static_cast<uint32_t>(rangeTombstones.size());
+    }
+}
+
+template <typename Key, typename Value>
+void SSTable<Key, Value>::loadRangeTombstones(const char* data, uint64_t offset, uint64_t size) {
+    Block tombstoneBlock(data + offset, size);
+    Block::Iterator it(&tombstoneBlock);
+    
+    for (it.seekToFirst(); it.valid(); it.next()) {
+        std::string_view startBytes = it.key();
+        std::string_view endBytes = it.value();
+        if (!Serializer<Key>::valid(startBytes.data(), startBytes.size()) ||
+            !Serializer<Key>::valid(endBytes.data(), endBytes.size())) {
+            throw std::runtime_error("Corrupted SSTable range tombstones: " + metadata.filePath);
+        }
+        rangeTombstones.add(Serializer<Key>::decode(startBytes.data(), startBytes.size()),
+                            Serializer<Key>::decode(endBytes.data(), endBytes.size()));
+    }
     
-    // Load the index
-    loadIndex();
+    if (it.corrupted()) {
+        throw std::runtime_error("Corrupted SSTable range tombstones: " + metadata.filePath);
+    }
 }
 
 template <typename Key, typename Value>
-SSTable<Key, Value>::~SSTable() {
-    // The MMapManager will handle unmapping the file
+typename SSTable<Key, Value>::BlockHandle SSTable<Key, Value>::decodeHandle(std::string_view handleBytes) const {
+    // Index entries are checked as they are used rather than all at open time
+    const char* ptr = handleBytes.data();
+    const char* limit = ptr + handleBytes.size();
+    
+    BlockHandle handle;
+    ptr = getVarint64(ptr, limit, &handle.offset);
+    if (ptr) {
+        ptr = getVarint64(ptr, limit, &handle.size);
+    }
+    if (!ptr) {
+        throw std::runtime_error("Corrupted SSTable index: " + metadata.filePath);
+    }
+    checkHandle(handle);
+    return handle;
 }
 
 template <typename Key, typename Value>
-void SSTable<Key, Value>::loadIndex() {
-    // Read the index entries from the memory-mapped file
-    char* ptr = static_cast<char*>(dataPtr);
-    ptr += metadata.indexOffset;
-    
-    for (uint32_t i = 0; i < metadata.keyCount; ++i) {
-        IndexEntry entry;
-        
-        std::memcpy(&entry.key, ptr, sizeof(entry.key));
-        ptr += sizeof(entry.key);
-        
-        std::memcpy(&entry.offset, ptr, sizeof(entry.offset));
-        ptr += sizeof(entry.offset);
-        
-        std::memcpy(&entry.size, ptr, sizeof(entry.size));
-        ptr += sizeof(entry.size);
-        
-        index.push_back(entry);
+void SSTable<Key, Value>::checkHandle(const BlockHandle& handle) const {
+    size_t trailerSize = metadata.formatVersion >= 4 ? BLOCK_TRAILER_SIZE : 0;
+    if (handle.offset + handle.size + trailerSize > metadata.dataSize) {
+        throw std::runtime_error("Corrupted SSTable index: " + metadata.filePath);
     }
 }
 
 template <typename Key, typename Value>
-int64_t SSTable<Key, Value>::findIndexEntry(const Key& key) const {
-    // Binary search for the key in the index
-    int64_t left = 0;
-    int64_t right = static_cast<int64_t>(index.size()) - 1;
-    
-    while (left <= right) {
-        int64_t mid = left + (right - left) / 2;
-        
-        if (index[mid].key == key) {
-            return mid;  // Exact match
-        }
-        
-        if (index[mid].key < key) {
-            left = mid + 1;
-        } else {
-            right = mid - 1;
+bool SSTable<Key, Value>::findBlock(const Contents& contents, const Key& key, BlockHandle* handle) const {
+    // Jump close to the block with the learned index and search a small window
+    if constexpr (LearnedIndexTraits<Key>::supported) {
+        if (!contents.learned.empty()) {
+            if (!contents.learned.find(key, &handle->offset, &handle->size)) {
+                return false;
+            }
+            checkHandle(*handle);
+            return true;
         }
     }
     
-    return -1;  // Not found
+    // Otherwise binary search the restart points of the mapped index block
+    Block::Iterator it(&contents.index);
+    it.seek([&key](std::string_view keyBytes) {
+        return Serializer<Key>::decodeView(keyBytes.data(), keyBytes.size()) < key;
+    });
+    if (it.corrupted()) {
+        throw std::runtime_error("Corrupted SSTable index: " + metadata.filePath);
+    }
+    if (!it.valid()) {
+        return false;
+    }
+    *handle = decodeHandle(it.value());
+    return true;
 }
 
 template <typename Key, typename Value>
-Value SSTable<Key, Value>::readValueAt(uint64_t offset, uint32_t size) const {
-    // Navigate to the offset in the memory-mapped file
-    char* ptr = static_cast<char*>(dataPtr) + offset;
+std::shared_ptr<const Block> SSTable<Key, Value>::readBlock(const Contents& openTable,
+                                                            const BlockHandle& handle) const {
+    if (blockCache) {
+        if (auto cached = blockCache->lookup(tableId, handle.offset)) {
+            return cached;
+        }
+    }
     
-    // Skip the key size and key
-    uint32_t keySize;
-    std::memcpy(&keySize, ptr, sizeof(keySize));
-    ptr += sizeof(keySize) + keySize;
+    const char* contents = openTable.data + handle.offset;
     
-    // Read the value size
-    uint32_t valueSize;
-    std::memcpy(&valueSize, ptr, sizeof(valueSize));
-    ptr += sizeof(valueSize);
+    // Tables before v4 have no trailer and are never compressed
+    CompressionType type = CompressionType::None;
+    if (metadata.formatVersion >= 4) {
+        type = static_cast<CompressionType>(contents[handle.size]);
+    }
     
-    // Read the value
-    Value value;
-    std::memcpy(&value, ptr, sizeof(value));
+    std::shared_ptr<const Block> block;
+    if (type == CompressionType::None && !blockCache) {
+        // Uncompressed blocks are read in place from the mapping
+        block = std::make_shared<const Block>(contents, handle.size);
+    } else if (type == CompressionType::None) {
+        // Cached blocks get their own copy so hits never fault on the mapping
+        block = std::make_shared<const Block>(std::string(contents, handle.size));
+    } else {
+        const CompressionCodec* codec = getCompressionCodec(type);
+        if (!codec) {
+            throw std::runtime_error("SSTable block uses unavailable compression codec " +
+                                     std::to_string(static_cast<int>(type)) + ": " + metadata.filePath);
+        }
+        std::string uncompressed;
+        if (!codec->decompress(std::string_view(contents, handle.size), uncompressed)) {
+            throw std::runtime_error("Failed to decompress SSTable block: " + metadata.filePath);
+        }
+        block = std::make_shared<const Block>(std::move(uncompressed));
+    }
     
-    return value;
+    if (!block->ok()) {
+        throw std::runtime_error("Corrupted SSTable data block: " + metadata.filePath);
+    }
+    
+    if (blockCache) {
+        blockCache->insert(tableId, handle.offset, block, block->size() + sizeof(Block));
+    }
+    return block;
+}
+
+template <typename Key, typename Value>
+std::string_view SSTable<Key, Value>::decodeRecord(std::string_view stored, RecordType* type) const {
+    // Tables before v5 only hold values
+    if (metadata.formatVersion < 5) {
+        *type = RecordType::Value;
+        return stored;
+    }
+    if (stored.size() < RECORD_TYPE_SIZE ||
+        static_cast<uint8_t>(stored[0]) > static_cast<uint8_t>(RecordType::Deletion)) {
+        throw std::runtime_error("Corrupted SSTable record: " + metadata.filePath);
+    }
+    *type = static_cast<RecordType>(stored[0]);
+    return stored.substr(RECORD_TYPE_SIZE);
+}
+
+template <typename Key, typename Value>
+bool SSTable<Key, Value>::empty() const {
+    return metadata.keyCount == 0 && metadata.rangeTombstoneCount == 0;
 }
 
 template <typename Key, typename Value>
 bool SSTable<Key, Value>::mayContain(const Key& key) const {
-    // In a real implementation, we'd check a Bloom filter first
-    // For now, we'll just check if the key is within our range
-    return key >= metadata.minKey && key <= metadata.maxKey;
+    // Cheap key range check first, then the range tombstones and the Bloom filter
+    if (empty() || key < metadata.minKey || key > metadata.maxKey) {
+        return false;
+    }
+    auto contents = acquire();
+    return rangeTombstones.covers(key) || filterMayContain(*contents, key);
+}
+
+template <typename Key, typename Value>
+bool SSTable<Key, Value>::filterMayContain(const Contents& contents, const Key& key) const {
+    if (metadata.keyCount == 0) {
+        return false;
+    }
+    if (contents.filter.empty()) {
+        return true;
+    }
+    
+    std::string keyBytes;
+    Serializer<Key>::encode(key, keyBytes);
+    return contents.filter.mayContain(BloomFilter::hash(keyBytes.data(), keyBytes.size()));
 }
 
 template <typename Key, typename Value>
 std::optional<Value> SSTable<Key, Value>::get(const Key& key) const {
+    Value value;
+    if (lookup(key, value) == LookupResult::Found) {
+        return value;
+    }
+    return std::nullopt;
+}
+
+template <typename Key, typename Value>
+LookupResult SSTable<Key, Value>::lookup(const Key& key, Value& value) const {
+    if (empty() || key < metadata.minKey || key > metadata.maxKey) {
+        return LookupResult::NotFound;
+    }
+    auto contents = acquire();
+    
+    // Point entries are newer than the table's own range tombstones
+    LookupResult notFound = rangeTombstones.covers(key) ? LookupResult::Deleted : LookupResult::NotFound;
+    
     // Check if key might be in this table
-    if (!mayContain(key)) {
-        return std::nullopt;
+    if (!filterMayContain(*contents, key)) {
+        return notFound;
     }
     
-    // Find the key in the index
-    int64_t pos = findIndexEntry(key);
-    if (pos < 0) {
-        return std::nullopt;
+    // Find the one block that can hold the key, then search inside it
+    BlockHandle handle;
+    if (!findBlock(*contents, key, &handle)) {
+        return notFound;
     }
     
-    // Read the value from the data section
-    return readValueAt(index[pos].offset, index[pos].size);
+    auto block = readBlock(*contents, handle);
+    Block::Iterator it(block.get());
+    it.seek([&key](std::string_view keyBytes) {
+        return Serializer<Key>::decodeView(keyBytes.data(), keyBytes.size()) < key;
+    });
+    if (it.corrupted()) {
+        throw std::runtime_error("Corrupted SSTable data block: " + metadata.filePath);
+    }
+    
+    if (!it.valid() || !(Serializer<Key>::decodeView(it.key().data(), it.key().size()) == key)) {
+        return notFound;
+    }
+    
+    RecordType type;
+    std::string_view valueBytes = decodeRecord(it.value(), &type);
+    if (type == RecordType::Deletion) {
+        return LookupResult::Deleted;
+    }
+    
+    // Read the value straight from the block
+    value = Serializer<Value>::decode(valueBytes.data(), valueBytes.size());
+    return LookupResult::Found;
 }
 
 template <typename Key, typename Value>
@@ -242,23 +549,33 @@ std::vector<std::pair<Key, Value>> SSTable<Key, Value>::range(
     const Key& startKey, const Key& endKey) const {
     
     std::vector<std::pair<Key, Value>> result;
+    for (auto& [key, value] : rangeRecords(startKey, endKey)) {
+        if (value) {
+            result.emplace_back(std::move(key), std::move(*value));
+        }
+    }
+    return result;
+}
+
+template <typename Key, typename Value>
+std::vector<std::pair<Key, std::optional<Value>>> SSTable<Key, Value>::rangeRecords(
+    const Key& startKey, const Key& endKey) const {
+    
+    std::vector<std::pair<Key, std::optional<Value>>> result;
     
     // Check if range overlaps with this table
-    if (startKey > metadata.maxKey || endKey < metadata.minKey) {
+    if (metadata.keyCount == 0 || startKey > metadata.maxKey || endKey < metadata.minKey) {
         return result;  // No overlap
     }
     
-    // Find the first key >= startKey
-    auto it = std::lower_bound(index.begin(), index.end(), startKey,
-        [](const IndexEntry& entry, const Key& key) {
-            return entry.key < key;
-        });
-    
-    // Collect entries until we reach endKey
-    while (it != index.end() && it->key <= endKey) {
-        Value value = readValueAt(it->offset, it->size);
-        result.emplace_back(it->key, value);
-        ++it;
+    // Find the first key >= startKey and collect entries until we pass endKey
+    Iterator it(this);
+    for (it.seek(startKey); it.valid() && !(endKey < it.keyView()); it.next()) {
+        if (it.type() == RecordType::Deletion) {
+            result.emplace_back(it.key(), std::nullopt);
+        } else {
+            result.emplace_back(it.key(), it.value());
+        }
     }
     
     return result;
@@ -271,14 +588,41 @@ SSTable<Key, Value>::getMetadata() const {
 }
 
 template <typename Key, typename Value>
-const typename SSTable<Key, Value>::IndexEntry& 
-SSTable<Key, Value>::getIndexEntry(size_t pos) const {
-    return index[pos];
+const RangeTombstoneList<Key>& SSTable<Key, Value>::getRangeTombstones() const {
+    // Loaded with the metadata on the first open
+    if (metadata.rangeTombstoneCount > 0) {
+        acquire();
+    }
+    return rangeTombstones;
 }
 
 template <typename Key, typename Value>
-size_t SSTable<Key, Value>::getIndexSize() const {
-    return index.size();
+size_t SSTable<Key, Value>::getBlockCount() const {
+    auto contents = acquire();
+    size_t count = 0;
+    Block::Iterator it(&contents->index);
+    for (it.seekToFirst(); it.valid(); it.next()) {
+        ++count;
+    }
+    return count;
+}
+
+template <typename Key, typename Value>
+std::vector<Key> SSTable<Key, Value>::getBlockLastKeys() const {
+    auto contents = acquire();
+    std::vector<Key> keys;
+    Block::Iterator it(&contents->index);
+    for (it.seekToFirst(); it.valid(); it.next()) {
+        std::string_view keyBytes = it.key();
+        if (!Serializer<Key>::valid(keyBytes.data(), keyBytes.size())) {
+            throw std::runtime_error("Corrupted SSTable index: " + metadata.filePath);
+        }
+        keys.push_back(Serializer<Key>::decode(keyBytes.data(), keyBytes.size()));
+    }
+    if (it.corrupted()) {
+        throw std::runtime_error("Corrupted SSTable index: " + metadata.filePath);
+    }
+    return keys;
 }
 
 template <typename Key, typename Value>
@@ -286,14 +630,126 @@ const std::string& SSTable<Key, Value>::getFilePath() const {
     return metadata.filePath;
 }
 
+template <typename Key, typename Value>
+typename SSTable<Key, Value>::Iterator SSTable<Key, Value>::newIterator() const {
+    return Iterator(this);
+}
+
 template <typename Key, typename Value>
 void SSTable<Key, Value>::forEach(
     const std::function<void(const Key&, const Value&)>& func) const {
     
-    for (const auto& entry : index) {
-        Value value = readValueAt(entry.offset, entry.size);
-        func(entry.key, value);
+    Iterator it(this);
+    for (it.seekToFirst(); it.valid(); it.next()) {
+        if (it.type() == RecordType::Value) {
+            func(it.key(), it.value());
+        }
+    }
+}
+
+// Iterator implementation
+
+template <typename Key, typename Value>
+SSTable<Key, Value>::Iterator::Iterator(const SSTable* table)
+    : table(table), contents(table->acquire()),
+      indexIter(std::make_unique<Block::Iterator>(&contents->index)) {
+}
+
+template <typename Key, typename Value>
+bool SSTable<Key, Value>::Iterator::valid() const {
+    return blockIter && blockIter->valid();
+}
+
+template <typename Key, typename Value>
+void SSTable<Key, Value>::Iterator::loadBlock() {
+    blockIter.reset();
+    block.reset();
+    if (indexIter->corrupted()) {
+        throw std::runtime_error("Corrupted SSTable index: " + table->metadata.filePath);
+    }
+    if (indexIter->valid()) {
+        block = table->readBlock(*contents, table->decodeHandle(indexIter->value()));
+        blockIter = std::make_unique<Block::Iterator>(block.get());
+    }
+}
+
+template <typename Key, typename Value>
+void SSTable<Key, Value>::Iterator::skipEmptyBlocks() {
+    while (blockIter && !blockIter->valid()) {
+        if (blockIter->corrupted()) {
+            throw std::runtime_error("Corrupted SSTable data block: " + table->metadata.filePath);
+        }
+        indexIter->next();
+        loadBlock();
+        if (blockIter) {
+            blockIter->seekToFirst();
+        }
+    }
+}
+
+template <typename Key, typename Value>
+void SSTable<Key, Value>::Iterator::seekToFirst() {
+    indexIter->seekToFirst();
+    loadBlock();
+    if (blockIter) {
+        blockIter->seekToFirst();
     }
+    skipEmptyBlocks();
+}
+
+template <typename Key, typename Value>
+void SSTable<Key, Value>::Iterator::seek(const Key& target) {
+    auto lessThanTarget = [&target](std::string_view keyBytes) {
+        return Serializer<Key>::decodeView(keyBytes.data(), keyBytes.size()) < target;
+    };
+    indexIter->seek(lessThanTarget);
+    loadBlock();
+    if (blockIter) {
+        blockIter->seek(lessThanTarget);
+    }
+    skipEmptyBlocks();
+}
+
+template <typename Key, typename Value>
+void SSTable<Key, Value>::Iterator::next() {
+    blockIter->next();
+    skipEmptyBlocks();
+}
+
+template <typename Key, typename Value>
+typename Serializer<Key>::View SSTable<Key, Value>::Iterator::keyView() const {
+    std::string_view bytes = blockIter->key();
+    return Serializer<Key>::decodeView(bytes.data(), bytes.size());
+}
+
+template <typename Key, typename Value>
+Key SSTable<Key, Value>::Iterator::key() const {
+    std::string_view bytes = blockIter->key();
+    return Serializer<Key>::decode(bytes.data(), bytes.size());
+}
+
+template <typename Key, typename Value>
+Value SSTable<Key, Value>::Iterator::value() const {
+    std::string_view bytes = rawValue();
+    return Serializer<Value>::decode(bytes.data(), bytes.size());
+}
+
+template <typename Key, typename Value>
+RecordType SSTable<Key, Value>::Iterator::type() const {
+    RecordType type;
+    table->decodeRecord(blockIter->value(), &type);
+    return type;
+}
+
+template <typename Key, typename Value>
+std::string_view SSTable<Key, Value>::Iterator::rawKey() const {
+    return blockIter->key();
+}
+
+template <typename Key, typename Value>
+std::string_view SSTable<Key, Value>::Iterator::rawValue() const {
+    RecordType type;
+    return table->decodeRecord(blockIter->value(), &type);
 }
 
-#endif // SSTABLE_TPP
\ No newline at end of file
+#endif // SSTABLE_TPP
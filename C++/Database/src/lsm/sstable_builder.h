@@ -0,0 +1,117 @@
+#ifndef SSTABLE_BUILDER_H
+#define SSTABLE_BUILDER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <memory>
+#include "block.h"
+#include "lsm_options.h"
+#include "serializer.h"
+#include "record_type.h"
+#include "range_tombstone.h"
+#include "learned_index.h"
+
+// On-disk format constants
+constexpr uint64_t SSTABLE_MAGIC = 0x4c534d5353544231ULL; // "LSMSSTB1"
+constexpr uint32_t SSTABLE_FORMAT_VERSION = 7;
+constexpr uint32_t SSTABLE_MIN_FORMAT_VERSION = 3;  // v3: data blocks without a trailer
+constexpr size_t SSTABLE_FOOTER_SIZE = 60;
+constexpr size_t BLOCK_TRAILER_SIZE = 1;            // v4+: codec id after each data block
+constexpr size_t RECORD_TYPE_SIZE = 1;              // v5+: RecordType before each value
+
+/**
+ * SSTableBuilder - Streams sorted key-value pairs into a new SSTable file
+ *
+ * Entries are packed into prefix-compressed data blocks which are written as
+ * soon as they reach the configured block size, so memory use is bounded by
+ * one block plus the sparse index. Each data block is passed through the
+ * configured codec and followed by a one-byte trailer naming the codec.
+ * Every stored value starts with a one-byte RecordType, so tombstones are
+ * written as entries with no value bytes. Range tombstones are collected
+ * separately and written as their own block by finish(). For arithmetic keys
+ * a learned index over the data blocks' last keys is fitted as well.
+ * finish() appends the index block, Bloom filter, key range and footer (see
+ * SSTable for the file layout). Writes go through options.rateLimiter, if
+ * set, at the builder's I/O priority.
+ */
+template <typename Key, typename Value>
+class SSTableBuilder {
+public:
+    SSTableBuilder(const std::string& filePath, uint32_t level,
+                   const LSMOptions& options = LSMOptions(),
+                   RateLimiter::Priority ioPriority = RateLimiter::Priority::High);
+    
+    // Removes the partially written file unless finish() succeeded
+    ~SSTableBuilder();
+    
+    SSTableBuilder(const SSTableBuilder&) = delete;
+    SSTableBuilder& operator=(const SSTableBuilder&) = delete;
+    
+    // Add an entry; keys must be strictly increasing
+    void add(const Key& key, const Value& value);
+    
+    // Add a tombstone for the key
+    void addDeletion(const Key& key);
+    
+    // Add an already serialized entry (valueBytes is empty for a deletion)
+    void addEncoded(std::string_view keyBytes, std::string_view valueBytes,
+                    RecordType type = RecordType::Value);
+    
+    // Delete [start, end] in older tables; may be called in any order
+    void addRangeTombstone(const Key& start, const Key& end);
+    
+    // Write the remaining sections and close the file
+    void finish();
+    
+    // Stop building and delete the file
+    void abandon();
+    
+    // Number of entries added so far (range tombstones not included)
+    uint32_t entryCount() const { return keyCount; }
+    
+    // True if neither entries nor range tombstones were added
+    bool empty() const { return keyCount == 0 && rangeTombstones.empty(); }
+    
+    // Bytes written so far plus the pending data block
+    uint64_t fileSize() const { return offset + dataBlock.currentSizeEstimate(); }
+    
+    const std::string& getFilePath() const { return filePath; }
+
+private:
+    std::string filePath;
+    uint32_t level;
+    LSMOptions options;
+    std::ofstream file;
+    
+    BlockBuilder dataBlock;
+    BlockBuilder indexBlock;
+    std::vector<uint64_t> keyHashes;
+    RangeTombstoneList<Key> rangeTombstones;
+    std::unique_ptr<typename LearnedIndex<Key>::Builder> learnedIndex;  // Null if disabled
+    std::string minKeyBytes;
+    std::string keyScratch;
+    std::string valueScratch;
+    std::string compressed;
+    const CompressionCodec* codec;
+    RateLimiter::Priority ioPriority;
+    
+    uint64_t offset;
+    uint32_t keyCount;
+    bool closed;
+    
+    // Append a key and its type-prefixed value to the data block
+    void addRecord(std::string_view keyBytes, std::string_view recordBytes);
+    
+    // Write the pending data block and record it in the index
+    void flushDataBlock();
+    
+    // Append raw bytes to the file
+    void write(std::string_view bytes);
+};
+
+#include "sstable_builder.tpp"
+
+#endif // SSTABLE_BUILDER_H
@@ -0,0 +1,247 @@
+#ifndef SSTABLE_BUILDER_TPP
+#define SSTABLE_BUILDER_TPP
+
+#include "sstable_builder.h"
+#include "bloom_filter.h"
+#include "coding.h"
+#include <filesystem>
+#include <stdexcept>
+
+template <typename Key, typename Value>
+SSTableBuilder<Key, Value>::SSTableBuilder(
+    const std::string& filePath, uint32_t level, const LSMOptions& options,
+    RateLimiter::Priority ioPriority)
+    : filePath(filePath), level(level), options(options),
+      dataBlock(options.blockRestartInterval), indexBlock(1),
+      codec(getCompressionCodec(options.compression)), ioPriority(ioPriority),
+      offset(0), keyCount(0), closed(false) {
+    
+    if (options.compression != CompressionType::None && codec == nullptr) {
+        throw std::runtime_error("Compression codec " +
+                                 std::to_string(static_cast<int>(options.compression)) +
+                                 " is not available in this build");
+    }
+    
+    file.open(filePath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to create SSTable file: " + filePath);
+    }
+    
+    if constexpr (LearnedIndexTraits<Key>::supported) {
+        if (options.learnedIndexEpsilon > 0) {
+            learnedIndex = std::make_unique<typename LearnedIndex<Key>::Builder>(options.learnedIndexEpsilon);
+        }
+    }
+}
+
+template <typename Key, typename Value>
+SSTableBuilder<Key, Value>::~SSTableBuilder() {
+    if (!closed) {
+        abandon();
+    }
+}
+
+template <typename Key, typename Value>
+void SSTableBuilder<Key, Value>::add(const Key& key, const Value& value) {
+    keyScratch.clear();
+    valueScratch.clear();
+    Serializer<Key>::encode(key, keyScratch);
+    valueScratch.push_back(static_cast<char>(RecordType::Value));
+    Serializer<Value>::encode(value, valueScratch);
+    addRecord(keyScratch, valueScratch);
+}
+
+template <typename Key, typename Value>
+void SSTableBuilder<Key, Value>::addDeletion(const Key& key) {
+    keyScratch.clear();
+    Serializer<Key>::encode(key, keyScratch);
+    char type = static_cast<char>(RecordType::Deletion);
+    addRecord(keyScratch, std::string_view(&type, RECORD_TYPE_SIZE));
+}
+
+template <typename Key, typename Value>
+void SSTableBuilder<Key, Value>::addEncoded(std::string_view keyBytes, std::string_view valueBytes,
+                                            RecordType type) {
+    valueScratch.clear();
+    valueScratch.push_back(static_cast<char>(type));
+    valueScratch.append(valueBytes.data(), valueBytes.size());
+    addRecord(keyBytes, valueScratch);
+}
+
+template <typename Key, typename Value>
+void SSTableBuilder<Key, Value>::addRangeTombstone(const Key& start, const Key& end) {
+    rangeTombstones.add(start, end);
+}
+
+template <typename Key, typename Value>
+void SSTableBuilder<Key, Value>::addRecord(std::string_view keyBytes, std::string_view recordBytes) {
+    if (keyCount == 0) {
+        minKeyBytes.assign(keyBytes.data(), keyBytes.size());
+    }
+    
+    // Tombstones are added to the filter too, so lookups find them
+    if (options.bloomBitsPerKey > 0) {
+        keyHashes.push_back(BloomFilter::hash(keyBytes.data(), keyBytes.size()));
+    }
+    
+    dataBlock.add(keyBytes, recordBytes);
+    ++keyCount;
+    
+    if (dataBlock.currentSizeEstimate() >= options.blockSize) {
+        flushDataBlock();
+    }
+}
+
+template <typename Key, typename Value>
+void SSTableBuilder<Key, Value>::flushDataBlock() {
+    if (dataBlock.empty()) {
+        return;
+    }
+    
+    std::string_view contents = dataBlock.finish();
+    
+    // Keep the compressed form only if it saves at least 12.5%
+    CompressionType type = CompressionType::None;
+    if (codec && codec->compress(contents, compressed) &&
+        compressed.size() < contents.size() - contents.size() / 8) {
+        contents = compressed;
+        type = codec->type();
+    }
+    
+    uint64_t blockOffset = offset;
+    write(contents);
+    char trailer = static_cast<char>(type);
+    write(std::string_view(&trailer, BLOCK_TRAILER_SIZE));
+    
+    // Sparse index: one entry per block, keyed by the block's last key
+    std::string handle;
+    putVarint64(handle, blockOffset);
+    putVarint64(handle, contents.size());
+    indexBlock.add(dataBlock.lastKey(), handle);
+    if constexpr (LearnedIndexTraits<Key>::supported) {
+        if (learnedIndex) {
+            learnedIndex->add(dataBlock.lastKey(), blockOffset, contents.size());
+        }
+    }
+    
+    dataBlock.reset();
+}
+
+template <typename Key, typename Value>
+void SSTableBuilder<Key, Value>::write(std::string_view bytes) {
+    if (options.rateLimiter) {
+        options.rateLimiter->request(static_cast<int64_t>(bytes.size()), ioPriority);
+    }
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    offset += bytes.size();
+}
+
+template <typename Key, typename Value>
+void SSTableBuilder<Key, Value>::finish() {
+    // The last key of the table is the last key of the final data block
+    // (or of the last flushed block, which the index records)
+    std::string maxKeyBytes(dataBlock.empty() ? indexBlock.lastKey() : dataBlock.lastKey());
+    flushDataBlock();
+    uint64_t dataSize = offset;
+    
+    // Sparse index block
+    uint64_t indexOffset = offset;
+    std::string_view indexContents = indexBlock.finish();
+    write(indexContents);
+    uint64_t indexSize = indexContents.size();
+    
+    // Range tombstone block: start key -> end key, disjoint and in key order
+    uint64_t rangeTombstoneOffset = offset;
+    uint64_t rangeTombstoneSize = 0;
+    if (!rangeTombstones.empty()) {
+        BlockBuilder tombstoneBlock(1);
+        std::string startBytes, endBytes;
+        for (const auto& [start, end] : rangeTombstones) {
+            startBytes.clear();
+            endBytes.clear();
+            Serializer<Key>::encode(start, startBytes);
+            Serializer<Key>::encode(end, endBytes);
+            tombstoneBlock.add(startBytes, endBytes);
+        }
+        std::string_view tombstoneContents = tombstoneBlock.finish();
+        write(tombstoneContents);
+        rangeTombstoneSize = tombstoneContents.size();
+    }
+    
+    // Learned index over the same blocks as the index block
+    uint64_t learnedIndexOffset = offset;
+    uint64_t learnedIndexSize = 0;
+    if constexpr (LearnedIndexTraits<Key>::supported) {
+        if (learnedIndex && !learnedIndex->empty()) {
+            std::string learnedBytes = learnedIndex->finish();
+            write(learnedBytes);
+            learnedIndexSize = learnedBytes.size();
+        }
+    }
+    
+    // The table's key range covers its range tombstones as well
+    if (!rangeTombstones.empty()) {
+        if (keyCount == 0 ||
+            rangeTombstones.smallestKey() < Serializer<Key>::decode(minKeyBytes.data(), minKeyBytes.size())) {
+            minKeyBytes.clear();
+            Serializer<Key>::encode(rangeTombstones.smallestKey(), minKeyBytes);
+        }
+        if (keyCount == 0 ||
+            Serializer<Key>::decode(maxKeyBytes.data(), maxKeyBytes.size()) < rangeTombstones.largestKey()) {
+            maxKeyBytes.clear();
+            Serializer<Key>::encode(rangeTombstones.largestKey(), maxKeyBytes);
+        }
+    }
+    
+    // Bloom filter, aligned so each filter block sits in a single cache line
+    std::string filterBytes = BloomFilter::build(keyHashes, options.bloomBitsPerKey);
+    if (!filterBytes.empty()) {
+        size_t padding = (BloomFilter::BLOCK_BYTES - offset % BloomFilter::BLOCK_BYTES) % BloomFilter::BLOCK_BYTES;
+        write(std::string(padding, '\0'));
+    }
+    uint64_t filterOffset = offset;
+    write(filterBytes);
+    
+    // Key range for the table and the location of the range tombstones
+    uint64_t metaOffset = offset;
+    std::string meta;
+    putVarint32(meta, static_cast<uint32_t>(minKeyBytes.size()));
+    meta.append(minKeyBytes);
+    putVarint32(meta, static_cast<uint32_t>(maxKeyBytes.size()));
+    meta.append(maxKeyBytes);
+    putVarint64(meta, rangeTombstoneOffset);
+    putVarint64(meta, rangeTombstoneSize);
+    putVarint64(meta, learnedIndexOffset);
+    putVarint64(meta, learnedIndexSize);
+    
+    // Finally, the fixed-size footer
+    putFixed32(meta, keyCount);
+    putFixed32(meta, level);
+    putFixed64(meta, dataSize);
+    putFixed64(meta, indexOffset);
+    putFixed64(meta, indexSize);
+    putFixed64(meta, filterOffset);
+    putFixed64(meta, metaOffset);
+    putFixed32(meta, SSTABLE_FORMAT_VERSION);
+    putFixed64(meta, SSTABLE_MAGIC);
+    write(meta);
+    
+    file.close();
+    closed = true;
+    if (!file) {
+        std::filesystem::remove(filePath);
+        throw std::runtime_error("Failed to write SSTable file: " + filePath);
+    }
+}
+
+template <typename Key, typename Value>
+void SSTableBuilder<Key, Value>::abandon() {
+    if (file.is_open()) {
+        file.close();
+    }
+    closed = true;
+    std::error_code ec;
+    std::filesystem::remove(filePath, ec);
+}
+
+#endif // SSTABLE_BUILDER_TPP
@@ -0,0 +1,71 @@
+#include "table_cache.h"
+#include <vector>
+
+TableCache::TableCache(size_t maxOpenTables, size_t maxMappedBytes)
+    : maxOpenTables(maxOpenTables), maxMappedBytes(maxMappedBytes), usage(0),
+      hits(0), misses(0), evictions(0) {
+}
+
+void TableCache::insert(uint64_t tableId, std::shared_ptr<const void> handle, size_t charge) {
+    // Evicted tables are released after the lock is dropped: closing one
+    // takes that table's own lock
+    std::vector<std::shared_ptr<const void>> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        
+        auto existing = table.find(tableId);
+        if (existing != table.end()) {
+            lru.splice(lru.begin(), lru, existing->second);
+            if (existing->second->handle != handle) {
+                // Reopened after eviction; the old state belongs to a pinned reader
+                evicted.push_back(std::move(existing->second->handle));
+                existing->second->handle = std::move(handle);
+            }
+            ++hits;
+            return;
+        }
+        
+        ++misses;
+        lru.push_front(Entry{tableId, std::move(handle), charge});
+        table[tableId] = lru.begin();
+        usage += charge;
+        
+        // Close the coldest tables, never the one just opened
+        while (lru.size() > 1 &&
+               ((maxOpenTables > 0 && lru.size() > maxOpenTables) ||
+                (maxMappedBytes > 0 && usage > maxMappedBytes))) {
+            Entry& victim = lru.back();
+            usage -= victim.charge;
+            evicted.push_back(std::move(victim.handle));
+            table.erase(victim.tableId);
+            lru.pop_back();
+            ++evictions;
+        }
+    }
+}
+
+void TableCache::erase(uint64_t tableId) {
+    std::shared_ptr<const void> handle;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = table.find(tableId);
+        if (it == table.end()) {
+            return;
+        }
+        handle = std::move(it->second->handle);
+        usage -= it->second->charge;
+        lru.erase(it->second);
+        table.erase(it);
+    }
+}
+
+TableCache::Stats TableCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats{};
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.evictions = evictions;
+    stats.openTables = lru.size();
+    stats.mappedBytes = usage;
+    return stats;
+}
@@ -0,0 +1,69 @@
+#ifndef TABLE_CACHE_H
+#define TABLE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * TableCache - Bounds the number of SSTables that are open at once
+ *
+ * An open table holds a memory mapping of its file plus the index and filter
+ * read in place from it. The cache keeps a reference to each open table's
+ * state in LRU order and drops the coldest ones once more than maxOpenTables
+ * tables or maxMappedBytes mapped bytes are open (0 means no limit). A table
+ * whose reference is dropped is closed once its last reader lets go, and is
+ * reopened on its next access. One cache is shared by every SSTable of an
+ * LSMTree, and can be shared across trees by passing it in LSMOptions.
+ */
+class TableCache {
+public:
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        size_t openTables;
+        size_t mappedBytes;
+    };
+
+    TableCache(size_t maxOpenTables, size_t maxMappedBytes = 0);
+
+    TableCache(const TableCache&) = delete;
+    TableCache& operator=(const TableCache&) = delete;
+
+    /**
+     * Record an access to an open table, keeping it open
+     * @param handle the table's open state; the cache holds it until eviction
+     * @param charge mapped bytes of the table
+     */
+    void insert(uint64_t tableId, std::shared_ptr<const void> handle, size_t charge);
+
+    // Forget a table that is being destroyed
+    void erase(uint64_t tableId);
+
+    Stats getStats() const;
+
+private:
+    struct Entry {
+        uint64_t tableId;
+        std::shared_ptr<const void> handle;
+        size_t charge;
+    };
+
+    size_t maxOpenTables;
+    size_t maxMappedBytes;
+
+    mutable std::mutex mutex;
+    std::list<Entry> lru;  // Front is most recently used
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> table;
+    size_t usage;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+};
+
+#endif // TABLE_CACHE_H
@@ -0,0 +1,41 @@
+#ifndef VERSION_H
+#define VERSION_H
+
+#include <memory>
+#include <vector>
+#include "sstable.h"
+
+/**
+ * Version - Immutable snapshot of the live tables of every level
+ *
+ * CompactionManager publishes a new Version whenever a flush, a compaction
+ * or a dropped table changes its levels, and never modifies a published
+ * one. A reader holding a Version can search its tables without locks: the
+ * tables stay open, and the files of tables a compaction replaced stay on
+ * disk, until the last Version referring to them is released.
+ */
+template <typename Key, typename Value>
+class Version {
+public:
+    using SSTablePtr = std::shared_ptr<SSTable<Key, Value>>;
+    using SSTableList = std::vector<SSTablePtr>;
+
+    // Level 0 oldest first, deeper levels sorted by key
+    explicit Version(std::vector<SSTableList> levels) : levels(std::move(levels)) {}
+
+    // Tables that might contain a key, newest first
+    std::vector<SSTable<Key, Value>*> getTablesForKey(const Key& key) const;
+
+    // Tables that overlap [startKey, endKey], newest first
+    std::vector<SSTable<Key, Value>*> getTablesForRange(const Key& startKey, const Key& endKey) const;
+
+    size_t getLevelCount() const { return levels.size(); }
+    size_t getTableCount(int level) const;
+
+private:
+    std::vector<SSTableList> levels;
+};
+
+#include "version.tpp"
+
+#endif // VERSION_H
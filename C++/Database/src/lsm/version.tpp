@@ -0,0 +1,70 @@
+#ifndef VERSION_TPP
+#define VERSION_TPP
+
+#include "version.h"
+#include <algorithm>
+
+template <typename Key, typename Value>
+std::vector<SSTable<Key, Value>*> Version<Key, Value>::getTablesForKey(const Key& key) const {
+    std::vector<SSTable<Key, Value>*> result;
+    
+    // For level 0, check all tables (newest first) since they might overlap
+    for (auto it = levels[0].rbegin(); it != levels[0].rend(); ++it) {
+        const auto& table = *it;
+        if (table->mayContain(key)) {
+            result.push_back(table.get());
+        }
+    }
+    
+    // For other levels, tables are sorted and non-overlapping, so at most one
+    // table per level: the first whose largest key is >= key
+    for (size_t level = 1; level < levels.size(); ++level) {
+        const auto& tables = levels[level];
+        auto it = std::lower_bound(tables.begin(), tables.end(), key,
+            [](const SSTablePtr& table, const Key& k) {
+                return table->getMetadata().maxKey < k;
+            });
+        if (it != tables.end() && (*it)->mayContain(key)) {
+            result.push_back(it->get());
+        }
+    }
+    
+    return result;
+}
+
+template <typename Key, typename Value>
+std::vector<SSTable<Key, Value>*> Version<Key, Value>::getTablesForRange(const Key& startKey,
+                                                                         const Key& endKey) const {
+    std::vector<SSTable<Key, Value>*> result;
+    
+    // For level 0, check all tables (newest first) since they might overlap
+    for (auto it = levels[0].rbegin(); it != levels[0].rend(); ++it) {
+        const auto& table = *it;
+        if (!(table->getMetadata().maxKey < startKey || 
+              table->getMetadata().minKey > endKey)) {
+            result.push_back(table.get());
+        }
+    }
+    
+    // For other levels, find all tables that overlap with the range
+    for (size_t level = 1; level < levels.size(); ++level) {
+        for (const auto& table : levels[level]) {
+            if (!(table->getMetadata().maxKey < startKey || 
+                  table->getMetadata().minKey > endKey)) {
+                result.push_back(table.get());
+            }
+        }
+    }
+    
+    return result;
+}
+
+template <typename Key, typename Value>
+size_t Version<Key, Value>::getTableCount(int level) const {
+    if (level < 0 || level >= static_cast<int>(levels.size())) {
+        return 0;
+    }
+    return levels[level].size();
+}
+
+#endif // VERSION_TPP
@@ -0,0 +1,166 @@
+#include "wal.h"
+#include "coding.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr size_t RECORD_HEADER_SIZE = 8;  // fixed32 crc | fixed32 length
+
+} // namespace
+
+WriteAheadLog::WriteAheadLog(const std::string& path, uint64_t number, WALSyncMode syncMode,
+                             uint64_t syncIntervalMs)
+    : path(path), number(number), syncMode(syncMode), syncInterval(syncIntervalMs),
+      file(std::fopen(path.c_str(), "ab")), lastSync(std::chrono::steady_clock::now()),
+      unsynced(false), failed(false), stopping(false) {
+    if (!file) {
+        throw std::runtime_error("Failed to create write-ahead log: " + path);
+    }
+    if (syncMode == WALSyncMode::Interval) {
+        timerThread = std::thread(&WriteAheadLog::timerThreadFunc, this);
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    if (timerThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        timerCV.notify_all();
+        timerThread.join();
+    }
+    if (syncMode != WALSyncMode::None) {
+        syncFile();
+    }
+    std::fclose(file);
+}
+
+bool WriteAheadLog::append(std::string_view payload) {
+    std::string record;
+    putFixed32(record, crc32(payload.data(), payload.size()));
+    putFixed32(record, static_cast<uint32_t>(payload.size()));
+    record.append(payload.data(), payload.size());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (failed) {
+        return false;
+    }
+    if (std::fwrite(record.data(), 1, record.size(), file) != record.size() || std::fflush(file) != 0) {
+        failed = true;
+        std::cerr << "Failed to write " << path << "; the segment takes no more records" << std::endl;
+        return false;
+    }
+    ++stats.records;
+    stats.bytes += record.size();
+
+    bool due = false;
+    switch (syncMode) {
+        case WALSyncMode::None:
+            break;
+        case WALSyncMode::PerBatch:
+            due = true;
+            break;
+        case WALSyncMode::Interval:
+            due = std::chrono::steady_clock::now() - lastSync >= syncInterval;
+            break;
+    }
+    if (!due) {
+        unsynced = true;
+        return true;
+    }
+    return syncLocked();
+}
+
+bool WriteAheadLog::sync() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !failed && syncLocked();
+}
+
+bool WriteAheadLog::syncLocked() {
+    lastSync = std::chrono::steady_clock::now();
+    unsynced = false;
+    ++stats.syncs;
+    if (!syncFile()) {
+        failed = true;
+        std::cerr << "Failed to sync " << path << "; the segment takes no more records" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void WriteAheadLog::timerThreadFunc() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!timerCV.wait_for(lock, syncInterval, [this] { return stopping; })) {
+        if (unsynced && !failed && syncLocked()) {
+            ++stats.timedSyncs;
+        }
+    }
+}
+
+bool WriteAheadLog::syncFile() {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0;
+#elif defined(__linux__)
+    return fdatasync(fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+WriteAheadLog::Stats WriteAheadLog::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+bool WriteAheadLog::replay(const std::string& path,
+                           const std::function<void(std::string_view)>& func) {
+    std::string contents;
+    bool intact = read(path, contents);
+    forEachRecord(contents, func);
+    return intact;
+}
+
+bool WriteAheadLog::read(const std::string& path, std::string& contents) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Failed to open write-ahead log: " + path);
+    }
+    contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+    size_t pos = 0;
+    while (pos < contents.size()) {
+        size_t remaining = contents.size() - pos;
+        uint32_t length = remaining < RECORD_HEADER_SIZE ? 0 : decodeFixed32(contents.data() + pos + 4);
+        if (remaining < RECORD_HEADER_SIZE || remaining - RECORD_HEADER_SIZE < length ||
+            crc32(contents.data() + pos + RECORD_HEADER_SIZE, length) != decodeFixed32(contents.data() + pos)) {
+            // Drop the torn or corrupt tail
+            contents.resize(pos);
+            return false;
+        }
+        pos += RECORD_HEADER_SIZE + length;
+    }
+    return true;
+}
+
+void WriteAheadLog::forEachRecord(std::string_view contents,
+                                  const std::function<void(std::string_view)>& func) {
+    size_t pos = 0;
+    while (pos < contents.size()) {
+        uint32_t length = decodeFixed32(contents.data() + pos + 4);
+        func(contents.substr(pos + RECORD_HEADER_SIZE, length));
+        pos += RECORD_HEADER_SIZE + length;
+    }
+}
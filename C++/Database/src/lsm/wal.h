@@ -0,0 +1,116 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "lsm_options.h"
+
+/**
+ * WriteAheadLog - One segment of the write-ahead log
+ *
+ * Each memtable has its own segment, and every write reaches the segment
+ * before the memtable. Records are framed like manifest records
+ * (fixed32 crc | fixed32 length | payload), so a segment is replayed up to
+ * its first torn or corrupt record and a crash during an append loses only
+ * that write.
+ *
+ * Appends and syncs are serialized by the segment's mutex. The tree already
+ * group commits concurrent writers into one record, so a whole write group
+ * costs one append and at most one fdatasync.
+ *
+ * In Interval mode an append is synced when the interval has passed since
+ * the last sync, and a timer thread syncs whatever is still unsynced once per
+ * interval, so the last writes before the log goes quiet are not left
+ * unsynced.
+ *
+ * The segment is deleted by the tree once the memtable's table is recorded
+ * in the manifest.
+ */
+class WriteAheadLog {
+public:
+    struct Stats {
+        uint64_t records = 0;   // Records appended
+        uint64_t syncs = 0;     // fdatasync calls, timed ones included
+        uint64_t timedSyncs = 0;  // Syncs of an idle tail by the interval timer
+        uint64_t bytes = 0;     // Bytes written, framing included
+    };
+
+    // Create the segment file; throws if it cannot be created
+    WriteAheadLog(const std::string& path, uint64_t number, WALSyncMode syncMode,
+                  uint64_t syncIntervalMs = 100);
+
+    // Stops the interval timer, syncs (unless the sync mode is None) and
+    // closes the segment
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    /**
+     * Append one record and return once it is written (and synced, as the
+     * sync mode says)
+     * @return false on an I/O error; the segment then takes no more records
+     */
+    bool append(std::string_view payload);
+
+    // Force everything written so far to stable storage
+    bool sync();
+
+    uint64_t getNumber() const { return number; }
+    const std::string& getPath() const { return path; }
+    Stats getStats() const;
+
+    /**
+     * Call func with each intact record of a segment, in order
+     * @return false if the segment ends in a torn or corrupt record
+     */
+    static bool replay(const std::string& path, const std::function<void(std::string_view)>& func);
+
+    /**
+     * Read a segment and check its records; contents is cut after the last
+     * intact record, ready for forEachRecord
+     * @return false if the segment ends in a torn or corrupt record
+     */
+    static bool read(const std::string& path, std::string& contents);
+
+    // Call func with each record of contents checked by read()
+    static void forEachRecord(std::string_view contents, const std::function<void(std::string_view)>& func);
+
+private:
+    std::string path;
+    uint64_t number;
+    WALSyncMode syncMode;
+    std::chrono::milliseconds syncInterval;
+
+    // The file and everything below are guarded by the mutex
+    mutable std::mutex mutex;
+    std::FILE* file;
+    std::chrono::steady_clock::time_point lastSync;
+
+    // Set when a record is written without a sync, cleared by a sync
+    bool unsynced;
+    bool failed;
+    Stats stats;
+
+    // Interval timer (Interval mode only); waits on timerCV under the mutex
+    std::thread timerThread;
+    std::condition_variable timerCV;
+    bool stopping;
+
+    // Sync an unsynced tail once per interval until the segment is closed
+    void timerThreadFunc();
+
+    // Sync the file and record it; the caller holds the mutex
+    bool syncLocked();
+
+    bool syncFile();
+};
+
+#endif // WAL_H
@@ -0,0 +1,68 @@
+#ifndef WRITE_BATCH_H
+#define WRITE_BATCH_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include "record_type.h"
+
+/**
+ * WriteBatch - Puts, deletes and range deletes applied to an LSMTree as one
+ *
+ * The tree logs a batch as a single write-ahead log record, applies it to
+ * one memtable and makes its writes visible to readers together, so after a
+ * crash either every write of the batch is recovered or none is, and readers
+ * never see part of a batch. Later writes in a batch take precedence over earlier ones.
+ *
+ * Log record format: varint32 count, then per write a type byte and the
+ * length-prefixed key, followed by the length-prefixed value of a put or the
+ * length-prefixed end key of a range delete.
+ */
+template <typename Key, typename Value>
+class WriteBatch {
+public:
+    // One write of the batch
+    struct Entry {
+        RecordType type;
+        Key key;
+        std::optional<Value> value;  // Set for RecordType::Value
+        Key endKey;                  // Set for RecordType::RangeDeletion
+    };
+
+    void put(const Key& key, const Value& value);
+
+    // Write a tombstone for key
+    void remove(const Key& key);
+
+    // Delete every key in [startKey, endKey]; an empty range is ignored
+    void deleteRange(const Key& startKey, const Key& endKey);
+
+    void clear() { entries.clear(); }
+    bool empty() const { return entries.empty(); }
+    size_t count() const { return entries.size(); }
+
+    const std::vector<Entry>& getEntries() const { return entries; }
+    
+    // Encoded size of the keys and values of the batch
+    size_t approximateSize() const;
+
+    // Append the batch as one log record to out
+    void encode(std::string& out) const;
+
+    // Append several batches, in order, as one log record to out
+    static void encode(const std::vector<const WriteBatch*>& batches, std::string& out);
+
+    /**
+     * Append the writes of a log record to the batch
+     * @return false (adding nothing) if the record is malformed
+     */
+    bool decode(std::string_view record);
+
+private:
+    std::vector<Entry> entries;
+};
+
+#include "write_batch.tpp"
+
+#endif // WRITE_BATCH_H
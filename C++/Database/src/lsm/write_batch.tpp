@@ -0,0 +1,134 @@
+#ifndef WRITE_BATCH_TPP
+#define WRITE_BATCH_TPP
+
+#include "write_batch.h"
+#include "coding.h"
+#include "serializer.h"
+#include <type_traits>
+
+template <typename Key, typename Value>
+void WriteBatch<Key, Value>::put(const Key& key, const Value& value) {
+    entries.push_back(Entry{RecordType::Value, key, value, Key()});
+}
+
+template <typename Key, typename Value>
+void WriteBatch<Key, Value>::remove(const Key& key) {
+    entries.push_back(Entry{RecordType::Deletion, key, std::nullopt, Key()});
+}
+
+template <typename Key, typename Value>
+void WriteBatch<Key, Value>::deleteRange(const Key& startKey, const Key& endKey) {
+    if (endKey < startKey) {
+        return;
+    }
+    entries.push_back(Entry{RecordType::RangeDeletion, startKey, std::nullopt, endKey});
+}
+
+template <typename Key, typename Value>
+size_t WriteBatch<Key, Value>::approximateSize() const {
+    size_t size = 0;
+    for (const auto& entry : entries) {
+        size += Serializer<Key>::encodedSize(entry.key);
+        if (entry.type == RecordType::Value) {
+            size += Serializer<Value>::encodedSize(*entry.value);
+        } else if (entry.type == RecordType::RangeDeletion) {
+            size += Serializer<Key>::encodedSize(entry.endKey);
+        }
+    }
+    return size;
+}
+
+template <typename Key, typename Value>
+void WriteBatch<Key, Value>::encode(std::string& out) const {
+    encode({this}, out);
+}
+
+template <typename Key, typename Value>
+void WriteBatch<Key, Value>::encode(const std::vector<const WriteBatch*>& batches, std::string& out) {
+    auto putField = [&out](const auto& field) {
+        using T = std::decay_t<decltype(field)>;
+        putVarint32(out, static_cast<uint32_t>(Serializer<T>::encodedSize(field)));
+        Serializer<T>::encode(field, out);
+    };
+
+    size_t count = 0;
+    for (const auto* batch : batches) {
+        count += batch->count();
+    }
+
+    putVarint32(out, static_cast<uint32_t>(count));
+    for (const auto* batch : batches) {
+        for (const auto& entry : batch->entries) {
+            out.push_back(static_cast<char>(entry.type));
+            putField(entry.key);
+            if (entry.type == RecordType::Value) {
+                putField(*entry.value);
+            } else if (entry.type == RecordType::RangeDeletion) {
+                putField(entry.endKey);
+            }
+        }
+    }
+}
+
+template <typename Key, typename Value>
+bool WriteBatch<Key, Value>::decode(std::string_view record) {
+    const char* ptr = record.data();
+    const char* limit = record.data() + record.size();
+
+    // Read one length-prefixed field, checking it decodes as T
+    auto getField = [&](auto* out) {
+        using T = std::remove_pointer_t<decltype(out)>;
+        uint32_t length = 0;
+        ptr = ptr ? getVarint32(ptr, limit, &length) : nullptr;
+        if (!ptr || static_cast<size_t>(limit - ptr) < length || !Serializer<T>::valid(ptr, length)) {
+            ptr = nullptr;
+            return false;
+        }
+        *out = Serializer<T>::decode(ptr, length);
+        ptr += length;
+        return true;
+    };
+
+    // A malformed record contributes none of its writes
+    size_t first = entries.size();
+    auto fail = [&] {
+        entries.resize(first);
+        return false;
+    };
+
+    uint32_t count = 0;
+    ptr = getVarint32(ptr, limit, &count);
+    for (uint32_t i = 0; ptr && i < count; ++i) {
+        if (ptr == limit) {
+            return fail();
+        }
+        Entry entry{static_cast<RecordType>(*ptr++), Key(), std::nullopt, Key()};
+        if (!getField(&entry.key)) {
+            return fail();
+        }
+
+        switch (entry.type) {
+            case RecordType::Value: {
+                Value value;
+                if (!getField(&value)) {
+                    return fail();
+                }
+                entry.value = std::move(value);
+                break;
+            }
+            case RecordType::Deletion:
+                break;
+            case RecordType::RangeDeletion:
+                if (!getField(&entry.endKey)) {
+                    return fail();
+                }
+                break;
+            default:
+                return fail();
+        }
+        entries.push_back(std::move(entry));
+    }
+    return ptr == limit || fail();
+}
+
+#endif // WRITE_BATCH_TPP
@@ -0,0 +1,73 @@
+#include "arena.h"
+#include <algorithm>
+#include <new>
+
+namespace {
+
+constexpr size_t ARENA_ALIGNMENT = alignof(std::max_align_t);
+
+size_t alignSize(size_t bytes) {
+    return (bytes + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+} // namespace
+
+Arena::Arena(size_t blockSize)
+    : blockSize(std::max<size_t>(blockSize, 256)), current(nullptr), memoryUsage(0) {
+}
+
+Arena::~Arena() {
+    // One release per block, however many objects were placed in it
+    for (Block* block : blocks) {
+        block->~Block();
+        ::operator delete(block);
+    }
+}
+
+char* Arena::memoryOf(Block* block) {
+    return reinterpret_cast<char*>(block) + alignSize(sizeof(Block));
+}
+
+Arena::Block* Arena::newBlock(size_t size) {
+    size_t bytes = alignSize(sizeof(Block)) + size;
+    void* memory = ::operator new(bytes);
+    auto* block = new (memory) Block(size);
+    try {
+        blocks.push_back(block);
+    } catch (...) {
+        ::operator delete(memory);
+        throw;
+    }
+    memoryUsage.fetch_add(bytes, std::memory_order_relaxed);
+    return block;
+}
+
+char* Arena::allocate(size_t bytes) {
+    bytes = alignSize(std::max<size_t>(bytes, 1));
+
+    // Large objects would waste most of a shared block
+    if (bytes > blockSize / 4) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return memoryOf(newBlock(bytes));
+    }
+
+    while (true) {
+        Block* block = current.load(std::memory_order_acquire);
+        if (block) {
+            size_t offset = block->used.fetch_add(bytes, std::memory_order_relaxed);
+            if (offset + bytes <= block->size) {
+                return memoryOf(block) + offset;
+            }
+        }
+
+        // The block is exhausted; the first thread to get here replaces it
+        std::lock_guard<std::mutex> lock(mutex);
+        if (current.load(std::memory_order_relaxed) == block) {
+            current.store(newBlock(blockSize - alignSize(sizeof(Block))), std::memory_order_release);
+        }
+    }
+}
+
+size_t Arena::getMemoryUsage() const {
+    return memoryUsage.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,88 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// Default size of an arena block, header included
+constexpr size_t ARENA_BLOCK_SIZE = 1024 * 1024;
+
+// Bump allocator whose memory is released all at once when the arena is
+// destroyed. Allocation is thread-safe; the common case is a single atomic
+// add on the current block, and a mutex is only taken to start a new block.
+// Blocks are large and come straight from operator new, so a 64 MB memtable
+// costs about 64 system allocations and as many frees. Destructors of
+// objects placed in the arena are not run.
+class Arena {
+private:
+    // Header at the start of each block, followed by size usable bytes
+    struct Block {
+        size_t size;
+        std::atomic<size_t> used;
+
+        explicit Block(size_t size) : size(size), used(0) {}
+    };
+
+    // Bytes requested for a shared block, header included
+    const size_t blockSize;
+
+    // Block that small allocations are carved from (null until the first one)
+    std::atomic<Block*> current;
+
+    // Every block ever allocated, released in the destructor
+    std::vector<Block*> blocks;
+    std::mutex mutex;
+
+    // Bytes of all blocks, including headers and the unused tail of each
+    std::atomic<size_t> memoryUsage;
+
+    // Allocate a block with at least size usable bytes; the caller holds the mutex
+    Block* newBlock(size_t size);
+
+    static char* memoryOf(Block* block);
+
+public:
+    // Allocations larger than a quarter of blockSize get a block of their own
+    explicit Arena(size_t blockSize = ARENA_BLOCK_SIZE);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Allocate bytes aligned for any fundamental type
+    char* allocate(size_t bytes);
+
+    // Total bytes reserved for the arena
+    size_t getMemoryUsage() const;
+};
+
+// Standard allocator that places container nodes in an Arena; deallocation
+// is a no-op, the memory goes away with the arena
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena* arena) : arena(arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) { return reinterpret_cast<T*>(arena->allocate(n * sizeof(T))); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+    template <typename U>
+    friend class ArenaAllocator;
+
+    Arena* arena;
+};
+
+#endif // ARENA_H
@@ -1,15 +1,22 @@
 #include "mmap_manager.h"
 #include "../utils/logger.h"
 #include <system_error>
+#include <vector>
 
 MMapManager::~MMapManager() {
-    // Unmap all files on destruction
-    for (auto& [path, mapping] : mappings) {
+    // Unmap all files on destruction (copy the keys first, unmapFile erases entries)
+    std::vector<std::string> paths;
+    paths.reserve(mappings.size());
+    for (const auto& [path, _] : mappings) {
+        paths.push_back(path);
+    }
+    for (const auto& path : paths) {
         unmapFile(path);
     }
 }
 
 void* MMapManager::mapFile(const std::string& path, size_t size, bool readOnly, bool create) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
 #ifdef _WIN32
     // Windows implementation
     DWORD access = readOnly ? GENERIC_READ : (GENERIC_READ | GENERIC_WRITE);
@@ -126,6 +133,7 @@ void* MMapManager::mapFile(const std::string& path, size_t size, bool readOnly,
 }
 
 bool MMapManager::unmapFile(const std::string& path) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
     auto it = mappings.find(path);
     if (it == mappings.end()) {
         LOG_WARNING("Attempted to unmap non-existent file: " + path);
@@ -159,6 +167,7 @@ bool MMapManager::unmapFile(const std::string& path) {
 }
 
 void* MMapManager::getMapping(const std::string& path) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
     auto it = mappings.find(path);
     if (it == mappings.end()) {
         LOG_DEBUG("Attempted to get mapping for non-existent file: " + path);
@@ -168,6 +177,7 @@ void* MMapManager::getMapping(const std::string& path) {
 }
 
 bool MMapManager::syncFile(const std::string& path) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
     auto it = mappings.find(path);
     if (it == mappings.end() || it->second.readOnly) {
         LOG_WARNING("Cannot sync file (not mapped or read-only): " + path);
@@ -194,6 +204,7 @@ bool MMapManager::syncFile(const std::string& path) {
 }
 
 void MMapManager::closeAll() {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
     LOG_INFO("MMapManager: Closing all memory mappings (" + std::to_string(mappings.size()) + " files)...");
     
     // Make a copy of the keys to avoid iterator invalidation during unmapFile calls
@@ -4,6 +4,7 @@
 #include <string>
 #include <cstdint>
 #include <unordered_map>
+#include <mutex>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -28,6 +29,10 @@ private:
     };
     
     std::unordered_map<std::string, FileMapping> mappings;
+    
+    // Mappings are opened and closed from flush and compaction threads
+    // (recursive so closeAll can reuse unmapFile)
+    std::recursive_mutex mutex;
 
 public:
     MMapManager() = default;
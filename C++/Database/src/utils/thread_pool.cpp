@@ -0,0 +1,53 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t numThreads) : stopping(false) {
+    numThreads = std::max<size_t>(numThreads, 1);
+    workers.reserve(numThreads);
+    for (size_t i = 0; i < numThreads; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push(std::move(task));
+    }
+    cv.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+            
+            // Drain the queue before exiting
+            if (tasks.empty()) {
+                return;
+            }
+            
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        
+        task();
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+/**
+ * ThreadPool - Fixed set of worker threads running queued tasks
+ *
+ * submit() returns a future for the task's result; exceptions thrown by a
+ * task are delivered through that future. The destructor finishes the
+ * queued tasks before joining the workers.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t numThreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F&& task);
+
+    size_t size() const { return workers.size(); }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping;
+
+    void enqueue(std::function<void()> task);
+    void workerLoop();
+};
+
+template <typename F>
+std::future<std::invoke_result_t<F>> ThreadPool::submit(F&& task) {
+    using Result = std::invoke_result_t<F>;
+
+    // std::function needs a copyable target, so share the packaged task
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> result = packaged->get_future();
+    enqueue([packaged]() { (*packaged)(); });
+    return result;
+}
+
+#endif // THREAD_POOL_H
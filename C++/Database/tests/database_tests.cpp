@@ -2,6 +2,8 @@
 #include <string>
 #include <functional>
 #include <vector>
+#include <atomic>
+#include <thread>
 #include "../src/database/database.h"
 #include "../src/utils/logger.h"
 
@@ -56,6 +58,115 @@ bool test_database_put_get() {
     }
 }
 
+bool test_database_write_batch() {
+    try {
+        Database db("test_db");
+        
+        // Sync a few keys so reads find their copies in the B+Tree
+        for (int key = 1000; key < 1064; ++key) {
+            db.put(key, "old_" + std::to_string(key));
+        }
+        db.sync();
+        
+        // A batch that overwrites and deletes synced keys, applied while a
+        // reader checks that it never sees half of it
+        WriteBatch<int, std::string> batch;
+        for (int key = 1000; key < 1032; ++key) {
+            batch.put(key, "new_" + std::to_string(key));
+        }
+        batch.remove(1040);
+        batch.deleteRange(1050, 1059);
+        
+        std::atomic<bool> done(false);
+        std::atomic<bool> torn(false);
+        std::thread reader([&] {
+            while (!done.load()) {
+                // Once the range delete at the end of the batch is visible,
+                // the puts at its start must be visible too
+                std::string last;
+                bool applied = !db.get(1055, last);
+                std::string first;
+                db.get(1000, first);
+                if (applied && first != "new_1000") {
+                    torn.store(true);
+                }
+            }
+        });
+        
+        bool written = db.write(batch);
+        done.store(true);
+        reader.join();
+        if (!written) {
+            LOG_ERROR("Failed to write batch");
+            return false;
+        }
+        if (torn.load()) {
+            LOG_ERROR("Reader saw part of a batch");
+            return false;
+        }
+        
+        std::string value;
+        if (!db.get(1000, value) || value != "new_1000" ||
+            !db.get(1031, value) || value != "new_1031") {
+            LOG_ERROR("Batch put hidden by a synced B+Tree copy");
+            return false;
+        }
+        if (db.get(1040, value) || db.get(1055, value)) {
+            LOG_ERROR("Batch delete hidden by a synced B+Tree copy");
+            return false;
+        }
+        if (!db.get(1032, value) || value != "old_1032") {
+            LOG_ERROR("Key outside the batch lost its value");
+            return false;
+        }
+        
+        LOG_INFO("Write batch operations successful");
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during write batch: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_database_writes_over_synced_copies() {
+    try {
+        Database db("test_db");
+        for (int key = 2000; key < 2020; ++key) {
+            db.put(key, "old_" + std::to_string(key));
+        }
+        db.sync();
+        
+        // Single writes hide the synced B+Tree copies as batches do
+        std::string value;
+        if (!db.put(2000, "new_2000") || !db.get(2000, value) || value != "new_2000") {
+            LOG_ERROR("Put hidden by a synced B+Tree copy");
+            return false;
+        }
+        if (!db.remove(2001) || db.get(2001, value)) {
+            LOG_ERROR("Remove hidden by a synced B+Tree copy");
+            return false;
+        }
+        if (!db.deleteRange(2010, 2014) || db.get(2012, value) || db.range(2010, 2014).size() != 0) {
+            LOG_ERROR("Range delete hidden by a synced B+Tree copy");
+            return false;
+        }
+        
+        // The next sync brings the new values back into the B+Tree
+        db.sync();
+        if (!db.get(2000, value) || value != "new_2000" || db.get(2001, value) ||
+            !db.get(2015, value) || value != "old_2015") {
+            LOG_ERROR("Sync restored stale values");
+            return false;
+        }
+        
+        LOG_INFO("Writes over synced copies successful");
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during writes over synced copies: " + std::string(e.what()));
+        return false;
+    }
+}
+
 // Main function - entry point for the test executable
 int main() {
     // Initialize the logger with the appropriate LogLevel based on compile-time setting
@@ -90,6 +201,8 @@ int main() {
     std::vector<TestCase> testCases = {
         {"Database Creation", test_database_creation},
         {"Database Put/Get Operations", test_database_put_get},
+        {"Database Write Batch", test_database_write_batch},
+        {"Database Writes Over Synced Copies", test_database_writes_over_synced_copies},
     };
 
     // Run tests and collect results
@@ -0,0 +1,2277 @@
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <functional>
+#include <vector>
+#include <filesystem>
+#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "../src/lsm/lsm_tree.h"
+#include "../src/utils/logger.h"
+
+// Simple test case structure
+struct TestCase {
+    std::string name;
+    std::function<bool()> testFunction;
+};
+
+// Each test works in its own scratch directory
+static std::string freshDirectory(const std::string& name) {
+    std::string dir = "test_lsm_data/" + name;
+    std::filesystem::remove_all(dir);
+    return dir;
+}
+
+// Test functions
+bool test_string_values_survive_restart() {
+    try {
+        std::string dir = freshDirectory("restart");
+        const int COUNT = 1000;
+
+        {
+            LSMTree<int, std::string> tree(dir);
+            for (int i = 0; i < COUNT; i++) {
+                tree.put(i, "value-" + std::to_string(i) + std::string(i % 50, 'x'));
+            }
+            tree.flush();
+        }
+
+        // Reopen: values must come back from the SSTable bytes, not stale pointers
+        LSMTree<int, std::string> tree(dir);
+        for (int i = 0; i < COUNT; i++) {
+            auto value = tree.get(i);
+            std::string expected = "value-" + std::to_string(i) + std::string(i % 50, 'x');
+            if (!value || *value != expected) {
+                LOG_ERROR("Mismatch for key " + std::to_string(i) + " after restart");
+                return false;
+            }
+        }
+
+        auto scan = tree.range(100, 199);
+        if (scan.size() != 100 || scan.front().first != 100 || scan.back().second.rfind("value-199", 0) != 0) {
+            LOG_ERROR("Range scan after restart returned unexpected results");
+            return false;
+        }
+
+        if (tree.get(COUNT + 1).has_value()) {
+            LOG_ERROR("Lookup of a missing key returned a value");
+            return false;
+        }
+
+        LOG_INFO("String values survived restart");
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during restart test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_bloom_filter_skips_missing_keys() {
+    try {
+        std::string dir = freshDirectory("bloom");
+        std::filesystem::create_directories(dir);
+        const int COUNT = 10000;
+
+        MemTable<int, std::string> memtable(64 * 1024 * 1024);
+        for (int i = 0; i < COUNT; i++) {
+            memtable.put(i * 2, "value-" + std::to_string(i));
+        }
+
+        MMapManager mmapManager;
+        LSMOptions options;
+        options.bloomBitsPerKey = 10;
+        auto table = SSTable<int, std::string>::createFromMemTable(memtable, &mmapManager, dir, 0, options);
+
+        // No false negatives
+        for (int i = 0; i < COUNT; i++) {
+            if (!table->mayContain(i * 2)) {
+                LOG_ERROR("Bloom filter rejected present key " + std::to_string(i * 2));
+                return false;
+            }
+        }
+
+        // Odd keys are inside the key range but absent
+        int falsePositives = 0;
+        for (int i = 0; i < COUNT - 1; i++) {
+            if (table->mayContain(i * 2 + 1)) {
+                falsePositives++;
+            }
+        }
+        double rate = static_cast<double>(falsePositives) / (COUNT - 1);
+        LOG_INFO("Bloom filter false positive rate: " + std::to_string(rate));
+        if (rate > 0.03) {
+            LOG_ERROR("Bloom filter false positive rate too high: " + std::to_string(rate));
+            return false;
+        }
+
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during bloom filter test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_block_index_lookups() {
+    try {
+        std::string dir = freshDirectory("blocks");
+        std::filesystem::create_directories(dir);
+        const int COUNT = 20000;
+
+        // String keys with long shared prefixes exercise prefix compression
+        auto makeKey = [](int i) {
+            std::string digits = std::to_string(i);
+            return "tenant-0042/user/" + std::string(8 - digits.size(), '0') + digits;
+        };
+
+        MemTable<std::string, std::string> memtable(64 * 1024 * 1024);
+        for (int i = 0; i < COUNT; i++) {
+            memtable.put(makeKey(i), "value-" + std::to_string(i));
+        }
+
+        MMapManager mmapManager;
+        LSMOptions options;
+        options.blockSize = 4 * 1024;
+        auto table = SSTable<std::string, std::string>::createFromMemTable(memtable, &mmapManager, dir, 0, options);
+
+        // The in-memory index holds one entry per block, not per key
+        if (table->getBlockCount() < 2 || table->getBlockCount() * 50 > COUNT) {
+            LOG_ERROR("Unexpected block count: " + std::to_string(table->getBlockCount()));
+            return false;
+        }
+
+        for (int i = 0; i < COUNT; i += 7) {
+            auto value = table->get(makeKey(i));
+            if (!value || *value != "value-" + std::to_string(i)) {
+                LOG_ERROR("Lookup failed for " + makeKey(i));
+                return false;
+            }
+        }
+        if (table->get("tenant-0042/user/0000000x").has_value() || table->get("zzz").has_value()) {
+            LOG_ERROR("Lookup of a missing key returned a value");
+            return false;
+        }
+
+        // A range that spans several blocks
+        auto scan = table->range(makeKey(1000), makeKey(2999));
+        if (scan.size() != 2000 || scan.front().first != makeKey(1000) || scan.back().first != makeKey(2999)) {
+            LOG_ERROR("Range across blocks returned " + std::to_string(scan.size()) + " entries");
+            return false;
+        }
+
+        size_t seen = 0;
+        table->forEach([&seen](const std::string&, const std::string&) { seen++; });
+        if (seen != static_cast<size_t>(COUNT)) {
+            LOG_ERROR("Full scan returned " + std::to_string(seen) + " entries");
+            return false;
+        }
+
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during block index test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_block_compression() {
+    try {
+        // Codec round trip on repetitive and incompressible input
+        const CompressionCodec* codec = getCompressionCodec(CompressionType::LZ);
+        std::string repetitive;
+        for (int i = 0; i < 2000; i++) {
+            repetitive += "value-" + std::to_string(i);
+        }
+        std::string noisy;
+        uint32_t seed = 12345;
+        for (int i = 0; i < 5000; i++) {
+            seed = seed * 1103515245 + 12345;
+            noisy.push_back(static_cast<char>(seed >> 16));
+        }
+        for (const std::string* input : {&repetitive, &noisy}) {
+            std::string compressed, restored;
+            if (!codec->compress(*input, compressed) || !codec->decompress(compressed, restored) ||
+                restored != *input) {
+                LOG_ERROR("LZ codec round trip failed");
+                return false;
+            }
+        }
+
+        // Tables with and without compression hold the same data
+        std::string dir = freshDirectory("compression");
+        std::filesystem::create_directories(dir + "/raw");
+        std::filesystem::create_directories(dir + "/lz");
+        const int COUNT = 20000;
+
+        MemTable<int, std::string> memtable(64 * 1024 * 1024);
+        for (int i = 0; i < COUNT; i++) {
+            memtable.put(i, "value-" + std::to_string(i));
+        }
+
+        MMapManager mmapManager;
+        LSMOptions rawOptions;
+        rawOptions.compression = CompressionType::None;
+        LSMOptions lzOptions;
+        lzOptions.compression = CompressionType::LZ;
+        auto raw = SSTable<int, std::string>::createFromMemTable(memtable, &mmapManager, dir + "/raw", 0, rawOptions);
+        auto lz = SSTable<int, std::string>::createFromMemTable(memtable, &mmapManager, dir + "/lz", 0, lzOptions);
+
+        LOG_INFO("SSTable size uncompressed: " + std::to_string(raw->getMetadata().fileSize) +
+                 " bytes, LZ: " + std::to_string(lz->getMetadata().fileSize) + " bytes");
+        if (lz->getMetadata().fileSize >= raw->getMetadata().fileSize) {
+            LOG_ERROR("LZ compression did not shrink the table");
+            return false;
+        }
+
+        for (int i = 0; i < COUNT; i += 3) {
+            auto value = lz->get(i);
+            if (!value || *value != "value-" + std::to_string(i)) {
+                LOG_ERROR("Compressed table lookup failed for key " + std::to_string(i));
+                return false;
+            }
+        }
+        if (lz->range(0, COUNT) != raw->range(0, COUNT)) {
+            LOG_ERROR("Compressed and uncompressed scans differ");
+            return false;
+        }
+
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during compression test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_block_cache() {
+    try {
+        // LRU eviction inside a single shard
+        BlockCache small(3 * 1024, 0);
+        for (uint64_t offset = 0; offset < 4; offset++) {
+            small.insert(1, offset, std::make_shared<const Block>(std::string(1024, 'x')), 1024);
+        }
+        if (small.lookup(1, 0) || !small.lookup(1, 3) || small.getStats().evictions != 1) {
+            LOG_ERROR("Block cache did not evict the least recently used block");
+            return false;
+        }
+
+        std::string dir = freshDirectory("block_cache");
+        std::filesystem::create_directories(dir);
+        const int COUNT = 20000;
+
+        MemTable<int, std::string> memtable(64 * 1024 * 1024);
+        for (int i = 0; i < COUNT; i++) {
+            memtable.put(i, "value-" + std::to_string(i));
+        }
+
+        MMapManager mmapManager;
+        LSMOptions options;
+        options.blockCache = std::make_shared<BlockCache>(8 * 1024 * 1024);
+        auto table = SSTable<int, std::string>::createFromMemTable(memtable, &mmapManager, dir, 0, options);
+
+        // A skewed workload: repeated lookups of a few hot keys
+        for (int round = 0; round < 10; round++) {
+            for (int i = 0; i < 100; i++) {
+                auto value = table->get(i);
+                if (!value || *value != "value-" + std::to_string(i)) {
+                    LOG_ERROR("Cached lookup failed for key " + std::to_string(i));
+                    return false;
+                }
+            }
+        }
+
+        BlockCache::Stats stats = options.blockCache->getStats();
+        LOG_INFO("Block cache hits: " + std::to_string(stats.hits) +
+                 ", misses: " + std::to_string(stats.misses));
+        if (stats.misses > table->getBlockCount() || stats.hits < 900 ||
+            stats.usage == 0 || stats.usage > stats.capacity) {
+            LOG_ERROR("Unexpected block cache counters");
+            return false;
+        }
+
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during block cache test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_table_cache() {
+    try {
+        std::string dir = freshDirectory("table_cache");
+        std::filesystem::create_directories(dir);
+        const int TABLES = 6;
+        const int KEYS = 500;
+
+        MMapManager mmapManager;
+        LSMOptions options;
+        options.tableCache = std::make_shared<TableCache>(2);
+        std::vector<std::unique_ptr<SSTable<int, std::string>>> tables;
+        for (int t = 0; t < TABLES; t++) {
+            MemTable<int, std::string> memtable(64 * 1024 * 1024);
+            for (int i = 0; i < KEYS; i++) {
+                memtable.put(t * KEYS + i, "t" + std::to_string(t) + "-" + std::to_string(i));
+            }
+            tables.push_back(SSTable<int, std::string>::createFromMemTable(memtable, &mmapManager, dir, 0, options));
+        }
+
+        // An iterator keeps its table mapped while other tables push it out of the cache
+        int scanned = 0;
+        {
+            auto it = tables[0]->newIterator();
+            it.seekToFirst();
+            for (int round = 0; round < 3; round++) {
+                for (int t = 0; t < TABLES; t++) {
+                    for (int i = 0; i < KEYS; i += 37) {
+                        if (tables[t]->get(t * KEYS + i) != std::optional<std::string>("t" + std::to_string(t) + "-" + std::to_string(i))) {
+                            LOG_ERROR("Reopened table returned a wrong value for key " + std::to_string(t * KEYS + i));
+                            return false;
+                        }
+                    }
+                    if (options.tableCache->getStats().openTables > 2) {
+                        LOG_ERROR("Table cache kept more tables open than its limit");
+                        return false;
+                    }
+                }
+            }
+            for (; it.valid(); it.next()) {
+                if (it.key() != scanned++) {
+                    LOG_ERROR("Iterator over an evicted table lost its place");
+                    return false;
+                }
+            }
+        }
+        TableCache::Stats stats = options.tableCache->getStats();
+        if (scanned != KEYS || stats.evictions == 0) {
+            LOG_ERROR("Unexpected table cache behaviour: " + std::to_string(stats.evictions) + " evictions");
+            return false;
+        }
+        tables.clear();
+        if (options.tableCache->getStats().openTables != 0) {
+            LOG_ERROR("Destroyed tables are still in the table cache");
+            return false;
+        }
+
+        // A restart opens no table until it is read
+        std::string treeDir = freshDirectory("table_cache_tree");
+        LSMOptions treeOptions;
+        treeOptions.tableCache = std::make_shared<TableCache>(4);
+        {
+            LSMTree<int, std::string> tree(treeDir, 64, treeOptions);
+            for (int t = 0; t < TABLES; t++) {
+                for (int i = 0; i < KEYS; i++) {
+                    tree.put(t * KEYS + i, "v" + std::to_string(i));
+                }
+                tree.flush();
+            }
+        }
+        LSMTree<int, std::string> tree(treeDir, 64, treeOptions);
+        if (treeOptions.tableCache->getStats().openTables != 0) {
+            LOG_ERROR("Restart opened tables before they were needed");
+            return false;
+        }
+        if (tree.get(KEYS + 7) != std::optional<std::string>("v7") ||
+            treeOptions.tableCache->getStats().openTables == 0) {
+            LOG_ERROR("Lookup after restart did not open its table");
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during table cache test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_learned_index() {
+    try {
+        // Fit the model over block keys directly and compare with a plain search
+        auto check = [](const std::vector<int>& keys, uint32_t epsilon, size_t maxSegments) {
+            LearnedIndex<int>::Builder builder(epsilon);
+            std::string keyBytes;
+            for (size_t i = 0; i < keys.size(); i++) {
+                keyBytes.clear();
+                Serializer<int>::encode(keys[i], keyBytes);
+                builder.add(keyBytes, i * 100, 100);
+            }
+            std::string bytes = builder.finish();
+            LearnedIndex<int> index(bytes.data(), bytes.size());
+            if (!index.ok() || index.blockCount() != keys.size() || index.segmentCount() > maxSegments) {
+                LOG_ERROR("Learned index has " + std::to_string(index.segmentCount()) + " segments");
+                return false;
+            }
+            for (int probe = keys.front() - 5; probe <= keys.back() + 5; probe++) {
+                size_t expected = std::lower_bound(keys.begin(), keys.end(), probe) - keys.begin();
+                uint64_t offset = 0, size = 0;
+                bool found = index.find(probe, &offset, &size);
+                if (found != (expected < keys.size()) || (found && offset != expected * 100)) {
+                    LOG_ERROR("Learned index misplaced key " + std::to_string(probe));
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        std::vector<int> dense, skewed;
+        for (int i = 0; i < 2000; i++) {
+            dense.push_back(i * 16 + 15);
+            skewed.push_back(i < 1000 ? i * 3 : 3000 + (i - 1000) * (i - 1000));
+        }
+        if (!check(dense, 4, 1) || !check(skewed, 4, 200) || !check({7}, 4, 1)) {
+            return false;
+        }
+
+        // Integer tables carry the model and answer lookups through it
+        std::string dir = freshDirectory("learned_index");
+        std::filesystem::create_directories(dir);
+        MMapManager mmapManager;
+        LSMOptions options;
+        options.blockSize = 256;
+        const int COUNT = 20000;
+        MemTable<int, std::string> memtable(64 * 1024 * 1024);
+        for (int i = 0; i < COUNT; i++) {
+            memtable.put(i * 7 + (i % 5), "value-" + std::to_string(i));
+        }
+        auto table = SSTable<int, std::string>::createFromMemTable(memtable, &mmapManager, dir, 0, options);
+        if (table->getMetadata().learnedIndexSize == 0 || table->getBlockCount() < 100) {
+            LOG_ERROR("Integer table was written without a learned index");
+            return false;
+        }
+        for (int i = 0; i < COUNT; i++) {
+            int key = i * 7 + (i % 5);
+            if (table->get(key) != std::optional<std::string>("value-" + std::to_string(i)) ||
+                table->get(key + 5).has_value() != (((i + 1) * 7 + ((i + 1) % 5)) == key + 5)) {
+                LOG_ERROR("Learned index lookup failed near key " + std::to_string(key));
+                return false;
+            }
+        }
+
+        // Other key types keep using the index block
+        MemTable<std::string, std::string> strings(64 * 1024 * 1024);
+        strings.put("a", "1");
+        auto stringTable = SSTable<std::string, std::string>::createFromMemTable(strings, &mmapManager, dir, 0, options);
+        if (stringTable->getMetadata().learnedIndexSize != 0 || stringTable->get("a") != std::optional<std::string>("1")) {
+            LOG_ERROR("String table should not have a learned index");
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during learned index test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_compaction_keeps_newest_version() {
+    try {
+        std::string dir = freshDirectory("compaction_merge");
+        auto expected = [](int i) {
+            return i >= 250 && i < 400 ? "v3-" + std::to_string(i)
+                 : i < 500             ? "v2-" + std::to_string(i)
+                                       : "v1-" + std::to_string(i);
+        };
+
+        {
+            LSMTree<int, std::string> tree(dir);
+
+            // Three overlapping L0 tables, each overwriting part of the previous one
+            for (int i = 0; i < 1000; i++) tree.put(i, "v1-" + std::to_string(i));
+            tree.flush();
+            for (int i = 0; i < 500; i++) tree.put(i, "v2-" + std::to_string(i));
+            tree.flush();
+            for (int i = 250; i < 400; i++) tree.put(i, "v3-" + std::to_string(i));
+            tree.flush();
+
+            tree.compact(0, true);
+
+            auto counts = tree.getSSTableCountsByLevel();
+            if (counts[0] != 0 || counts[1] != 1) {
+                LOG_ERROR("Compaction did not produce a single level 1 table");
+                return false;
+            }
+
+            auto scan = tree.range(0, 999);
+            if (scan.size() != 1000) {
+                LOG_ERROR("Merged table holds " + std::to_string(scan.size()) + " entries");
+                return false;
+            }
+            for (const auto& [key, value] : scan) {
+                if (value != expected(key)) {
+                    LOG_ERROR("Compaction kept a stale version of key " + std::to_string(key));
+                    return false;
+                }
+            }
+        }
+
+        // Replaced input files are deleted, so a restart sees only the merged table
+        size_t files = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.path().extension() == ".db") files++;
+        }
+        if (files != 1) {
+            LOG_ERROR("Expected one SSTable file after compaction, found " + std::to_string(files));
+            return false;
+        }
+
+        LSMTree<int, std::string> tree(dir);
+        for (int i = 0; i < 1000; i++) {
+            auto value = tree.get(i);
+            if (!value || *value != expected(i)) {
+                LOG_ERROR("Wrong value for key " + std::to_string(i) + " after restart");
+                return false;
+            }
+        }
+
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during compaction merge test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_partitioned_compaction_output() {
+    try {
+        std::string dir = freshDirectory("partitioned");
+        std::filesystem::create_directories(dir);
+
+        LSMOptions options;
+        options.compression = CompressionType::None;
+        options.targetFileSize = 64 * 1024;
+        options.level0CompactionTrigger = 4;
+        options.maxBytesForLevelBase = 1024 * 1024;
+
+        MMapManager mmapManager;
+        CompactionManager<int, std::string> compaction(&mmapManager, dir, options);
+
+        // Four interleaved L0 tables reach the trigger and compact on their own
+        const int COUNT = 40000;
+        for (int t = 0; t < 4; t++) {
+            MemTable<int, std::string> memtable(64 * 1024 * 1024);
+            for (int i = t; i < COUNT; i += 4) {
+                memtable.put(i, "value-" + std::to_string(i));
+            }
+            compaction.addTable(SSTable<int, std::string>::createFromMemTable(
+                memtable, &mmapManager, dir, 0, options));
+        }
+        compaction.waitForCompactions();
+
+        if (compaction.getTableCount(0) != 0 || compaction.getTableCount(1) < 4) {
+            LOG_ERROR("Expected level 0 to be split into several level 1 tables, got " +
+                      std::to_string(compaction.getTableCount(1)));
+            return false;
+        }
+
+        // Level 1 tables are sorted, disjoint, near the target size and cover every key
+        auto tables = compaction.getTablesForRange(0, COUNT);
+        uint32_t keys = 0;
+        for (size_t i = 0; i < tables.size(); i++) {
+            const auto& meta = tables[i]->getMetadata();
+            keys += meta.keyCount;
+            if (i > 0 && !(tables[i - 1]->getMetadata().maxKey < meta.minKey)) {
+                LOG_ERROR("Level 1 tables overlap");
+                return false;
+            }
+            if (meta.fileSize > options.targetFileSize + 2 * options.blockSize + 16 * 1024) {
+                LOG_ERROR("Level 1 table exceeds the target size: " + std::to_string(meta.fileSize));
+                return false;
+            }
+        }
+        if (keys != static_cast<uint32_t>(COUNT)) {
+            LOG_ERROR("Level 1 holds " + std::to_string(keys) + " keys");
+            return false;
+        }
+
+        // Point lookups land in exactly one level 1 table
+        for (int i = 0; i < COUNT; i += 97) {
+            auto candidates = compaction.getTablesForKey(i);
+            if (candidates.size() != 1 || candidates[0]->get(i) != "value-" + std::to_string(i)) {
+                LOG_ERROR("Lookup of key " + std::to_string(i) + " failed after compaction");
+                return false;
+            }
+        }
+
+        // An update to a narrow key range rewrites only the overlapping tables
+        size_t before = compaction.getTableCount(1);
+        std::string untouched = compaction.getTablesForKey(COUNT - 1).front()->getFilePath();
+        MemTable<int, std::string> update(64 * 1024 * 1024);
+        for (int i = 100; i < 200; i++) {
+            update.put(i, "updated-" + std::to_string(i));
+        }
+        compaction.addTable(SSTable<int, std::string>::createFromMemTable(update, &mmapManager, dir, 0, options));
+        compaction.scheduleCompaction(0, true);
+        compaction.waitForCompactions();
+
+        if (compaction.getTableCount(1) < before || compaction.getTablesForKey(150).front()->get(150) != "updated-150" ||
+            compaction.getTablesForKey(COUNT - 1).front()->getFilePath() != untouched) {
+            LOG_ERROR("Partial compaction lost tables or the newer version");
+            return false;
+        }
+
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during partitioned compaction test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_parallel_subcompactions() {
+    try {
+        const int COUNT = 60000;
+        std::vector<std::pair<int, std::string>> results[2];
+        int subcompactions[2] = {1, 4};
+
+        for (int run = 0; run < 2; run++) {
+            std::string dir = freshDirectory("subcompactions_" + std::to_string(subcompactions[run]));
+            std::filesystem::create_directories(dir);
+
+            LSMOptions options;
+            options.targetFileSize = 64 * 1024;
+            options.level0CompactionTrigger = 100;
+            options.maxSubcompactions = subcompactions[run];
+
+            MMapManager mmapManager;
+            CompactionManager<int, std::string> compaction(&mmapManager, dir, options);
+
+            // Overlapping tables where later ones overwrite part of the earlier ones
+            for (int t = 0; t < 3; t++) {
+                MemTable<int, std::string> memtable(64 * 1024 * 1024);
+                for (int i = t * 5000; i < COUNT; i += t + 1) {
+                    memtable.put(i, "v" + std::to_string(t) + "-" + std::to_string(i));
+                }
+                compaction.addTable(SSTable<int, std::string>::createFromMemTable(
+                    memtable, &mmapManager, dir, 0, options));
+            }
+            compaction.scheduleCompaction(0, true);
+            compaction.waitForCompactions();
+
+            auto tables = compaction.getTablesForRange(0, COUNT);
+            for (size_t i = 1; i < tables.size(); i++) {
+                if (!(tables[i - 1]->getMetadata().maxKey < tables[i]->getMetadata().minKey)) {
+                    LOG_ERROR("Subcompaction outputs overlap");
+                    return false;
+                }
+            }
+            for (auto* table : tables) {
+                table->forEach([&](const int& key, const std::string& value) {
+                    results[run].emplace_back(key, value);
+                });
+            }
+        }
+
+        if (results[0].size() != static_cast<size_t>(COUNT) || results[0] != results[1]) {
+            LOG_ERROR("Parallel subcompactions produced different data than a single merge");
+            return false;
+        }
+        for (const auto& [key, value] : results[1]) {
+            int newest = key >= 10000 && key % 3 == 1 ? 2 : key >= 5000 && key % 2 == 0 ? 1 : 0;
+            if (value != "v" + std::to_string(newest) + "-" + std::to_string(key)) {
+                LOG_ERROR("Subcompaction kept a stale version of key " + std::to_string(key));
+                return false;
+            }
+        }
+
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during subcompaction test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_universal_compaction() {
+    try {
+        std::string dir = freshDirectory("universal");
+        std::filesystem::create_directories(dir);
+
+        LSMOptions options;
+        options.compactionStyle = CompactionStyle::Universal;
+        options.level0CompactionTrigger = 4;
+        options.universalMaxRuns = 6;
+
+        const int ROUNDS = 20;
+        const int KEYS = 2000;
+        auto check = [&](CompactionManager<int, std::string>& compaction) {
+            // Every key must resolve to the round that wrote it last
+            for (int i = 0; i < KEYS; i += 7) {
+                int lastRound = ROUNDS - 1 - (ROUNDS - 1 - i % 3) % 3;
+                std::string expected = "r" + std::to_string(lastRound) + "-" + std::to_string(i);
+                std::optional<std::string> found;
+                for (auto* table : compaction.getTablesForKey(i)) {
+                    if ((found = table->get(i))) break;
+                }
+                if (found != expected) {
+                    LOG_ERROR("Universal compaction returned a stale value for key " + std::to_string(i));
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        {
+            MMapManager mmapManager;
+            CompactionManager<int, std::string> compaction(&mmapManager, dir, options);
+            if (std::string(compaction.getStrategyName()) != "universal") {
+                LOG_ERROR("Universal strategy was not selected");
+                return false;
+            }
+
+            // Round r rewrites the keys with i % 3 == r % 3 (plus all keys in the first rounds)
+            for (int r = 0; r < ROUNDS; r++) {
+                MemTable<int, std::string> memtable(64 * 1024 * 1024);
+                for (int i = 0; i < KEYS; i++) {
+                    if (r < 3 || i % 3 == r % 3) {
+                        memtable.put(i, "r" + std::to_string(r) + "-" + std::to_string(i));
+                    }
+                }
+                compaction.addTable(SSTable<int, std::string>::createFromMemTable(
+                    memtable, &mmapManager, dir, 0, options));
+                compaction.waitForCompactions();
+            }
+
+            // Runs stay in level 0 and their number stays bounded
+            if (compaction.getTableCount(0) > options.universalMaxRuns || compaction.getTableCount(1) != 0) {
+                LOG_ERROR("Universal compaction left " + std::to_string(compaction.getTableCount(0)) + " runs");
+                return false;
+            }
+            if (!check(compaction)) {
+                return false;
+            }
+        }
+
+        // Run order survives a restart
+        MMapManager mmapManager;
+        CompactionManager<int, std::string> compaction(&mmapManager, dir, options);
+        return check(compaction);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during universal compaction test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_rate_limiter() {
+    try {
+        using Clock = std::chrono::steady_clock;
+
+        // 2 MB/s: 400 KB takes about 200 ms
+        RateLimiter limiter(2 * 1024 * 1024, 8 * 1024 * 1024);
+        auto start = Clock::now();
+        for (int i = 0; i < 100; i++) {
+            limiter.request(4 * 1024, RateLimiter::Priority::Low);
+        }
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        if (elapsed < 0.15 || elapsed > 1.0) {
+            LOG_ERROR("Rate limiter took " + std::to_string(elapsed) + "s for 400 KB at 2 MB/s");
+            return false;
+        }
+
+        // A flush waiting behind a large compaction write goes first
+        std::atomic<int> order{0};
+        int compactionDone = 0, flushDone = 0;
+        std::thread compaction([&] {
+            limiter.request(600 * 1024, RateLimiter::Priority::Low);
+            compactionDone = ++order;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::thread flush([&] {
+            limiter.request(100 * 1024, RateLimiter::Priority::High);
+            flushDone = ++order;
+        });
+        compaction.join();
+        flush.join();
+        if (flushDone != 1 || compactionDone != 2) {
+            LOG_ERROR("High priority request did not overtake the low priority one");
+            return false;
+        }
+
+        // Auto-tuning follows compaction debt, bounded by the maximum
+        limiter.updateCompactionDebt(3.0);
+        if (limiter.getBytesPerSecond() != 6 * 1024 * 1024) {
+            LOG_ERROR("Auto-tuned rate is " + std::to_string(limiter.getBytesPerSecond()));
+            return false;
+        }
+        limiter.updateCompactionDebt(100.0);
+        if (limiter.getBytesPerSecond() != 8 * 1024 * 1024) {
+            LOG_ERROR("Auto-tuned rate exceeded the maximum");
+            return false;
+        }
+        limiter.updateCompactionDebt(0.5);
+        if (limiter.getBytesPerSecond() != 2 * 1024 * 1024) {
+            LOG_ERROR("Auto-tuned rate did not fall back to the base rate");
+            return false;
+        }
+
+        // Table writes are charged to the limiter
+        std::string dir = freshDirectory("rate_limiter");
+        std::filesystem::create_directories(dir);
+        MemTable<int, std::string> memtable(64 * 1024 * 1024);
+        for (int i = 0; i < 5000; i++) {
+            memtable.put(i, "value-" + std::to_string(i));
+        }
+        MMapManager mmapManager;
+        LSMOptions options;
+        options.rateLimiter = std::make_shared<RateLimiter>(64 * 1024 * 1024);
+        auto table = SSTable<int, std::string>::createFromMemTable(memtable, &mmapManager, dir, 0, options);
+        auto stats = options.rateLimiter->getStats();
+        if (stats.bytesThrough[static_cast<int>(RateLimiter::Priority::High)] != table->getMetadata().fileSize) {
+            LOG_ERROR("Flush writes were not charged to the rate limiter");
+            return false;
+        }
+
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during rate limiter test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_tombstones() {
+    try {
+        std::string dir = freshDirectory("tombstones");
+        const int COUNT = 1000;
+        auto live = [](int i) { return !(i < 500 && i % 2 == 0 && i != 2) && i != 501; };
+        auto check = [&](LSMTree<int, std::string>& tree, const std::string& stage) {
+            for (int i = 0; i < COUNT; i++) {
+                auto value = tree.get(i);
+                if (value.has_value() != live(i)) {
+                    LOG_ERROR("Key " + std::to_string(i) + " has the wrong visibility " + stage);
+                    return false;
+                }
+            }
+            auto scan = tree.range(0, COUNT - 1);
+            if (scan.size() != 750) {
+                LOG_ERROR("Range returned " + std::to_string(scan.size()) + " entries " + stage);
+                return false;
+            }
+            for (const auto& [key, value] : scan) {
+                if (!live(key)) {
+                    LOG_ERROR("Range returned deleted key " + std::to_string(key) + " " + stage);
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        {
+            LSMTree<int, std::string> tree(dir);
+            for (int i = 0; i < COUNT; i++) tree.put(i, "v-" + std::to_string(i));
+            tree.flush();
+
+            // Tombstones in a newer table hide the older values
+            for (int i = 0; i < 500; i += 2) tree.remove(i);
+            tree.flush();
+
+            // One tombstone still in the memtable, and one key written again after its delete
+            tree.remove(501);
+            tree.put(2, "again");
+            if (!check(tree, "before compaction")) {
+                return false;
+            }
+
+            tree.flush();
+            tree.compact(0, true);
+            if (!check(tree, "after compaction")) {
+                return false;
+            }
+        }
+
+        // Nothing lies below the compacted level, so its output holds no tombstones
+        MMapManager mmapManager;
+        uint64_t stored = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.path().extension() == ".db") {
+                SSTable<int, std::string> table(&mmapManager, entry.path().string());
+                stored += table.getMetadata().keyCount;
+            }
+        }
+        if (stored != 750) {
+            LOG_ERROR("Compacted tables still hold " + std::to_string(stored) + " records");
+            return false;
+        }
+
+        LSMTree<int, std::string> tree(dir);
+        return check(tree, "after restart");
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during tombstone test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_range_deletion() {
+    try {
+        std::string dir = freshDirectory("range_deletion");
+        LSMOptions options;
+        options.targetFileSize = 16 * 1024;
+
+        auto live = [](int i) { return i < 1000 || (i >= 2000 && i < 3000) || i == 1500; };
+        auto check = [&](LSMTree<int, std::string>& tree, const std::string& stage) {
+            for (int i = 0; i < 6000; i += 3) {
+                auto value = tree.get(i);
+                if (value.has_value() != live(i)) {
+                    LOG_ERROR("Key " + std::to_string(i) + " has the wrong visibility " + stage);
+                    return false;
+                }
+            }
+            if (tree.get(1500) != std::optional<std::string>("back")) {
+                LOG_ERROR("Key written after the range delete was lost " + stage);
+                return false;
+            }
+            auto scan = tree.range(0, 5999);
+            if (scan.size() != 2001) {
+                LOG_ERROR("Range returned " + std::to_string(scan.size()) + " entries " + stage);
+                return false;
+            }
+            return true;
+        };
+
+        {
+            LSMTree<int, std::string> tree(dir, 64, options);
+
+            // Older data two levels down, so the first compaction is not the bottom
+            for (int i = 0; i < 3000; i++) tree.put(i, "v-" + std::to_string(i));
+            tree.flush();
+            tree.compact(0, true);
+            tree.compact(1, true);
+
+            // The range delete hides older keys; a later write in the range survives
+            tree.deleteRange(1000, 1999);
+            tree.put(1500, "back");
+            if (!check(tree, "in the memtable")) {
+                return false;
+            }
+
+            tree.flush();
+            if (!check(tree, "in level 0")) {
+                return false;
+            }
+
+            // Level 2 still holds the deleted keys, so the tombstone moves down with its table
+            tree.compact(0, true);
+            if (!check(tree, "in level 1")) {
+                return false;
+            }
+
+            // A table whose whole range is deleted is dropped without a merge
+            for (int i = 4000; i < 5000; i++) tree.put(i, "w-" + std::to_string(i));
+            tree.flush();
+            tree.compact(0, true);
+            tree.deleteRange(3500, 5500);
+            tree.flush();
+            tree.compact(0, true);
+            if (!check(tree, "after dropping a covered table")) {
+                return false;
+            }
+
+            // At the bottom the tombstones and the keys they cover disappear
+            tree.compact(1, true);
+            if (!check(tree, "after the bottom compaction")) {
+                return false;
+            }
+        }
+
+        MMapManager mmapManager;
+        uint64_t stored = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.path().extension() == ".db") {
+                SSTable<int, std::string> table(&mmapManager, entry.path().string());
+                stored += table.getMetadata().keyCount;
+                if (!table.getRangeTombstones().empty()) {
+                    LOG_ERROR("Bottom level table still holds range tombstones");
+                    return false;
+                }
+            }
+        }
+        if (stored != 2001) {
+            LOG_ERROR("Compacted tables still hold " + std::to_string(stored) + " records");
+            return false;
+        }
+
+        LSMTree<int, std::string> tree(dir, 64, options);
+        return check(tree, "after restart");
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during range deletion test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_manifest_recovery() {
+    try {
+        std::string dir = freshDirectory("manifest");
+        LSMOptions options;
+        options.maxManifestEdits = 3;
+
+        auto listFiles = [&dir](const std::string& prefix) {
+            std::vector<std::string> names;
+            for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+                std::string name = entry.path().filename().string();
+                if (name.rfind(prefix, 0) == 0) {
+                    names.push_back(name);
+                }
+            }
+            return names;
+        };
+        auto check = [](LSMTree<int, std::string>& tree, const std::string& stage) {
+            for (int i = 0; i < 4000; i += 7) {
+                if (tree.get(i) != std::optional<std::string>("v" + std::to_string(i / 1000) + "-" + std::to_string(i))) {
+                    LOG_ERROR("Key " + std::to_string(i) + " is wrong " + stage);
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        {
+            LSMTree<int, std::string> tree(dir, 64, options);
+            for (int round = 0; round < 4; round++) {
+                for (int i = round * 1000; i < 4000; i++) {
+                    tree.put(i, "v" + std::to_string(round) + "-" + std::to_string(i));
+                }
+                tree.flush();
+                if (round == 1) {
+                    tree.compact(0, true);
+                }
+            }
+            if (!check(tree, "before restart")) {
+                return false;
+            }
+        }
+
+        // Tables are named by file number, and rollovers leave a single manifest
+        for (const auto& name : listFiles("sstable_")) {
+            if (name.rfind("sstable_L", 0) == 0) {
+                LOG_ERROR("Table still uses the old naming: " + name);
+                return false;
+            }
+        }
+        auto manifests = listFiles("MANIFEST-");
+        if (manifests.size() != 1 || !std::filesystem::exists(dir + "/CURRENT")) {
+            LOG_ERROR("Expected one manifest and CURRENT, found " + std::to_string(manifests.size()) + " manifests");
+            return false;
+        }
+
+        // A torn record at the end of the manifest and an orphaned table from an
+        // interrupted flush must not disturb recovery
+        {
+            std::ofstream manifest(dir + "/" + manifests[0], std::ios::binary | std::ios::app);
+            manifest.write("\x12\x34\x56\x78\xff\x00", 6);
+            std::ofstream orphan(dir + "/sstable_999999.db", std::ios::binary);
+            orphan << "partial table";
+        }
+        {
+            LSMTree<int, std::string> tree(dir, 64, options);
+            if (std::filesystem::exists(dir + "/sstable_999999.db")) {
+                LOG_ERROR("Orphaned table file was not removed");
+                return false;
+            }
+            if (!check(tree, "after restart")) {
+                return false;
+            }
+        }
+
+        // A directory written before the manifest existed is adopted once
+        std::string legacyDir = freshDirectory("manifest_legacy");
+        std::filesystem::create_directories(legacyDir);
+        MMapManager mmapManager;
+        for (int round = 0; round < 2; round++) {
+            MemTable<int, std::string> memtable(64 * 1024 * 1024);
+            memtable.put(1, "r" + std::to_string(round));
+            SSTable<int, std::string>::createFromMemTable(memtable, &mmapManager, legacyDir, 0, options);
+        }
+        for (int open = 0; open < 2; open++) {
+            CompactionManager<int, std::string> compaction(&mmapManager, legacyDir, options);
+            auto tables = compaction.getTablesForKey(1);
+            if (compaction.getTableCount(0) != 2 || tables.empty() || tables[0]->get(1) != std::optional<std::string>("r1")) {
+                LOG_ERROR("Legacy tables were not adopted in order");
+                return false;
+            }
+        }
+
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during manifest test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_concurrent_skiplist_memtable() {
+    try {
+        const int THREADS = 8;
+        const int PER_THREAD = 5000;
+        const int HOT_KEYS = 100;
+
+        // Writers insert interleaved keys and keep overwriting a shared hot
+        // set while a reader looks keys up
+        MemTable<int, std::string> memtable(64 * 1024 * 1024, MemTableType::SkipList);
+        std::atomic<bool> done(false);
+        std::atomic<bool> readerFailed(false);
+        std::thread reader([&] {
+            std::string value;
+            while (!done) {
+                for (int key = 0; key < THREADS * PER_THREAD; key += 97) {
+                    if (memtable.get(key, value) && value != "v-" + std::to_string(key)) {
+                        readerFailed = true;
+                    }
+                }
+            }
+        });
+        std::vector<std::thread> writers;
+        for (int t = 0; t < THREADS; t++) {
+            writers.emplace_back([&, t] {
+                for (int i = 0; i < PER_THREAD; i++) {
+                    int key = i * THREADS + t;
+                    memtable.put(key, "v-" + std::to_string(key));
+                    memtable.put(-1 - i % HOT_KEYS, "hot-" + std::to_string(t));
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        done = true;
+        reader.join();
+
+        if (readerFailed) {
+            LOG_ERROR("Reader saw a wrong value during concurrent inserts");
+            return false;
+        }
+        if (memtable.size() != static_cast<size_t>(THREADS * PER_THREAD + HOT_KEYS)) {
+            LOG_ERROR("Memtable holds " + std::to_string(memtable.size()) + " entries");
+            return false;
+        }
+
+        // Iteration yields every key once, in order, with its newest value
+        int expected = -HOT_KEYS;
+        for (const auto& [key, value] : memtable) {
+            if (key != expected || !value) {
+                LOG_ERROR("Iteration out of order at key " + std::to_string(key));
+                return false;
+            }
+            if (key >= 0 ? *value != "v-" + std::to_string(key) : value->rfind("hot-", 0) != 0) {
+                LOG_ERROR("Wrong value for key " + std::to_string(key));
+                return false;
+            }
+            expected = key == -1 ? 0 : key + 1;
+        }
+        if (expected != THREADS * PER_THREAD) {
+            LOG_ERROR("Iteration stopped at key " + std::to_string(expected));
+            return false;
+        }
+
+        // Tombstones and range deletions behave as in the map memtable
+        memtable.remove(5);
+        memtable.deleteRange(100, 199);
+        memtable.put(150, "back");
+        std::string value;
+        if (memtable.lookup(5, value) != LookupResult::Deleted ||
+            memtable.lookup(120, value) != LookupResult::Deleted ||
+            !memtable.get(150, value) || value != "back") {
+            LOG_ERROR("Deletes in the skiplist memtable are wrong");
+            return false;
+        }
+        if (memtable.range(0, 299).size() != 200 || memtable.rangeRecords(0, 299).size() != 201) {
+            LOG_ERROR("Range over deleted keys returned the wrong entries");
+            return false;
+        }
+        size_t live = 0;
+        memtable.forEach([&](const int&, const std::string&) { live++; });
+        if (live != static_cast<size_t>(THREADS * PER_THREAD + HOT_KEYS - 100)) {
+            LOG_ERROR("forEach visited " + std::to_string(live) + " entries");
+            return false;
+        }
+
+        // Flushing writes the same records a map memtable would
+        std::string dir = freshDirectory("skiplist_memtable");
+        std::filesystem::create_directories(dir);
+        MMapManager mmapManager;
+        auto table = SSTable<int, std::string>::writeMemTable(memtable, &mmapManager, dir + "/table.db", 0);
+        if (table->getMetadata().keyCount != static_cast<uint32_t>(THREADS * PER_THREAD + HOT_KEYS - 99) ||
+            table->lookup(5, value) != LookupResult::Deleted ||
+            table->get(7777) != std::optional<std::string>("v-7777")) {
+            LOG_ERROR("SSTable flushed from the skiplist memtable is wrong");
+            return false;
+        }
+        table.reset();
+
+        // A tree with small skiplist memtables takes puts from several threads
+        LSMOptions options;
+        options.memTableType = MemTableType::SkipList;
+        LSMTree<int, std::string> tree(freshDirectory("skiplist_tree"), 1, options);
+        std::vector<std::thread> treeWriters;
+        for (int t = 0; t < 4; t++) {
+            treeWriters.emplace_back([&, t] {
+                for (int i = t; i < 40000; i += 4) {
+                    tree.put(i, "t-" + std::to_string(i));
+                }
+            });
+        }
+        for (auto& writer : treeWriters) {
+            writer.join();
+        }
+        for (int i = 0; i < 40000; i += 7) {
+            if (tree.get(i) != std::optional<std::string>("t-" + std::to_string(i))) {
+                LOG_ERROR("Tree lost key " + std::to_string(i) + " written concurrently");
+                return false;
+            }
+        }
+        tree.flush();
+        if (tree.range(1000, 1999).size() != 1000) {
+            LOG_ERROR("Range over flushed skiplist memtables is incomplete");
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during concurrent skiplist memtable test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_memtable_memory_accounting() {
+    try {
+        const std::string payload(1000, 'p');
+
+        for (MemTableType type : {MemTableType::Map, MemTableType::SkipList}) {
+            std::string name = type == MemTableType::Map ? "map" : "skiplist";
+            {
+                // Usage counts the value bytes, not just sizeof(std::string),
+                // and grows a whole arena block at a time
+                MemTable<std::string, std::string> memtable(64 * 1024 * 1024, type);
+                for (int i = 0; i < 4000; i++) {
+                    memtable.put("key-" + std::to_string(i), payload);
+                }
+                size_t usage = memtable.getMemoryUsage();
+                if (usage < 4000 * payload.size() || usage > 4000 * payload.size() * 3 / 2 + ARENA_BLOCK_SIZE) {
+                    LOG_ERROR("The " + name + " memtable reports " + std::to_string(usage) + " bytes");
+                    return false;
+                }
+
+                std::string value;
+                if (!memtable.get("key-123", value) || value != payload) {
+                    LOG_ERROR("Value read back from the " + name + " arena is wrong");
+                    return false;
+                }
+            }
+
+            // Small memtables use smaller blocks, so the limit stops the
+            // memtable after about 256 KB of values
+            MemTable<int, std::string> limited(256 * 1024, type);
+            int accepted = 0;
+            while (limited.put(accepted, payload)) {
+                accepted++;
+            }
+            if (accepted < 150 || accepted > 260) {
+                LOG_ERROR("The " + name + " memtable took " + std::to_string(accepted) +
+                          " values of 1000 bytes under a 256 KB limit");
+                return false;
+            }
+        }
+
+        // A tree with small memtables flushes by real size
+        LSMTree<int, std::string> tree(freshDirectory("memtable_accounting"), 1);
+        for (int i = 0; i < 3000; i++) {
+            tree.put(i, payload);
+        }
+        tree.flush();
+        size_t tables = 0;
+        for (size_t count : tree.getSSTableCountsByLevel()) {
+            tables += count;
+        }
+        if (tables < 2) {
+            LOG_ERROR("3 MB of values in 1 MB memtables produced " + std::to_string(tables) + " tables");
+            return false;
+        }
+        for (int i = 0; i < 3000; i += 250) {
+            if (tree.get(i) != std::optional<std::string>(payload)) {
+                LOG_ERROR("Key " + std::to_string(i) + " lost across memtable switches");
+                return false;
+            }
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during memtable memory accounting test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_write_ahead_log() {
+    try {
+        std::string dir = freshDirectory("wal");
+        std::filesystem::create_directories(dir);
+        auto countLogs = [](const std::string& directory) {
+            size_t count = 0;
+            for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+                if (entry.path().extension() == ".log") {
+                    count++;
+                }
+            }
+            return count;
+        };
+
+        // Concurrent appends are serialized, each synced in PerBatch mode
+        std::string segmentPath = dir + "/segment.log";
+        {
+            WriteAheadLog log(segmentPath, 1, WALSyncMode::PerBatch);
+            std::vector<std::thread> threads;
+            std::atomic<int> failures{0};
+            for (int t = 0; t < 8; t++) {
+                threads.emplace_back([&log, &failures, t] {
+                    for (int i = 0; i < 200; i++) {
+                        if (!log.append("record-" + std::to_string(t) + "-" + std::to_string(i))) {
+                            failures++;
+                        }
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            auto stats = log.getStats();
+            if (failures != 0 || stats.records != 1600 || stats.syncs != stats.records) {
+                LOG_ERROR("Appends wrote " + std::to_string(stats.records) + " records with " +
+                          std::to_string(stats.syncs) + " syncs");
+                return false;
+            }
+        }
+        size_t replayed = 0;
+        if (!WriteAheadLog::replay(segmentPath, [&](std::string_view) { replayed++; }) || replayed != 1600) {
+            LOG_ERROR("Replayed " + std::to_string(replayed) + " of 1600 records");
+            return false;
+        }
+
+        // A torn tail costs only the last record
+        std::filesystem::resize_file(segmentPath, std::filesystem::file_size(segmentPath) - 3);
+        replayed = 0;
+        if (WriteAheadLog::replay(segmentPath, [&](std::string_view) { replayed++; }) || replayed != 1599) {
+            LOG_ERROR("Torn segment replayed " + std::to_string(replayed) + " records");
+            return false;
+        }
+        std::string contents;
+        replayed = 0;
+        if (WriteAheadLog::read(segmentPath, contents) ||
+            contents.size() >= std::filesystem::file_size(segmentPath)) {
+            LOG_ERROR("Torn tail was not cut from the checked contents");
+            return false;
+        }
+        WriteAheadLog::forEachRecord(contents, [&](std::string_view) { replayed++; });
+        if (replayed != 1599) {
+            LOG_ERROR("Checked contents hold " + std::to_string(replayed) + " records");
+            return false;
+        }
+        std::filesystem::remove(segmentPath);
+
+        // In interval mode the timer syncs a tail no later write would sync
+        {
+            WriteAheadLog log(segmentPath, 2, WALSyncMode::Interval, 200);
+            log.append("tail");
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (log.getStats().timedSyncs == 0 && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            if (log.getStats().timedSyncs != 1) {
+                LOG_ERROR("Idle tail was synced " + std::to_string(log.getStats().timedSyncs) + " times");
+                return false;
+            }
+
+            // With nothing left to sync the timer stays idle
+            uint64_t syncs = log.getStats().syncs;
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            if (log.getStats().syncs != syncs) {
+                LOG_ERROR("Interval timer synced a segment with nothing to sync");
+                return false;
+            }
+        }
+        std::filesystem::remove(segmentPath);
+
+        // Copy the directory of a live tree whose writes were never flushed,
+        // as a crash would leave it, and open the copy
+        std::string crashDir = freshDirectory("wal_crash");
+        {
+            LSMTree<int, std::string> tree(dir, 64);
+            for (int i = 0; i < 2000; i++) {
+                tree.put(i, "v" + std::to_string(i));
+            }
+            tree.remove(7);
+            tree.deleteRange(100, 199);
+            std::filesystem::copy(dir, crashDir);
+
+            // Flushing makes every segment but the active one obsolete
+            tree.flush();
+            if (countLogs(dir) != 1) {
+                LOG_ERROR("Flushed tree kept " + std::to_string(countLogs(dir)) + " log segments");
+                return false;
+            }
+        }
+        if (countLogs(dir) != 0) {
+            LOG_ERROR("Closed tree left its log segment behind");
+            return false;
+        }
+
+        {
+            LSMTree<int, std::string> tree(crashDir, 64);
+            for (int i = 0; i < 2000; i += 3) {
+                std::optional<std::string> expected;
+                if (i != 7 && (i < 100 || i > 199)) {
+                    expected = "v" + std::to_string(i);
+                }
+                if (tree.get(i) != expected) {
+                    LOG_ERROR("Key " + std::to_string(i) + " is wrong after replaying the log");
+                    return false;
+                }
+            }
+
+            // Recovered writes are flushed, and the replayed segment goes with them
+            tree.flush();
+            if (countLogs(crashDir) != 1 || tree.getSSTableCountsByLevel()[0] == 0) {
+                LOG_ERROR("Recovered memtable was not flushed");
+                return false;
+            }
+        }
+        {
+            LSMTree<int, std::string> tree(crashDir, 64);
+            if (tree.get(1999) != std::optional<std::string>("v1999") || tree.get(150)) {
+                LOG_ERROR("Recovered writes did not survive a second restart");
+                return false;
+            }
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during write-ahead log test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_parallel_log_replay() {
+    try {
+        std::string dir = freshDirectory("wal_replay");
+        std::filesystem::create_directories(dir);
+
+        // Segments as a crashed tree leaves them: key i is written to every
+        // segment, so only replaying them in order yields the last value
+        const int segmentCount = 6;
+        for (int number = 1; number <= segmentCount; number++) {
+            WriteAheadLog log(dir + "/" + Manifest::logFileName(number), number, WALSyncMode::None);
+            for (int i = 0; i < 500; i++) {
+                std::string value = "s" + std::to_string(number) + "-" + std::string(1000, 'x');
+                std::string record;
+                putVarint32(record, 1);
+                record.push_back(static_cast<char>(RecordType::Value));
+                putVarint32(record, sizeof(int));
+                Serializer<int>::encode(i, record);
+                putVarint32(record, static_cast<uint32_t>(value.size()));
+                Serializer<std::string>::encode(value, record);
+                log.append(record);
+            }
+        }
+
+        // More segments than workers, and more writes than one memtable
+        // holds, so the replay rotates memtables part way through a segment
+        LSMOptions options;
+        options.walRecoveryThreads = 4;
+        LSMTree<int, std::string> tree(dir, 1, options);
+        auto stats = tree.getRecoveryStats();
+        if (stats.segments != segmentCount || stats.records != 500 * segmentCount ||
+            stats.tornSegments != 0 || stats.recoveredMemTables < 2 || stats.bytes == 0) {
+            LOG_ERROR("Replayed " + std::to_string(stats.segments) + " segments and " +
+                      std::to_string(stats.records) + " records");
+            return false;
+        }
+        if (stats.openMicros < stats.replayMicros) {
+            LOG_ERROR("Open time does not include the replay");
+            return false;
+        }
+
+        // Reads are served while the recovered memtables are flushed
+        for (int i = 0; i < 500; i += 17) {
+            auto value = tree.get(i);
+            if (!value || value->rfind("s" + std::to_string(segmentCount) + "-", 0) != 0) {
+                LOG_ERROR("Key " + std::to_string(i) + " does not hold the newest replayed value");
+                return false;
+            }
+        }
+
+        tree.flush();
+        if (tree.getRecoveryStats().flushMicros == 0) {
+            LOG_ERROR("Flush of the recovered memtables was not timed");
+            return false;
+        }
+        for (int number = 1; number <= segmentCount; number++) {
+            if (std::filesystem::exists(dir + "/" + Manifest::logFileName(number))) {
+                LOG_ERROR("Replayed segment " + std::to_string(number) + " outlived its flush");
+                return false;
+            }
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during parallel log replay test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_write_batch() {
+    try {
+        std::string dir = freshDirectory("write_batch");
+        std::string crashDir = freshDirectory("write_batch_crash");
+        {
+            LSMTree<int, std::string> tree(dir, 64);
+            for (int i = 0; i < 100; i++) {
+                tree.put(i, "old");
+            }
+
+            // Later writes in a batch win over earlier ones
+            WriteBatch<int, std::string> batch;
+            for (int i = 0; i < 5000; i++) {
+                batch.put(1000 + i, "bulk-" + std::to_string(i));
+            }
+            batch.deleteRange(10, 19);
+            batch.put(15, "revived");
+            batch.remove(50);
+            batch.put(60, "first");
+            batch.put(60, "second");
+            if (!tree.write(batch)) {
+                LOG_ERROR("Write batch was rejected");
+                return false;
+            }
+
+            if (tree.get(12) || tree.get(15) != std::optional<std::string>("revived") || tree.get(50) ||
+                tree.get(60) != std::optional<std::string>("second") ||
+                tree.get(5999) != std::optional<std::string>("bulk-4999")) {
+                LOG_ERROR("Write batch was applied out of order");
+                return false;
+            }
+
+            // Readers see all of a batch or none of it
+            std::atomic<bool> done{false};
+            std::atomic<int> torn{0};
+            std::thread reader([&] {
+                while (!done) {
+                    // One range read sees the memtables at a single point
+                    auto pair = tree.range(-2, -1);
+                    if (pair.size() == 2 && pair[0].second != pair[1].second) {
+                        torn++;
+                    }
+                }
+            });
+            for (int round = 0; round < 300; round++) {
+                WriteBatch<int, std::string> pair;
+                pair.put(-2, std::to_string(round));
+                for (int i = 0; i < 50; i++) {
+                    pair.put(-100 - i, "filler");
+                }
+                pair.put(-1, std::to_string(round));
+                tree.write(pair);
+            }
+            done = true;
+            reader.join();
+            if (torn != 0) {
+                LOG_ERROR("Readers saw " + std::to_string(torn) + " partly applied batches");
+                return false;
+            }
+
+            // The whole batch is one log record, so a crash keeps all of it
+            std::filesystem::copy(dir, crashDir);
+        }
+
+        size_t records = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(crashDir)) {
+            if (entry.path().extension() == ".log") {
+                WriteAheadLog::replay(entry.path().string(), [&](std::string_view) { records++; });
+            }
+        }
+        if (records != 100 + 1 + 300) {
+            LOG_ERROR("Expected 401 log records, found " + std::to_string(records));
+            return false;
+        }
+
+        LSMTree<int, std::string> recovered(crashDir, 64);
+        if (recovered.get(12) || recovered.get(15) != std::optional<std::string>("revived") ||
+            recovered.get(3000) != std::optional<std::string>("bulk-2000") ||
+            recovered.get(-1) != std::optional<std::string>("299")) {
+            LOG_ERROR("Write batch was not recovered from the log");
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during write batch test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_write_groups() {
+    try {
+        std::string dir = freshDirectory("write_groups");
+        std::string crashDir = freshDirectory("write_groups_crash");
+        const int threadCount = 16;
+        const int writesPerThread = 2000;
+
+        for (MemTableType type : {MemTableType::SkipList, MemTableType::Map}) {
+            std::string name = type == MemTableType::Map ? "map" : "skiplist";
+            std::filesystem::remove_all(dir);
+            std::filesystem::remove_all(crashDir);
+            LSMOptions options;
+            options.memTableType = type;
+
+            std::optional<std::string> hotValue;
+            {
+                LSMTree<int, std::string> tree(dir, 64, options);
+
+                // Every thread also overwrites one hot key, so groups hold
+                // several writes to it
+                std::vector<std::thread> threads;
+                std::atomic<int> failures{0};
+                for (int t = 0; t < threadCount; t++) {
+                    threads.emplace_back([&tree, &failures, t] {
+                        for (int i = 0; i < writesPerThread; i++) {
+                            bool ok = i % 10 == 0 ? tree.put(-1, std::to_string(t) + "-" + std::to_string(i))
+                                                  : tree.put(t * writesPerThread + i, "v" + std::to_string(i));
+                            if (!ok) {
+                                failures++;
+                            }
+                        }
+                    });
+                }
+                for (auto& thread : threads) {
+                    thread.join();
+                }
+                if (failures != 0) {
+                    LOG_ERROR(std::to_string(failures) + " concurrent puts failed on the " + name + " memtable");
+                    return false;
+                }
+                hotValue = tree.get(-1);
+                std::filesystem::copy(dir, crashDir);
+            }
+
+            // Writers share log records
+            size_t records = 0;
+            for (const auto& entry : std::filesystem::directory_iterator(crashDir)) {
+                if (entry.path().extension() == ".log") {
+                    WriteAheadLog::replay(entry.path().string(), [&](std::string_view) { records++; });
+                }
+            }
+            if (records == 0 || records >= static_cast<size_t>(threadCount * writesPerThread)) {
+                LOG_ERROR(std::to_string(records) + " log records for " +
+                          std::to_string(threadCount * writesPerThread) + " writes on the " + name + " memtable");
+                return false;
+            }
+
+            // The memtable resolved the hot key the way the log replays it
+            LSMTree<int, std::string> recovered(crashDir, 64, options);
+            if (!hotValue || recovered.get(-1) != hotValue) {
+                LOG_ERROR("Hot key differs after replaying the log of the " + name + " memtable");
+                return false;
+            }
+            for (int key = 1; key < threadCount * writesPerThread; key += 97) {
+                if (key % writesPerThread % 10 != 0 &&
+                    recovered.get(key) != std::optional<std::string>("v" + std::to_string(key % writesPerThread))) {
+                    LOG_ERROR("Key " + std::to_string(key) + " lost by the " + name + " write groups");
+                    return false;
+                }
+            }
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during write group test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_write_stalls() {
+    try {
+        std::string dir = freshDirectory("write_stalls");
+        LSMOptions options;
+        // Level 0 is compacted only when the test asks for it
+        options.level0CompactionTrigger = 100;
+        options.level0SlowdownWritesTrigger = 2;
+        options.level0StopWritesTrigger = 3;
+        options.delayedWriteRate = 64 * 1024;
+        LSMTree<int, std::string> tree(dir, 64, options);
+        const size_t level0 = static_cast<size_t>(WriteStallCause::Level0Tables);
+
+        auto flushTable = [&tree](int base) {
+            for (int i = 0; i < 100; i++) {
+                tree.put(base + i, "value-" + std::to_string(base + i));
+            }
+            tree.flush();
+        };
+
+        flushTable(0);
+        if (tree.getWriteStallStats().condition != WriteStallCondition::Normal) {
+            LOG_ERROR("Writes stalled below the slowdown threshold");
+            return false;
+        }
+
+        // Two level 0 tables slow writes down to the delayed write rate
+        flushTable(100);
+        auto stats = tree.getWriteStallStats();
+        if (stats.condition != WriteStallCondition::Delayed || stats.cause != WriteStallCause::Level0Tables ||
+            stats.level0Tables != 2) {
+            LOG_ERROR("Expected writes to be delayed by two level 0 tables");
+            return false;
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 32; i++) {
+            tree.put(1000 + i, std::string(1024, 'd'));
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        stats = tree.getWriteStallStats();
+        if (elapsed < std::chrono::milliseconds(250) || stats.delays[level0] < 32 || stats.delayMicros == 0) {
+            LOG_ERROR("32 KB of delayed writes took " +
+                      std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()) +
+                      " ms at 64 KB/s over " + std::to_string(stats.delays[level0]) + " delays");
+            return false;
+        }
+
+        // A third table stops writes until compaction empties level 0
+        flushTable(200);
+        std::atomic<bool> written{false};
+        std::thread writer([&tree, &written] {
+            tree.put(5000, "after stop");
+            written = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        stats = tree.getWriteStallStats();
+        bool stopped = !written && stats.condition == WriteStallCondition::Stopped &&
+                       stats.cause == WriteStallCause::Level0Tables;
+
+        tree.compact(0, true);
+        writer.join();
+        if (!stopped) {
+            LOG_ERROR("Write was not stopped by three level 0 tables");
+            return false;
+        }
+
+        stats = tree.getWriteStallStats();
+        if (stats.stops[level0] != 1 || stats.stopMicros < 150000 ||
+            stats.condition != WriteStallCondition::Normal || stats.level0Tables != 0) {
+            LOG_ERROR("Unexpected write stall stats after compaction: " + std::to_string(stats.stops[level0]) +
+                      " stops, " + std::to_string(stats.stopMicros) + " us stopped");
+            return false;
+        }
+        if (tree.get(5000) != std::optional<std::string>("after stop") ||
+            tree.get(150) != std::optional<std::string>("value-150")) {
+            LOG_ERROR("Writes lost across a write stall");
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during write stall test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_parallel_flushes() {
+    try {
+        std::string dir = freshDirectory("parallel_flushes");
+        LSMOptions options;
+        options.maxBackgroundFlushes = 4;
+        options.level0CompactionTrigger = 100;
+        options.memTableStopWritesTrigger = 0;
+        const int rounds = 12;
+        const int keysPerRound = 1200;
+
+        // Each round fills a 1 MB memtable and overwrites a shared key, so
+        // several memtables are flushed at once and the newest must win
+        std::vector<size_t> counts;
+        {
+            LSMTree<int, std::string> tree(dir, 1, options);
+            for (int round = 0; round < rounds; round++) {
+                for (int i = 0; i < keysPerRound; i++) {
+                    tree.put(round * keysPerRound + i, std::string(1000, static_cast<char>('a' + round)));
+                }
+                tree.put(-1, "round-" + std::to_string(round));
+            }
+            tree.flush();
+
+            counts = tree.getSSTableCountsByLevel();
+            if (counts.empty() || counts[0] < static_cast<size_t>(rounds)) {
+                LOG_ERROR("Expected at least " + std::to_string(rounds) + " level 0 tables");
+                return false;
+            }
+            if (tree.get(-1) != std::optional<std::string>("round-" + std::to_string(rounds - 1))) {
+                LOG_ERROR("An older flush shadows the newest value of the shared key");
+                return false;
+            }
+        }
+
+        // The level 0 order survives a restart and a compaction
+        LSMTree<int, std::string> tree(dir, 1, options);
+        if (tree.getSSTableCountsByLevel()[0] != counts[0] ||
+            tree.get(-1) != std::optional<std::string>("round-" + std::to_string(rounds - 1))) {
+            LOG_ERROR("Level 0 order lost across a restart");
+            return false;
+        }
+        tree.compact(0, true);
+        if (tree.get(-1) != std::optional<std::string>("round-" + std::to_string(rounds - 1))) {
+            LOG_ERROR("Compaction resurrected an older value of the shared key");
+            return false;
+        }
+        for (int key = 0; key < rounds * keysPerRound; key += 101) {
+            if (tree.get(key) != std::optional<std::string>(std::string(1000, static_cast<char>('a' + key / keysPerRound)))) {
+                LOG_ERROR("Key " + std::to_string(key) + " lost by the flush workers");
+                return false;
+            }
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during parallel flush test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_completion_futures() {
+    try {
+        std::string dir = freshDirectory("completion_futures");
+        LSMOptions options;
+        options.level0CompactionTrigger = 100;
+        LSMTree<int, std::string> tree(dir, 64, options);
+
+        // With nothing to flush the future is ready at once
+        auto idle = tree.flushAsync();
+        if (idle.wait_for(std::chrono::seconds(0)) != std::future_status::ready || !idle.get()) {
+            LOG_ERROR("Flushing an empty tree did not complete immediately");
+            return false;
+        }
+
+        std::vector<std::shared_future<bool>> flushes;
+        for (int round = 0; round < 3; round++) {
+            for (int i = 0; i < 500; i++) {
+                tree.put(round * 500 + i, "v" + std::to_string(i));
+            }
+            flushes.push_back(tree.flushAsync());
+        }
+        for (auto& flushed : flushes) {
+            if (!flushed.get()) {
+                LOG_ERROR("A flush future reported failure");
+                return false;
+            }
+        }
+
+        // A ready flush has installed its table and deleted its log segments
+        size_t logs = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.path().extension() == ".log") {
+                logs++;
+            }
+        }
+        if (tree.getImmutableMemTableCount() != 0 || tree.getSSTableCountsByLevel()[0] != 3 || logs != 1) {
+            LOG_ERROR("Flush futures completed before their work: " + std::to_string(logs) + " log segments, " +
+                      std::to_string(tree.getSSTableCountsByLevel()[0]) + " level 0 tables");
+            return false;
+        }
+
+        // A ready compaction has installed its output
+        tree.compactAsync(0, true).wait();
+        auto counts = tree.getSSTableCountsByLevel();
+        if (counts[0] != 0 || counts[1] == 0) {
+            LOG_ERROR("Compaction future completed before level 0 was compacted");
+            return false;
+        }
+        if (tree.get(1234) != std::optional<std::string>("v234")) {
+            LOG_ERROR("Key lost by the compaction");
+            return false;
+        }
+
+        // The compaction future waits for the new Version to be published
+        std::string managerDir = freshDirectory("completion_futures_manager");
+        MMapManager mmapManager;
+        std::atomic<bool> published(false);
+        CompactionManager<int, std::string> compaction(
+            &mmapManager, managerDir, options, [&](std::shared_ptr<const Version<int, std::string>>) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                published = true;
+            });
+        for (int t = 0; t < 2; t++) {
+            MemTable<int, std::string> memtable(64 * 1024 * 1024);
+            for (int i = t; i < 1000; i += 2) {
+                memtable.put(i, "v" + std::to_string(i));
+            }
+            compaction.addTable(SSTable<int, std::string>::createFromMemTable(
+                memtable, &mmapManager, managerDir, 0, options));
+        }
+        compaction.scheduleCompaction(0, true).wait();
+        if (!published) {
+            LOG_ERROR("Compaction future completed before its Version was published");
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during completion future test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_super_version_reads() {
+    try {
+        std::string dir = freshDirectory("super_version_reads");
+        LSMOptions options;
+        options.level0CompactionTrigger = 2;
+        LSMTree<int, std::string> tree(dir, 1, options);
+
+        // Each round rewrites every key with one batch, so a read sees a
+        // single round throughout
+        const int keyCount = 100;
+        auto writeRound = [&](int round) {
+            WriteBatch<int, std::string> batch;
+            for (int key = 0; key < keyCount; key++) {
+                batch.put(key, std::to_string(round) + ":" + std::string(1000, 'x'));
+            }
+            return tree.write(batch);
+        };
+        if (!writeRound(0)) {
+            LOG_ERROR("Failed to write the first round");
+            return false;
+        }
+
+        // Readers race flushes and compactions that retire the memtables
+        // and tables their snapshots hold
+        std::atomic<bool> done(false);
+        std::atomic<int> failures(0);
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; t++) {
+            readers.emplace_back([&, t] {
+                for (int i = 0; !done; i++) {
+                    if (!tree.get((t * 31 + i) % keyCount)) {
+                        failures++;
+                    }
+                    if (i % 16 != 0) {
+                        continue;
+                    }
+                    auto records = tree.range(0, keyCount - 1);
+                    if (records.size() != static_cast<size_t>(keyCount)) {
+                        failures++;
+                        continue;
+                    }
+                    std::string round = records[0].second.substr(0, records[0].second.find(':'));
+                    for (const auto& [key, value] : records) {
+                        if (value.substr(0, value.find(':')) != round) {
+                            failures++;
+                            break;
+                        }
+                    }
+                }
+            });
+        }
+
+        bool written = true;
+        for (int round = 1; round <= 100 && written; round++) {
+            written = writeRound(round);
+        }
+        tree.flush();
+        done = true;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+
+        if (!written) {
+            LOG_ERROR("Failed to write a round");
+            return false;
+        }
+        if (failures > 0) {
+            LOG_ERROR(std::to_string(failures.load()) + " reads missed keys or saw part of a batch");
+            return false;
+        }
+        if (tree.get(keyCount - 1) != std::optional<std::string>("100:" + std::string(1000, 'x'))) {
+            LOG_ERROR("Last round not readable");
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during super version read test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_flush_failure_retry() {
+    try {
+        std::string dir = freshDirectory("flush_failure");
+        LSMOptions options;
+        options.level0CompactionTrigger = 100;
+
+        // A directory where a table file should go makes its flush fail
+        auto blockTables = [&](bool blocked) {
+            for (int number = 1; number <= 2000; number++) {
+                std::string path = dir + "/sstable_" + std::string(6 - std::to_string(number).size(), '0') +
+                                   std::to_string(number) + ".db";
+                if (blocked && !std::filesystem::exists(path)) {
+                    std::filesystem::create_directory(path);
+                } else if (!blocked && std::filesystem::is_directory(path)) {
+                    std::filesystem::remove(path);
+                }
+            }
+        };
+
+        {
+            LSMTree<int, std::string> tree(dir, 64, options);
+            for (int i = 0; i < 500; i++) {
+                tree.put(i, "v" + std::to_string(i));
+            }
+            blockTables(true);
+            if (tree.flushAsync().get()) {
+                LOG_ERROR("Flush reported success without a table file");
+                return false;
+            }
+
+            // The failed memtable stays queued and readable
+            if (tree.getImmutableMemTableCount() != 1 || tree.get(123) != std::optional<std::string>("v123")) {
+                LOG_ERROR("Writes of the failed flush are not readable");
+                return false;
+            }
+
+            // Once table files can be written again the retry installs it.
+            // A newer memtable flushed during the retry pause waits for it,
+            // and its table still wins over the retried one
+            blockTables(false);
+            tree.put(123, "newer");
+            if (!tree.flushAsync().get() || tree.getImmutableMemTableCount() != 0 ||
+                tree.getSSTableCountsByLevel()[0] != 2) {
+                LOG_ERROR("Retried flush was not installed");
+                return false;
+            }
+            if (tree.get(123) != std::optional<std::string>("newer") ||
+                tree.get(124) != std::optional<std::string>("v124")) {
+                LOG_ERROR("Retried table installed out of age order");
+                return false;
+            }
+
+            // A flush that keeps failing leaves its log segment for the next open
+            for (int i = 500; i < 1000; i++) {
+                tree.put(i, "v" + std::to_string(i));
+            }
+            blockTables(true);
+            if (tree.flushAsync().get()) {
+                LOG_ERROR("Second flush reported success without a table file");
+                return false;
+            }
+        }
+        blockTables(false);
+
+        LSMTree<int, std::string> reopened(dir, 64, options);
+        if (reopened.get(123) != std::optional<std::string>("newer")) {
+            LOG_ERROR("Newer write lost after reopening");
+            return false;
+        }
+        for (int i = 1; i < 1000; i += 37) {
+            if (reopened.get(i) != std::optional<std::string>("v" + std::to_string(i))) {
+                LOG_ERROR("Key " + std::to_string(i) + " lost after a failed flush");
+                return false;
+            }
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during flush failure test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_memtable_sequence_bound() {
+    try {
+        for (MemTableType type : {MemTableType::Map, MemTableType::SkipList}) {
+            std::string name = type == MemTableType::Map ? "map" : "skiplist";
+            MemTable<int, std::string> memtable(64 * 1024 * 1024, type);
+            memtable.add(1, std::string("a"), 1);
+            memtable.add(2, std::string("b"), 2);
+            memtable.add(1, std::string("a2"), 3);
+            memtable.addRangeTombstone(2, 5, 4);
+            memtable.add(3, std::nullopt, 5);
+
+            // Each bound sees the memtable as it was after that write
+            std::string value;
+            if (memtable.lookup(1, value, 2) != LookupResult::Found || value != "a" ||
+                memtable.lookup(1, value, 3) != LookupResult::Found || value != "a2" ||
+                memtable.lookup(1, value) != LookupResult::Found || value != "a2") {
+                LOG_ERROR(name + ": bounded lookup saw the wrong version of key 1");
+                return false;
+            }
+            if (memtable.lookup(2, value, 3) != LookupResult::Found || value != "b" ||
+                memtable.lookup(2, value, 4) != LookupResult::Deleted ||
+                memtable.lookup(3, value, 4) != LookupResult::Deleted ||
+                memtable.lookup(3, value, 3) != LookupResult::NotFound) {
+                LOG_ERROR(name + ": bounded lookup mishandled the range deletion");
+                return false;
+            }
+
+            auto before = memtable.rangeRecords(0, 10, 3);
+            if (before.size() != 2 || before[1].second != std::optional<std::string>("b") ||
+                !memtable.getRangeTombstones(3).empty() || memtable.getRangeTombstones(4).empty()) {
+                LOG_ERROR(name + ": bounded range read saw later writes");
+                return false;
+            }
+            auto after = memtable.rangeRecords(0, 10);
+            if (after.size() != 2 || after[1].first != 3 || after[1].second ||
+                memtable.size() != 3) {
+                LOG_ERROR(name + ": unbounded range read missed the newest writes");
+                return false;
+            }
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during memtable sequence bound test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_log_write_failure() {
+    try {
+        // Segments opened on /dev/full fail every append
+        if (!std::filesystem::exists("/dev/full")) {
+            LOG_INFO("No /dev/full; skipping the log write failure test");
+            return true;
+        }
+        std::string dir = freshDirectory("log_failure");
+        auto blockLogs = [&](bool blocked) {
+            for (int number = 1; number <= 2000; number++) {
+                std::string path = dir + "/" + Manifest::logFileName(number);
+                if (blocked && !std::filesystem::exists(path)) {
+                    std::filesystem::create_symlink("/dev/full", path);
+                } else if (!blocked && std::filesystem::is_symlink(path)) {
+                    std::filesystem::remove(path);
+                }
+            }
+        };
+
+        {
+            LSMTree<int, std::string> tree(dir, 64);
+            for (int i = 0; i < 100; i++) {
+                tree.put(i, "v" + std::to_string(i));
+            }
+
+            // The flush moves the tree to a new segment that cannot be written
+            blockLogs(true);
+            tree.flush();
+            blockLogs(false);
+            if (tree.put(1000, "lost")) {
+                LOG_ERROR("Write succeeded without reaching the log");
+                return false;
+            }
+            if (tree.get(1000)) {
+                LOG_ERROR("Write that failed to log was applied");
+                return false;
+            }
+
+            // Later writes go to a new segment
+            for (int i = 100; i < 200; i++) {
+                if (!tree.put(i, "v" + std::to_string(i))) {
+                    LOG_ERROR("Write " + std::to_string(i) + " failed after the log error");
+                    return false;
+                }
+            }
+        }
+
+        // Everything acknowledged survives a reopen
+        LSMTree<int, std::string> tree(dir, 64);
+        for (int i = 0; i < 200; i++) {
+            if (tree.get(i) != std::optional<std::string>("v" + std::to_string(i))) {
+                LOG_ERROR("Key " + std::to_string(i) + " is lost after the log error");
+                return false;
+            }
+        }
+        if (tree.get(1000)) {
+            LOG_ERROR("Failed write reappeared after reopening");
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during log write failure test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool test_compaction_after_clear() {
+    try {
+        std::string dir = freshDirectory("compaction_after_clear");
+        LSMTree<int, std::string> tree(dir, 64);
+        for (int i = 0; i < 100; i++) {
+            tree.put(i, "v" + std::to_string(i));
+        }
+        tree.flush();
+        tree.clear();
+
+        // No compaction thread is left to run the job, so its future is ready at once
+        auto done = tree.compactAsync(0, true);
+        if (done.wait_for(std::chrono::seconds(5)) != std::future_status::ready) {
+            LOG_ERROR("Compaction scheduled after clear never completed");
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception during compaction after clear test: " + std::string(e.what()));
+        return false;
+    }
+}
+
+// Main function - entry point for the test executable
+int main() {
+    // Initialize the logger with the appropriate LogLevel based on compile-time setting
+    LogLevel runtimeLogLevel;
+
+    #if LOG_LEVEL == LOG_LEVEL_DEBUG
+        runtimeLogLevel = LogLevel::DEBUG;
+    #elif LOG_LEVEL == LOG_LEVEL_INFO
+        runtimeLogLevel = LogLevel::INFO;
+    #elif LOG_LEVEL == LOG_LEVEL_WARNING
+        runtimeLogLevel = LogLevel::WARNING;
+    #elif LOG_LEVEL == LOG_LEVEL_ERROR
+        runtimeLogLevel = LogLevel::ERR;
+    #else
+        runtimeLogLevel = LogLevel::NONE;
+    #endif
+
+    #ifdef LOG_TO_FILE
+        #ifdef LOG_FILE_PATH
+            Logger::getInstance().init(LOG_FILE_PATH, runtimeLogLevel, false);
+        #else
+            Logger::getInstance().init("lsm_tests.log", runtimeLogLevel, false);
+        #endif
+    #else
+        Logger::getInstance().init("", runtimeLogLevel, true);
+    #endif
+
+    LOG_INFO("Running LSM tree tests...");
+    std::cout << "Running LSM tree tests..." << std::endl;
+
+    // Define test cases
+    std::vector<TestCase> testCases = {
+        {"String Values Survive Restart", test_string_values_survive_restart},
+        {"Bloom Filter Skips Missing Keys", test_bloom_filter_skips_missing_keys},
+        {"Block Index Lookups", test_block_index_lookups},
+        {"Block Compression", test_block_compression},
+        {"Block Cache", test_block_cache},
+        {"Table Cache", test_table_cache},
+        {"Learned Index", test_learned_index},
+        {"Compaction Keeps Newest Version", test_compaction_keeps_newest_version},
+        {"Partitioned Compaction Output", test_partitioned_compaction_output},
+        {"Parallel Subcompactions", test_parallel_subcompactions},
+        {"Universal Compaction", test_universal_compaction},
+        {"Rate Limiter", test_rate_limiter},
+        {"Tombstones", test_tombstones},
+        {"Range Deletion", test_range_deletion},
+        {"Manifest Recovery", test_manifest_recovery},
+        {"Concurrent SkipList MemTable", test_concurrent_skiplist_memtable},
+        {"MemTable Memory Accounting", test_memtable_memory_accounting},
+        {"Write-Ahead Log", test_write_ahead_log},
+        {"Parallel Log Replay", test_parallel_log_replay},
+        {"Write Batch", test_write_batch},
+        {"Write Groups", test_write_groups},
+        {"Write Stalls", test_write_stalls},
+        {"Parallel Flushes", test_parallel_flushes},
+        {"Completion Futures", test_completion_futures},
+        {"Super Version Reads", test_super_version_reads},
+        {"Flush Failure Retry", test_flush_failure_retry},
+        {"MemTable Sequence Bound", test_memtable_sequence_bound},
+        {"Log Write Failure", test_log_write_failure},
+        {"Compaction After Clear", test_compaction_after_clear},
+    };
+
+    // Run tests and collect results
+    int passed = 0;
+    for (const auto& test : testCases) {
+        LOG_INFO("Running test: " + test.name);
+        std::cout << "Running test: " << test.name << "... ";
+        if (test.testFunction()) {
+            std::cout << "PASSED" << std::endl;
+            passed++;
+        } else {
+            std::cout << "FAILED" << std::endl;
+        }
+    }
+
+    std::cout << "Test summary: " << passed << " / " << testCases.size()
+              << " tests passed." << std::endl;
+    LOG_INFO("Test summary: " + std::to_string(passed) + " / " +
+             std::to_string(testCases.size()) + " tests passed.");
+
+    return (passed == testCases.size()) ? 0 : 1;
+}